@@ -7,6 +7,7 @@
 #include "chainparams.h"
 #include "validation.h"
 #include "streams.h"
+#include "util.h"
 #include "consensus/validation.h"
 
 namespace block_bench {
@@ -32,6 +33,25 @@ static void DeserializeBlockTest(benchmark::State& state)
     }
 }
 
+static void DeserializeBlockParallelTest(benchmark::State& state)
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    // As with the default -par
+    const int nScriptCheckThreadsOld = nScriptCheckThreads;
+    nScriptCheckThreads = GetNumCores();
+    while (state.KeepRunning()) {
+        CBlock block;
+        DeserializeBlock(stream, block);
+        assert(stream.Rewind(sizeof(block_bench::block413567)));
+    }
+    nScriptCheckThreads = nScriptCheckThreadsOld;
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::State& state)
 {
     CDataStream stream((const char*)block_bench::block413567,
@@ -53,4 +73,5 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
 }
 
 BENCHMARK(DeserializeBlockTest);
+BENCHMARK(DeserializeBlockParallelTest);
 BENCHMARK(DeserializeAndCheckBlockTest);
@@ -99,5 +99,70 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+
+// This Benchmark compares CCheckQueue with CWorkStealingCheckQueue across
+// thread counts on a block of many transactions with few inputs each, where
+// the cost of handing out work dominates.
+static const size_t SMALL_TXS = 2000;
+static const size_t SMALL_TX_INPUTS = 2;
+struct FakeInputCheck {
+    uint64_t n {0};
+    bool operator()()
+    {
+        // A little bit of work, much less than a signature check
+        for (int i = 0; i < 64; ++i)
+            n = n * 6364136223846793005ULL + 1442695040888963407ULL;
+        return true;
+    }
+    void swap(FakeInputCheck& x){ std::swap(n, x.n); };
+};
+template <typename Queue>
+static void CheckQueueThreads(benchmark::State& state, int nThreads)
+{
+    Queue queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    // The master thread joins in as the last one.
+    for (auto x = 0; x < nThreads - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        CCheckQueueControl<FakeInputCheck, Queue> control(nThreads > 1 ? &queue : nullptr);
+        std::vector<FakeInputCheck> vChecks;
+        for (size_t i = 0; i < SMALL_TXS; ++i) {
+            vChecks.resize(SMALL_TX_INPUTS);
+            if (nThreads > 1) {
+                control.Add(vChecks);
+            } else {
+                for (auto& check : vChecks)
+                    check();
+            }
+            vChecks.clear();
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+static void CCheckQueueThreads1(benchmark::State& state) { CheckQueueThreads<CCheckQueue<FakeInputCheck>>(state, 1); }
+static void CCheckQueueThreads2(benchmark::State& state) { CheckQueueThreads<CCheckQueue<FakeInputCheck>>(state, 2); }
+static void CCheckQueueThreads4(benchmark::State& state) { CheckQueueThreads<CCheckQueue<FakeInputCheck>>(state, 4); }
+static void CCheckQueueThreads8(benchmark::State& state) { CheckQueueThreads<CCheckQueue<FakeInputCheck>>(state, 8); }
+static void CCheckQueueThreads16(benchmark::State& state) { CheckQueueThreads<CCheckQueue<FakeInputCheck>>(state, 16); }
+static void CWorkStealingCheckQueueThreads1(benchmark::State& state) { CheckQueueThreads<CWorkStealingCheckQueue<FakeInputCheck>>(state, 1); }
+static void CWorkStealingCheckQueueThreads2(benchmark::State& state) { CheckQueueThreads<CWorkStealingCheckQueue<FakeInputCheck>>(state, 2); }
+static void CWorkStealingCheckQueueThreads4(benchmark::State& state) { CheckQueueThreads<CWorkStealingCheckQueue<FakeInputCheck>>(state, 4); }
+static void CWorkStealingCheckQueueThreads8(benchmark::State& state) { CheckQueueThreads<CWorkStealingCheckQueue<FakeInputCheck>>(state, 8); }
+static void CWorkStealingCheckQueueThreads16(benchmark::State& state) { CheckQueueThreads<CWorkStealingCheckQueue<FakeInputCheck>>(state, 16); }
+
 BENCHMARK(CCheckQueueSpeed);
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+BENCHMARK(CCheckQueueThreads1);
+BENCHMARK(CCheckQueueThreads2);
+BENCHMARK(CCheckQueueThreads4);
+BENCHMARK(CCheckQueueThreads8);
+BENCHMARK(CCheckQueueThreads16);
+BENCHMARK(CWorkStealingCheckQueueThreads1);
+BENCHMARK(CWorkStealingCheckQueueThreads2);
+BENCHMARK(CWorkStealingCheckQueueThreads4);
+BENCHMARK(CWorkStealingCheckQueueThreads8);
+BENCHMARK(CWorkStealingCheckQueueThreads16);
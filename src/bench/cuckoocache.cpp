@@ -0,0 +1,74 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "cuckoocache.h"
+#include "random.h"
+#include "script/sigcache.h"
+
+#include <vector>
+
+// A cache the size of the default signature cache, filled to its usual load.
+class CacheBenchSetup
+{
+public:
+    CuckooCache::cache<uint256, SignatureCacheHasher> cache;
+    std::vector<uint256> inserted;
+    std::vector<uint256> absent;
+
+    CacheBenchSetup()
+    {
+        FastRandomContext rng(true);
+        const uint32_t nEntries = cache.setup_bytes(DEFAULT_MAX_SIG_CACHE_SIZE << 20);
+        for (uint32_t i = 0; i < nEntries * 9 / 10; i++) {
+            inserted.push_back(rng.rand256());
+            cache.insert(inserted.back());
+        }
+        for (size_t i = 0; i < 1 << 16; i++)
+            absent.push_back(rng.rand256());
+    }
+};
+
+static void CuckooCacheContainsHit(benchmark::State& state)
+{
+    CacheBenchSetup setup;
+    size_t i = 0;
+    uint64_t nFound = 0;
+    while (state.KeepRunning()) {
+        nFound += setup.cache.contains(setup.inserted[i], false);
+        i = (i + 7919) % setup.inserted.size();
+    }
+    assert(nFound > 0);
+}
+
+static void CuckooCacheContainsMiss(benchmark::State& state)
+{
+    CacheBenchSetup setup;
+    size_t i = 0;
+    uint64_t nFound = 0;
+    while (state.KeepRunning()) {
+        nFound += setup.cache.contains(setup.absent[i], false);
+        i = (i + 1) % setup.absent.size();
+    }
+    assert(nFound == 0);
+}
+
+static void CuckooCacheInsert(benchmark::State& state)
+{
+    CacheBenchSetup setup;
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        // Vary every hash so that each insert is of a new entry
+        uint256 entry = setup.absent[n % setup.absent.size()];
+        uint32_t* words = (uint32_t*)entry.begin();
+        for (int j = 0; j < 8; j++)
+            words[j] ^= n >> 16;
+        setup.cache.insert(entry);
+        n++;
+    }
+}
+
+BENCHMARK(CuckooCacheContainsHit);
+BENCHMARK(CuckooCacheContainsMiss);
+BENCHMARK(CuckooCacheInsert);
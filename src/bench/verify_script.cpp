@@ -105,4 +105,83 @@ static void VerifyScriptBench(benchmark::State& state)
     }
 }
 
+/** Accepts every signature, so that only the script evaluation is measured. */
+class AcceptingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckSig(const std::vector<unsigned char>& vchSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override
+    {
+        return true;
+    }
+};
+
+// Evaluation of a P2PKH spend, through the shortcut VerifyScript takes for
+// standard templates or through the generic interpreter.
+template <bool(*Verify)(const CScript&, const CScript&, const CScriptWitness*, unsigned int, const BaseSignatureChecker&, ScriptError*)>
+static void VerifyP2PKHScriptBench(benchmark::State& state)
+{
+    const int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_LOW_S |
+                      SCRIPT_VERIFY_MINIMALDATA | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_NULLFAIL;
+    CKey key;
+    static const std::array<unsigned char, 32> vchKey = {
+        {
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1
+        }
+    };
+    key.Set(vchKey.begin(), vchKey.end(), true);
+    CPubKey pubkey = key.GetPubKey();
+    CScript scriptPubKey = CScript() << OP_DUP << OP_HASH160 << ToByteVector(pubkey.GetID()) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CTransaction txCredit = BuildCreditingTransaction(scriptPubKey);
+    CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), txCredit);
+    std::vector<unsigned char> vchSig;
+    key.Sign(SignatureHash(scriptPubKey, txSpend, 0, SIGHASH_ALL, txCredit.vout[0].nValue, SIGVERSION_BASE), vchSig);
+    vchSig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    CScript scriptSig = CScript() << vchSig << ToByteVector(pubkey);
+
+    AcceptingSignatureChecker checker;
+    while (state.KeepRunning()) {
+        ScriptError err;
+        bool success = Verify(scriptSig, scriptPubKey, nullptr, flags, checker, &err);
+        assert(err == SCRIPT_ERR_OK);
+        assert(success);
+    }
+}
+
+static void VerifyP2PKHScriptTemplate(benchmark::State& state) { VerifyP2PKHScriptBench<VerifyScript>(state); }
+static void VerifyP2PKHScriptGeneric(benchmark::State& state) { VerifyP2PKHScriptBench<VerifyScriptGeneric>(state); }
+
+// Legacy SIGHASH_ALL hashes of all inputs of a large consolidation
+// transaction, with or without the precomputed transaction data.
+template <bool fPrecompute>
+static void LegacySignatureHashBench(benchmark::State& state)
+{
+    const CScript scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CMutableTransaction txSpend;
+    txSpend.vin.resize(500);
+    for (size_t i = 0; i < txSpend.vin.size(); i++) {
+        txSpend.vin[i].prevout.hash.begin()[0] = i & 0xff;
+        txSpend.vin[i].prevout.n = i;
+        txSpend.vin[i].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+    }
+    txSpend.vout.resize(1);
+    txSpend.vout[0].scriptPubKey = scriptPubKey;
+    const CTransaction tx(txSpend);
+
+    while (state.KeepRunning()) {
+        PrecomputedTransactionData txdata;
+        if (fPrecompute)
+            txdata = PrecomputedTransactionData(tx);
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+            SignatureHash(scriptPubKey, tx, nIn, SIGHASH_ALL, 0, SIGVERSION_BASE, fPrecompute ? &txdata : nullptr);
+        }
+    }
+}
+
+static void LegacySignatureHashPrecomputed(benchmark::State& state) { LegacySignatureHashBench<true>(state); }
+static void LegacySignatureHashSerialized(benchmark::State& state) { LegacySignatureHashBench<false>(state); }
+
 BENCHMARK(VerifyScriptBench);
+BENCHMARK(VerifyP2PKHScriptTemplate);
+BENCHMARK(VerifyP2PKHScriptGeneric);
+BENCHMARK(LegacySignatureHashPrecomputed);
+BENCHMARK(LegacySignatureHashSerialized);
@@ -0,0 +1,99 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "core_memusage.h"
+#include "memusage.h"
+
+#include <iterator>
+
+CBlockCache::CBlockCache(size_t nMaxUsageIn) : nUsage(0), nMaxUsage(nMaxUsageIn), nHits(0), nMisses(0)
+{
+}
+
+void CBlockCache::Trim()
+{
+    AssertLockHeld(cs);
+    while (nUsage > nMaxUsage && !entries.empty()) {
+        nUsage -= entries.back().nUsage;
+        mapEntries.erase(entries.back().hash);
+        entries.pop_back();
+    }
+}
+
+void CBlockCache::SetMaxUsage(size_t nMaxUsageIn)
+{
+    LOCK(cs);
+    nMaxUsage = nMaxUsageIn;
+    Trim();
+}
+
+std::shared_ptr<const CBlock> CBlockCache::Get(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapEntries.find(hash);
+    if (it == mapEntries.end()) {
+        nMisses++;
+        return nullptr;
+    }
+    nHits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->pblock;
+}
+
+void CBlockCache::Insert(const std::shared_ptr<const CBlock>& pblock, bool fRecent)
+{
+    const uint256 hash = pblock->GetHash();
+    // The block itself and the nodes of the list and the map that refer to it.
+    const size_t nBlockUsage = memusage::MallocUsage(sizeof(CBlock)) + RecursiveDynamicUsage(*pblock) +
+                               memusage::MallocUsage(sizeof(Entry) + 2 * sizeof(void*)) +
+                               memusage::MallocUsage(sizeof(std::pair<const uint256, std::list<Entry>::iterator>) + sizeof(void*));
+
+    LOCK(cs);
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end()) {
+        if (fRecent)
+            entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    if (nBlockUsage > nMaxUsage)
+        return;
+    nUsage += nBlockUsage;
+    if (fRecent) {
+        entries.push_front(Entry{hash, pblock, nBlockUsage});
+        mapEntries.emplace(hash, entries.begin());
+        Trim();
+        return;
+    }
+    entries.push_back(Entry{hash, pblock, nBlockUsage});
+    mapEntries.emplace(hash, std::prev(entries.end()));
+    // Evict from just before the new block, which fits on its own.
+    while (nUsage > nMaxUsage) {
+        auto itEvict = std::prev(entries.end(), 2);
+        nUsage -= itEvict->nUsage;
+        mapEntries.erase(itEvict->hash);
+        entries.erase(itEvict);
+    }
+}
+
+void CBlockCache::Clear()
+{
+    LOCK(cs);
+    entries.clear();
+    mapEntries.clear();
+    nUsage = 0;
+}
+
+CBlockCache::Stats CBlockCache::GetStats() const
+{
+    LOCK(cs);
+    Stats stats;
+    stats.nBlocks = entries.size();
+    stats.nUsage = nUsage;
+    stats.nMaxUsage = nMaxUsage;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    return stats;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKCACHE_H
+#define BITCOIN_BLOCKCACHE_H
+
+#include "primitives/block.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <memory>
+#include <stdint.h>
+#include <unordered_map>
+
+/**
+ * Least recently used blocks, up to a memory budget, so that a block many
+ * callers ask for at once (typically a new tip) is read and parsed once.
+ * Blocks are shared and never modified.
+ */
+class CBlockCache
+{
+public:
+    struct Stats
+    {
+        size_t nBlocks;
+        size_t nUsage;
+        size_t nMaxUsage;
+        uint64_t nHits;
+        uint64_t nMisses;
+    };
+
+private:
+    struct Entry
+    {
+        uint256 hash;
+        std::shared_ptr<const CBlock> pblock;
+        size_t nUsage;
+    };
+
+    struct Hasher
+    {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    mutable CCriticalSection cs;
+    //! Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<uint256, std::list<Entry>::iterator, Hasher> mapEntries;
+    size_t nUsage;
+    size_t nMaxUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    void Trim();
+
+public:
+    explicit CBlockCache(size_t nMaxUsageIn);
+
+    /** Change the memory budget in bytes, dropping blocks beyond it. 0 disables the cache. */
+    void SetMaxUsage(size_t nMaxUsageIn);
+
+    /** The block with this hash if it is cached, nullptr otherwise. Counts a hit or a miss. */
+    std::shared_ptr<const CBlock> Get(const uint256& hash);
+
+    /**
+     * Add a block, or mark it as recently used if it is cached already.
+     * Blocks read back from disk are added with fRecent false: they go in
+     * as least recently used and make room by evicting older such blocks
+     * first, so that serving old blocks doesn't push out the recent ones.
+     * They are marked as recently used once asked for again.
+     */
+    void Insert(const std::shared_ptr<const CBlock>& pblock, bool fRecent = true);
+
+    void Clear();
+    Stats GetStats() const;
+};
+
+#endif // BITCOIN_BLOCKCACHE_H
@@ -0,0 +1,107 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfileflusher.h"
+
+#include "util.h"
+
+#include <chrono>
+
+CBlockFileFlusher::CBlockFileFlusher(CommitFunc commitIn) : commit(std::move(commitIn)), fBusy(false), fRunning(false), fStop(false)
+{
+}
+
+void CBlockFileFlusher::ThreadFlush()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    auto nextCommit = std::chrono::steady_clock::now() + std::chrono::seconds(BLOCK_FILE_COMMIT_INTERVAL);
+    while (true) {
+        condWork.wait_until(lock, nextCommit, [&] { return fStop || !setCommit.empty(); });
+        std::set<int> setFiles;
+        if (!setCommit.empty()) {
+            setFiles.swap(setCommit);
+        } else if (fStop) {
+            break;
+        } else {
+            setFiles.swap(setDirty);
+            nextCommit = std::chrono::steady_clock::now() + std::chrono::seconds(BLOCK_FILE_COMMIT_INTERVAL);
+        }
+        if (setFiles.empty())
+            continue;
+        fBusy = true;
+        lock.unlock();
+        for (int nFile : setFiles) {
+            commit(nFile);
+        }
+        lock.lock();
+        fBusy = false;
+        condDone.notify_all();
+    }
+}
+
+void CBlockFileFlusher::Start()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (fRunning)
+        return;
+    fRunning = true;
+    fStop = false;
+    thread = std::thread(&TraceThread<std::function<void()>>, "blkflush",
+                         std::function<void()>(std::bind(&CBlockFileFlusher::ThreadFlush, this)));
+}
+
+void CBlockFileFlusher::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    condWork.notify_all();
+    if (thread.joinable())
+        thread.join();
+    std::lock_guard<std::mutex> lock(cs);
+    fRunning = false;
+    setDirty.clear();
+}
+
+void CBlockFileFlusher::Commit(int nFile)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fRunning) {
+            setDirty.erase(nFile);
+            setCommit.insert(nFile);
+            condWork.notify_all();
+            return;
+        }
+    }
+    commit(nFile);
+}
+
+void CBlockFileFlusher::SetDirty(int nFile)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (fRunning)
+        setDirty.insert(nFile);
+}
+
+void CBlockFileFlusher::Forget(int nFile)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    setDirty.erase(nFile);
+    setCommit.erase(nFile);
+    // The thread may have taken the file before it was erased here.
+    condDone.wait(lock, [&] { return !fBusy; });
+}
+
+void CBlockFileFlusher::Sync()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    if (!setDirty.empty()) {
+        setCommit.insert(setDirty.begin(), setDirty.end());
+        setDirty.clear();
+        condWork.notify_all();
+    }
+    condDone.wait(lock, [&] { return setCommit.empty() && !fBusy; });
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEFLUSHER_H
+#define BITCOIN_BLOCKFILEFLUSHER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+
+//! Seconds after which block and undo data written to a file is synced in the background
+static const int BLOCK_FILE_COMMIT_INTERVAL = 10;
+
+/**
+ * Syncs block and undo files to disk in a thread of its own, so that storing
+ * a block never waits for the disk. A file that has been left is synced as
+ * soon as possible; files still being written to are synced every
+ * BLOCK_FILE_COMMIT_INTERVAL seconds, or when Sync() is called before a
+ * block index write. When the thread isn't running, files are synced by the
+ * caller.
+ */
+class CBlockFileFlusher
+{
+public:
+    typedef std::function<void(int)> CommitFunc;
+
+private:
+    const CommitFunc commit;
+    std::mutex cs;
+    std::condition_variable condWork;
+    std::condition_variable condDone;
+    //! Files that have been left and are to be synced now
+    std::set<int> setCommit;
+    //! Files written to since they were last synced
+    std::set<int> setDirty;
+    bool fBusy;
+    bool fRunning;
+    bool fStop;
+    std::thread thread;
+
+    void ThreadFlush();
+
+public:
+    explicit CBlockFileFlusher(CommitFunc commitIn);
+    ~CBlockFileFlusher() { Stop(); }
+
+    void Start();
+    void Stop();
+    /** Sync a file that is no longer written to. */
+    void Commit(int nFile);
+    /** Note that data was added to a file. */
+    void SetDirty(int nFile);
+    /**
+     * Forget a file that is about to be deleted. Waits for a sync in
+     * progress, so the file is not reopened once this returns.
+     */
+    void Forget(int nFile);
+    /** Wait until all files passed to Commit() or SetDirty() are synced. */
+    void Sync();
+};
+
+#endif // BITCOIN_BLOCKFILEFLUSHER_H
@@ -5,6 +5,8 @@
 
 #include "chain.h"
 
+#include "memusage.h"
+
 /**
  * CChain implementation
  */
@@ -167,3 +169,32 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
     assert(pa == pb);
     return pa;
 }
+
+CBlockIndex* CBlockIndexArena::Insert(const CBlockIndex& index)
+{
+    if (vChunks.empty() || vChunks.back().size() == vChunks.back().capacity()) {
+        vChunks.emplace_back();
+        vChunks.back().reserve(nEntries < MIN_CHUNK_ENTRIES ? MIN_CHUNK_ENTRIES : nEntries > MAX_CHUNK_ENTRIES ? MAX_CHUNK_ENTRIES : nEntries);
+    }
+    vChunks.back().push_back(index);
+    nEntries++;
+    return &vChunks.back().back();
+}
+
+void CBlockIndexArena::Clear()
+{
+    vChunks.clear();
+    nEntries = 0;
+}
+
+CBlockIndexArena::Stats CBlockIndexArena::GetStats() const
+{
+    Stats stats;
+    stats.nEntries = nEntries;
+    stats.nAllocated = memusage::DynamicUsage(vChunks);
+    for (const std::vector<CBlockIndex>& chunk : vChunks) {
+        stats.nAllocated += memusage::DynamicUsage(chunk);
+    }
+    stats.nSeparate = nEntries * memusage::MallocUsage(sizeof(CBlockIndex));
+    return stats;
+}
@@ -171,6 +171,10 @@ enum BlockStatus: uint32_t {
 class CBlockIndex
 {
 public:
+    // Fields read while walking the chain (ancestor lookups, retargeting,
+    // median time past, version bits) come first and share a cache line;
+    // the header hashes, which are rarely read, come last.
+
     //! pointer to the hash of the block, if any. Memory is owned by this CBlockIndex
     const uint256* phashBlock;
 
@@ -183,17 +187,20 @@ public:
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile;
+    //! Verification status of this block. See enum BlockStatus
+    unsigned int nStatus;
 
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos;
+    //! block header
+    unsigned int nTime;
+    unsigned int nBits;
+    int nVersion;
+    unsigned int nNonce;
 
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos;
+    //! (memory only) Maximum nTime in the chain upto and including this block.
+    unsigned int nTimeMax;
 
-    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
-    arith_uint256 nChainWork;
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    int32_t nSequenceId;
 
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied upon
@@ -204,22 +211,21 @@ public:
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
-    //! Verification status of this block. See enum BlockStatus
-    unsigned int nStatus;
+    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
+    arith_uint256 nChainWork;
 
-    //! block header
-    int nVersion;
-    uint256 hashMerkleRoot;
-	uint256 hashMetronome;
-    unsigned int nTime;
-    unsigned int nBits;
-    unsigned int nNonce;
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile;
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    int32_t nSequenceId;
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos;
 
-    //! (memory only) Maximum nTime in the chain upto and including this block.
-    unsigned int nTimeMax;
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos;
+
+    //! block header, continued
+    uint256 hashMerkleRoot;
+	uint256 hashMetronome;
 
     void SetNull()
     {
@@ -438,6 +444,44 @@ public:
     }
 };
 
+/**
+ * Storage for block index entries, allocated in chunks of contiguous entries
+ * rather than one heap allocation each. Entries created one after another, as
+ * headers are during sync, share pages and cache lines, and no per-entry
+ * allocator overhead is paid. Entries keep their address until Clear().
+ * Callers serialize access (cs_main for the node's block index).
+ */
+class CBlockIndexArena
+{
+public:
+    struct Stats
+    {
+        size_t nEntries;
+        //! Bytes allocated for chunks
+        size_t nAllocated;
+        //! Bytes the entries would take allocated one by one
+        size_t nSeparate;
+    };
+
+private:
+    //! Chunks double in size from MIN_CHUNK_ENTRIES up to MAX_CHUNK_ENTRIES.
+    static const size_t MIN_CHUNK_ENTRIES = 64;
+    static const size_t MAX_CHUNK_ENTRIES = 4096;
+
+    //! Each chunk is reserved up front and never grows past its capacity.
+    std::vector<std::vector<CBlockIndex>> vChunks;
+    size_t nEntries;
+
+public:
+    CBlockIndexArena() : nEntries(0) {}
+
+    /** Store a copy of index and return its address. */
+    CBlockIndex* Insert(const CBlockIndex& index);
+    /** Drop all entries. Pointers to them are invalidated. */
+    void Clear();
+    Stats GetStats() const;
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain {
 private:
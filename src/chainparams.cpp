@@ -302,10 +302,10 @@ public:
         nPruneAfterHeight = 1000;
 		metronomeVerificationWindow = 15; // 15 blocks
 
-        genesis = CreateGenesisBlock(1296688602, 2, 0x207fffff, 1, 50 * COIN);
+        genesis = CreateGenesisBlock(1296688602, 3, 0x207fffff, 1, 50 * COIN);
         consensus.hashGenesisBlock = genesis.GetHash();
-        assert(consensus.hashGenesisBlock == uint256S("0x0f9188f13cb7b2c71f2a335e3a4fc328bf5beb436012afca590b1a11466e2206"));
-        assert(genesis.hashMerkleRoot == uint256S("0x4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"));
+        assert(consensus.hashGenesisBlock == uint256S("0x6771aab73a9e2aae1724f3acc215400b52af336ed4f9846e2436ce74f1a34389"));
+        assert(genesis.hashMerkleRoot == uint256S("0xafcf9b6dcf19057cea7debd3d39f00f3708fb191a3a79966411f11989b1aae84"));
 
         vFixedSeeds.clear(); //!< Regtest mode doesn't have any fixed seeds.
         vSeeds.clear();      //!< Regtest mode doesn't have any DNS seeds.
@@ -316,7 +316,7 @@ public:
 
         checkpointData = (CCheckpointData) {
             {
-                {0, uint256S("0f9188f13cb7b2c71f2a335e3a4fc328bf5beb436012afca590b1a11466e2206")},
+                {0, uint256S("6771aab73a9e2aae1724f3acc215400b52af336ed4f9846e2436ce74f1a34389")},
             }
         };
 
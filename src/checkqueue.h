@@ -8,12 +8,32 @@
 #include "sync.h"
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 
 template <typename T>
+class CCheckQueue;
+
+/**
+ * Run the checks of one batch taken from a queue, returning whether they all
+ * passed. Check types that can share work between the checks of a batch
+ * overload this for std::vector of themselves.
+ */
+template <typename T>
+bool CheckBatch(std::vector<T>& vChecks)
+{
+    for (T& check : vChecks)
+        if (!check())
+            return false;
+    return true;
+}
+
+template <typename T, typename Q = CCheckQueue<T>>
 class CCheckQueueControl;
 
 /** 
@@ -119,9 +139,8 @@ private:
                 fOk = fAllOk;
             }
             // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
+            if (fOk)
+                fOk = CheckBatch(vChecks);
             vChecks.clear();
         } while (true);
     }
@@ -166,22 +185,255 @@ public:
 
 };
 
-/** 
- * RAII-style controller object for a CCheckQueue that guarantees the passed
- * queue is finished before continuing.
+/**
+ * Queue for verifications with the same interface as CCheckQueue, in which
+ * the workers do not share a lock.
+ *
+ * The master splits every Add into batches of at most nBatchSize checks and
+ * pushes them onto the bottom of a work-stealing deque (Chase and Lev, "Dynamic
+ * Circular Work-Stealing Deque", with the memory orders of Le et al., "Correct
+ * and Efficient Work-Stealing for Weak Memory Models"). Idle workers steal
+ * batches from the top with a single compare-and-swap, and the master takes
+ * them from the bottom once it joins in Wait. The mutex is only taken to put
+ * workers to sleep, to wake them when some are asleep, and to wake the master
+ * when the last batch finishes.
  */
 template <typename T>
+class CWorkStealingCheckQueue
+{
+private:
+    struct Batch
+    {
+        std::vector<T> vChecks;
+    };
+
+    //! Circular array of batches, replaced by one twice the size when full.
+    struct Array
+    {
+        const int64_t nSize;
+        std::unique_ptr<std::atomic<Batch*>[]> slots;
+
+        explicit Array(int64_t nSizeIn) : nSize(nSizeIn), slots(new std::atomic<Batch*>[nSizeIn]) {}
+        Batch* Get(int64_t i) const { return slots[i & (nSize - 1)].load(std::memory_order_relaxed); }
+        void Put(int64_t i, Batch* batch) { slots[i & (nSize - 1)].store(batch, std::memory_order_relaxed); }
+    };
+
+    //! Index of the oldest batch, advanced by whoever claims it.
+    std::atomic<int64_t> nTop;
+
+    //! Index one past the newest batch, only written by the master.
+    std::atomic<int64_t> nBottom;
+
+    std::atomic<Array*> array;
+
+    //! Arrays that were grown out of. Thieves may still be reading them, so
+    //! they are kept until the queue is destroyed; there are only
+    //! logarithmically many.
+    std::vector<std::unique_ptr<Array>> vRetired;
+
+    //! Batch objects, reused across blocks so their storage is only
+    //! allocated once. Only touched by the master.
+    std::vector<std::unique_ptr<Batch>> vBatches;
+    size_t nBatchesUsed;
+
+    //! Number of batches added but not finished yet.
+    std::atomic<unsigned int> nTodo;
+
+    //! The temporary evaluation result.
+    std::atomic<bool> fAllOk;
+
+    //! The number of workers asleep, or about to be.
+    std::atomic<int> nIdle;
+
+    //! Mutex for sleeping and waking up only
+    boost::mutex mutex;
+
+    //! Worker threads block on this when out of work
+    boost::condition_variable condWorker;
+
+    //! Master thread blocks on this until all batches are finished
+    boost::condition_variable condMaster;
+
+    //! The maximum number of elements in one batch
+    unsigned int nBatchSize;
+
+    //! Append a batch at the bottom. Master only.
+    void Push(Batch* batch)
+    {
+        const int64_t b = nBottom.load(std::memory_order_relaxed);
+        const int64_t t = nTop.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > a->nSize - 1) {
+            Array* grown = new Array(a->nSize * 2);
+            for (int64_t i = t; i < b; i++)
+                grown->Put(i, a->Get(i));
+            vRetired.emplace_back(a);
+            array.store(grown, std::memory_order_release);
+            a = grown;
+        }
+        a->Put(b, batch);
+        nBottom.store(b + 1, std::memory_order_release);
+    }
+
+    //! Remove the newest batch, or return nullptr if there is none. Master only.
+    Batch* Take()
+    {
+        const int64_t b = nBottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        nBottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = nTop.load(std::memory_order_relaxed);
+        Batch* batch = nullptr;
+        if (t <= b) {
+            batch = a->Get(b);
+            if (t == b) {
+                // Last one: race the thieves for it.
+                if (!nTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    batch = nullptr;
+                nBottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            nBottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return batch;
+    }
+
+    /**
+     * Remove the oldest batch. Returns false if there is none; otherwise
+     * batch is set to it, or to nullptr if another thread claimed it first.
+     */
+    bool Steal(Batch*& batch)
+    {
+        batch = nullptr;
+        int64_t t = nTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = nBottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        Array* a = array.load(std::memory_order_acquire);
+        Batch* stolen = a->Get(t);
+        if (nTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            batch = stolen;
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return nTop.load() >= nBottom.load();
+    }
+
+    //! Run (or skip, once something failed) the checks in a batch and destroy them.
+    void Run(Batch* batch)
+    {
+        bool fOk = fAllOk.load(std::memory_order_relaxed) && CheckBatch(batch->vChecks);
+        batch->vChecks.clear();
+        if (!fOk)
+            fAllOk.store(false, std::memory_order_relaxed);
+        if (nTodo.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            // We finished the last batch; the master may be waiting for it.
+            boost::unique_lock<boost::mutex> lock(mutex);
+            condMaster.notify_one();
+        }
+    }
+
+public:
+    //! Mutex to ensure only one concurrent CCheckQueueControl
+    boost::mutex ControlMutex;
+
+    //! Create a new check queue
+    CWorkStealingCheckQueue(unsigned int nBatchSizeIn) : nTop(0), nBottom(0), array(new Array(64)), nBatchesUsed(0), nTodo(0), fAllOk(true), nIdle(0), nBatchSize(std::max(1U, nBatchSizeIn)) {}
+
+    //! Worker thread
+    void Thread()
+    {
+        Batch* batch;
+        while (true) {
+            if (Steal(batch)) {
+                if (batch != nullptr)
+                    Run(batch);
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            // Announce we are going to sleep before looking at the deque a
+            // last time; Add looks at nIdle after publishing its batches, so
+            // one of the two sees the other.
+            nIdle++;
+            while (Empty())
+                condWorker.wait(lock);
+            nIdle--;
+        }
+    }
+
+    //! Wait until execution finishes, and return whether all evaluations were successful.
+    bool Wait()
+    {
+        while (Batch* batch = Take())
+            Run(batch);
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (nTodo.load(std::memory_order_acquire) != 0)
+                condMaster.wait(lock);
+        }
+        // Every batch is finished, so none of them is referenced anymore.
+        nBatchesUsed = 0;
+        bool fRet = fAllOk.load(std::memory_order_relaxed);
+        // reset the status for new work later
+        fAllOk.store(true, std::memory_order_relaxed);
+        return fRet;
+    }
+
+    //! Add a batch of checks to the queue
+    void Add(std::vector<T>& vChecks)
+    {
+        if (vChecks.empty())
+            return;
+        const unsigned int nNewBatches = (vChecks.size() + nBatchSize - 1) / nBatchSize;
+        nTodo.fetch_add(nNewBatches, std::memory_order_relaxed);
+        for (size_t nStart = 0; nStart < vChecks.size(); nStart += nBatchSize) {
+            if (nBatchesUsed == vBatches.size()) {
+                vBatches.emplace_back(new Batch());
+                vBatches.back()->vChecks.reserve(nBatchSize);
+            }
+            Batch* batch = vBatches[nBatchesUsed++].get();
+            const size_t nEnd = std::min(vChecks.size(), nStart + nBatchSize);
+            for (size_t i = nStart; i < nEnd; i++) {
+                batch->vChecks.emplace_back();
+                batch->vChecks.back().swap(vChecks[i]);
+            }
+            Push(batch);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (nIdle.load() > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (nNewBatches == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
+    }
+
+    ~CWorkStealingCheckQueue()
+    {
+        delete array.load();
+    }
+};
+
+/** 
+ * RAII-style controller object for a CCheckQueue (or a queue with the same
+ * interface) that guarantees the passed queue is finished before continuing.
+ */
+template <typename T, typename Q>
 class CCheckQueueControl
 {
 private:
-    CCheckQueue<T> * const pqueue;
+    Q * const pqueue;
     bool fDone;
 
 public:
     CCheckQueueControl() = delete;
     CCheckQueueControl(const CCheckQueueControl&) = delete;
     CCheckQueueControl& operator=(const CCheckQueueControl&) = delete;
-    explicit CCheckQueueControl(CCheckQueue<T> * const pqueueIn) : pqueue(pqueueIn), fDone(false)
+    explicit CCheckQueueControl(Q * const pqueueIn) : pqueue(pqueueIn), fDone(false)
     {
         // passed queue is supposed to be unused, or nullptr
         if (pqueue != nullptr) {
@@ -0,0 +1,186 @@
+// Copyright (c) 2010 Satoshi Nakamoto
+// Copyright (c) 2009-2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinstats.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "hash.h"
+#include "serialize.h"
+#include "streams.h"
+#include "sync.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/thread.hpp> // boost::this_thread::interruption_point
+
+static uint64_t GetBogoSize(const CScript& scriptPubKey)
+{
+    return 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+           2 /* scriptPubKey len */ + scriptPubKey.size() /* scriptPubKey */;
+}
+
+void ApplyCoinsStats(CCoinsStats& stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+{
+    assert(!outputs.empty());
+    ss << hash;
+    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase);
+    stats.nTransactions++;
+    for (const auto& output : outputs) {
+        ss << VARINT(output.first + 1);
+        ss << output.second.out.scriptPubKey;
+        ss << VARINT(output.second.out.nValue);
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += output.second.out.nValue;
+        stats.nBogoSize += GetBogoSize(output.second.out.scriptPubKey);
+    }
+    ss << VARINT(0);
+}
+
+bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    stats.hashBlock = pcursor->GetBestBlock();
+    {
+        LOCK(cs_main);
+        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
+    }
+    ss << stats.hashBlock;
+    uint256 prevkey;
+    std::map<uint32_t, Coin> outputs;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+            if (!outputs.empty() && key.hash != prevkey) {
+                ApplyCoinsStats(stats, ss, prevkey, outputs);
+                outputs.clear();
+            }
+            prevkey = key.hash;
+            outputs[key.n] = std::move(coin);
+        } else {
+            return error("%s: unable to read value", __func__);
+        }
+        pcursor->Next();
+    }
+    if (!outputs.empty()) {
+        ApplyCoinsStats(stats, ss, prevkey, outputs);
+    }
+    stats.hashSerialized = ss.GetHash();
+    stats.nDiskSize = view->EstimateSize();
+    return true;
+}
+
+/** The MuHash element for a coin: outpoint, height and coinbase flag, and the output. */
+static CDataStream SerializeCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << outpoint;
+    ss << (uint32_t)(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+    return ss;
+}
+
+void CIncrementalCoinsStats::AddCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss = SerializeCoin(outpoint, coin);
+    muhash.Insert((const unsigned char*)ss.data(), ss.size());
+    nTransactionOutputs++;
+    nTotalAmount += coin.out.nValue;
+    nBogoSize += GetBogoSize(coin.out.scriptPubKey);
+}
+
+void CIncrementalCoinsStats::RemoveCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss = SerializeCoin(outpoint, coin);
+    muhash.Remove((const unsigned char*)ss.data(), ss.size());
+    nTransactionOutputs--;
+    nTotalAmount -= coin.out.nValue;
+    nBogoSize -= GetBogoSize(coin.out.scriptPubKey);
+}
+
+CIncrementalCoinsStats& CIncrementalCoinsStats::operator+=(const CIncrementalCoinsStats& other)
+{
+    muhash *= other.muhash;
+    nTransactionOutputs += other.nTransactionOutputs;
+    nTotalAmount += other.nTotalAmount;
+    nBogoSize += other.nBogoSize;
+    return *this;
+}
+
+uint256 CIncrementalCoinsStats::GetHash() const
+{
+    MuHash3072 tmp(muhash);
+    uint256 hash;
+    tmp.Finalize(hash.begin());
+    return hash;
+}
+
+/** Add the coins from pcursor up to (not including) txids starting with byte nEnd; 256 means no limit. */
+static void ScanCoinsRange(CCoinsViewCursor* pcursor, int nEnd, CIncrementalCoinsStats& stats, std::atomic<bool>& fFailed)
+{
+    while (pcursor->Valid() && !fFailed) {
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key)) break;
+        if (*key.hash.begin() >= nEnd) break;
+        if (!pcursor->GetValue(coin)) {
+            fFailed = true;
+            break;
+        }
+        stats.AddCoin(key, coin);
+        pcursor->Next();
+    }
+}
+
+bool ComputeCoinsStats(CCoinsViewDB* view, CIncrementalCoinsStats& stats, int nThreads)
+{
+    nThreads = std::max(1, std::min(nThreads, 256));
+
+    // Partition the txid space on its first byte, which is also the first
+    // byte of the database key after the prefix.
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    std::vector<int> vEnd;
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < nThreads; i++) {
+            uint256 start;
+            *start.begin() = (unsigned char)(256 * i / nThreads);
+            cursors.emplace_back(view->Cursor(start));
+            vEnd.push_back(256 * (i + 1) / nThreads);
+        }
+    }
+
+    std::vector<CIncrementalCoinsStats> parts(nThreads);
+    std::atomic<bool> fFailed(false);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; i++) {
+        threads.emplace_back(ScanCoinsRange, cursors[i].get(), vEnd[i], std::ref(parts[i]), std::ref(fFailed));
+    }
+    ScanCoinsRange(cursors[0].get(), vEnd[0], parts[0], fFailed);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (fFailed) {
+        return error("%s: unable to read value", __func__);
+    }
+
+    stats = CIncrementalCoinsStats();
+    stats.hashBlock = cursors[0]->GetBestBlock();
+    for (const CIncrementalCoinsStats& part : parts) {
+        stats += part;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2010 Satoshi Nakamoto
+// Copyright (c) 2009-2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSTATS_H
+#define BITCOIN_COINSTATS_H
+
+#include "amount.h"
+#include "crypto/muhash.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <stdint.h>
+
+class CCoinsView;
+class CCoinsViewDB;
+class CHashWriter;
+class Coin;
+class COutPoint;
+
+struct CCoinsStats
+{
+    int nHeight;
+    uint256 hashBlock;
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    uint64_t nBogoSize;
+    uint256 hashSerialized;
+    uint64_t nDiskSize;
+    CAmount nTotalAmount;
+
+    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nBogoSize(0), nDiskSize(0), nTotalAmount(0) {}
+};
+
+/** Add all unspent outputs of one transaction to the statistics and the serialized hash */
+void ApplyCoinsStats(CCoinsStats& stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs);
+
+//! Calculate statistics about the unspent transaction output set
+bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats);
+
+/**
+ * UTXO set statistics that can be updated one coin at a time: the number of
+ * coins, their total amount and bogosize, and a MuHash3072 of the set. These
+ * are maintained as blocks are connected and disconnected (see -utxostats),
+ * and can be recomputed in parallel since the set hash is order-independent.
+ */
+class CIncrementalCoinsStats
+{
+public:
+    //! The block whose UTXO set these statistics describe
+    uint256 hashBlock;
+    uint64_t nTransactionOutputs;
+    uint64_t nBogoSize;
+    CAmount nTotalAmount;
+    MuHash3072 muhash;
+
+    CIncrementalCoinsStats() : nTransactionOutputs(0), nBogoSize(0), nTotalAmount(0) {}
+
+    void AddCoin(const COutPoint& outpoint, const Coin& coin);
+    void RemoveCoin(const COutPoint& outpoint, const Coin& coin);
+    //! Merge in the statistics of a disjoint set of coins
+    CIncrementalCoinsStats& operator+=(const CIncrementalCoinsStats& other);
+    //! Finalized hash of the set; does not modify the running state
+    uint256 GetHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(VARINT(nTransactionOutputs));
+        READWRITE(VARINT(nBogoSize));
+        READWRITE(nTotalAmount);
+        READWRITE(muhash);
+    }
+};
+
+/**
+ * Compute incremental statistics from scratch by scanning the coins database
+ * with nThreads threads, each covering a range of txids. All range cursors are
+ * opened under cs_main, so they see the same database state.
+ */
+bool ComputeCoinsStats(CCoinsViewDB* view, CIncrementalCoinsStats& stats, int nThreads);
+
+#endif // BITCOIN_COINSTATS_H
@@ -183,3 +183,14 @@ uint64_t CTxOutCompressor::DecompressAmount(uint64_t x)
     }
     return n;
 }
+
+bool CBlockCompressor::IsLossless(const CBlock& block)
+{
+    for (const CTransactionRef& tx : block.vtx) {
+        for (const CTxOut& txout : tx->vout) {
+            if (!MoneyRange(txout.nValue) || txout.scriptPubKey.size() > MAX_SCRIPT_SIZE)
+                return false;
+        }
+    }
+    return true;
+}
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_COMPRESSOR_H
 #define BITCOIN_COMPRESSOR_H
 
+#include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "serialize.h"
@@ -118,4 +119,130 @@ public:
     }
 };
 
+/**
+ * wrapper for CTransactionRef that provides a more compact serialization:
+ * outputs go through CTxOutCompressor, and the version, prevout indices,
+ * sequence numbers and lock time, which are usually small or close to their
+ * maximum, are stored as VARINTs.
+ */
+class CTxCompressor
+{
+private:
+    //! Set in the flags byte when the inputs carry witnesses
+    static const unsigned char FLAG_WITNESS = 0x01;
+
+    CTransactionRef &tx;
+
+public:
+    CTxCompressor(CTransactionRef &txIn) : tx(txIn) { }
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        uint32_t nVersion = tx->nVersion;
+        s << VARINT(nVersion);
+        const unsigned char nFlags = tx->HasWitness() ? FLAG_WITNESS : 0;
+        s << nFlags;
+        WriteCompactSize(s, tx->vin.size());
+        for (const CTxIn& txin : tx->vin) {
+            s << txin.prevout.hash;
+            // The null index of coinbase inputs wraps around to 0.
+            uint32_t nIndex = txin.prevout.n + 1;
+            s << VARINT(nIndex);
+            s << *(const CScriptBase*)(&txin.scriptSig);
+            uint32_t nSequence = ~txin.nSequence;
+            s << VARINT(nSequence);
+        }
+        WriteCompactSize(s, tx->vout.size());
+        for (const CTxOut& txout : tx->vout) {
+            s << CTxOutCompressor(REF(txout));
+        }
+        if (nFlags & FLAG_WITNESS) {
+            for (const CTxIn& txin : tx->vin) {
+                s << txin.scriptWitness.stack;
+            }
+        }
+        uint32_t nLockTime = tx->nLockTime;
+        s << VARINT(nLockTime);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        CMutableTransaction mtx;
+        uint32_t nVersion = 0;
+        s >> VARINT(nVersion);
+        mtx.nVersion = nVersion;
+        unsigned char nFlags = 0;
+        s >> nFlags;
+        if (nFlags & ~FLAG_WITNESS)
+            throw std::ios_base::failure("Unknown transaction flags");
+        // Grow the vectors as elements are read, like vector deserialization does.
+        for (uint64_t n = ReadCompactSize(s); n > 0; n--) {
+            mtx.vin.emplace_back();
+            CTxIn& txin = mtx.vin.back();
+            s >> txin.prevout.hash;
+            uint32_t nIndex = 0;
+            s >> VARINT(nIndex);
+            txin.prevout.n = nIndex - 1;
+            s >> *(CScriptBase*)(&txin.scriptSig);
+            uint32_t nSequence = 0;
+            s >> VARINT(nSequence);
+            txin.nSequence = ~nSequence;
+        }
+        for (uint64_t n = ReadCompactSize(s); n > 0; n--) {
+            mtx.vout.emplace_back();
+            s >> REF(CTxOutCompressor(mtx.vout.back()));
+        }
+        if (nFlags & FLAG_WITNESS) {
+            for (CTxIn& txin : mtx.vin) {
+                s >> txin.scriptWitness.stack;
+            }
+            if (!mtx.HasWitness())
+                throw std::ios_base::failure("Superfluous witness record");
+        }
+        uint32_t nLockTime = 0;
+        s >> VARINT(nLockTime);
+        mtx.nLockTime = nLockTime;
+        tx = MakeTransactionRef(std::move(mtx));
+    }
+};
+
+/**
+ * wrapper for CBlock that serializes its transactions through CTxCompressor.
+ * Used for blocks stored with -compressblocks.
+ */
+class CBlockCompressor
+{
+private:
+    CBlock &block;
+
+public:
+    /**
+     * Whether the compact serialization reproduces the block exactly. It does
+     * not for amounts outside of the money range or for output scripts longer
+     * than MAX_SCRIPT_SIZE, which CScriptCompressor does not keep.
+     */
+    static bool IsLossless(const CBlock& block);
+
+    CBlockCompressor(CBlock &blockIn) : block(blockIn) { }
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << static_cast<const CBlockHeader&>(block);
+        WriteCompactSize(s, block.vtx.size());
+        for (const CTransactionRef& tx : block.vtx) {
+            s << CTxCompressor(REF(tx));
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        block.SetNull();
+        s >> static_cast<CBlockHeader&>(block);
+        for (uint64_t n = ReadCompactSize(s); n > 0; n--) {
+            block.vtx.emplace_back();
+            s >> REF(CTxCompressor(block.vtx.back()));
+        }
+    }
+};
+
 #endif // BITCOIN_COMPRESSOR_H
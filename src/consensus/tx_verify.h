@@ -10,6 +10,7 @@
 
 class CBlockIndex;
 class CCoinsViewCache;
+class Coin;
 class CTransaction;
 class CValidationState;
 
@@ -54,6 +55,16 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& ma
  */
 int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& inputs, int flags);
 
+/**
+ * Compute total signature operation cost of a transaction whose inputs are
+ * already spent, such as one connected to the chain.
+ * @param[in] tx     Transaction for which we are computing the cost
+ * @param[in] spent  The coins spent by each input, as kept for undo
+ * @param[out] flags Script verification flags
+ * @return Total signature operation cost of tx
+ */
+int64_t GetTransactionSigOpCost(const CTransaction& tx, const std::vector<Coin>& spent, int flags);
+
 /**
  * Check if transaction is final and can be included in a block with the
  * specified height and time. Consensus critical.
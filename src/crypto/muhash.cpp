@@ -0,0 +1,175 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/chacha20.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <assert.h>
+#include <string.h>
+
+namespace {
+
+/** 2^3072 - p, where p is the largest 3072-bit safe prime */
+const uint32_t MAX_PRIME_DIFF = 1103717;
+
+Num3072 ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char key[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(key);
+    unsigned char bytes[Num3072::BYTE_SIZE];
+    ChaCha20(key, sizeof(key)).Output(bytes, sizeof(bytes));
+    return Num3072(bytes);
+}
+
+} // namespace
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        limbs[i] = ReadLE32(data + 4 * i);
+    }
+    if (IsOverflow()) FullReduce();
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    memset(limbs + 1, 0, sizeof(limbs) - sizeof(limbs[0]));
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        WriteLE32(out + 4 * i, limbs[i]);
+    }
+}
+
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= 0xFFFFFFFFUL - MAX_PRIME_DIFF) return false;
+    for (int i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != 0xFFFFFFFFUL) return false;
+    }
+    return true;
+}
+
+void Num3072::FullReduce()
+{
+    // Subtracting p is adding MAX_PRIME_DIFF and dropping the carry out of the top limb.
+    uint64_t carry = MAX_PRIME_DIFF;
+    for (int i = 0; i < LIMBS && carry != 0; ++i) {
+        uint64_t cur = (uint64_t)limbs[i] + carry;
+        limbs[i] = (uint32_t)cur;
+        carry = cur >> 32;
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    // Schoolbook product into 2 * LIMBS limbs. The inputs are only read here,
+    // so a may alias *this.
+    uint32_t tmp[LIMBS * 2] = {0};
+    for (int i = 0; i < LIMBS; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < LIMBS; ++j) {
+            uint64_t cur = (uint64_t)limbs[i] * a.limbs[j] + tmp[i + j] + carry;
+            tmp[i + j] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        tmp[i + LIMBS] = (uint32_t)carry;
+    }
+
+    // Reduce using 2^3072 = MAX_PRIME_DIFF (mod p): lo + hi * 2^3072 = lo + hi * MAX_PRIME_DIFF.
+    uint64_t carry = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        uint64_t cur = (uint64_t)tmp[i] + (uint64_t)tmp[i + LIMBS] * MAX_PRIME_DIFF + carry;
+        limbs[i] = (uint32_t)cur;
+        carry = cur >> 32;
+    }
+    // Fold whatever spilled over the top limb back in the same way. The second
+    // round (if any) only carries a single bit into a small number, so this ends.
+    while (carry != 0) {
+        uint64_t add = carry * MAX_PRIME_DIFF;
+        for (int i = 0; i < LIMBS && add != 0; ++i) {
+            uint64_t cur = (uint64_t)limbs[i] + add;
+            limbs[i] = (uint32_t)cur;
+            add = cur >> 32;
+        }
+        carry = add;
+    }
+    if (IsOverflow()) FullReduce();
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // Fermat: a^-1 = a^(p-2). The exponent is 95 limbs of all ones followed by
+    // the low limb 2^32 - MAX_PRIME_DIFF - 2, so first build a^(2^32-1) and reuse it.
+    Num3072 x32 = *this;
+    for (int bits = 1; bits < 32; bits *= 2) {
+        Num3072 t = x32;
+        for (int i = 0; i < bits; ++i) t.Multiply(t);
+        t.Multiply(x32);
+        x32 = t;
+    }
+
+    Num3072 r = x32;
+    for (int limb = 1; limb < LIMBS - 1; ++limb) {
+        for (int i = 0; i < 32; ++i) r.Multiply(r);
+        r.Multiply(x32);
+    }
+    const uint32_t low = 0xFFFFFFFFUL - MAX_PRIME_DIFF - 1;
+    for (int bit = 31; bit >= 0; --bit) {
+        r.Multiply(r);
+        if ((low >> bit) & 1) r.Multiply(*this);
+    }
+    return r;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+MuHash3072::MuHash3072(const unsigned char* data, size_t len) : numerator(ToNum3072(data, len))
+{
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(unsigned char out[OUTPUT_SIZE])
+{
+    numerator.Divide(denominator);
+    denominator.SetToOne();
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    numerator.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(out);
+}
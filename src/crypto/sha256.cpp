@@ -191,6 +191,31 @@ std::string SHA256AutoDetect()
     return "standard";
 }
 
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks)
+{
+    // The padding of a 64 byte message, as a block of its own
+    unsigned char padding1[64] = {0x80};
+    padding1[62] = 0x02;
+    // The inner hash, padded as a 32 byte message
+    unsigned char buffer2[64] = {0};
+    buffer2[32] = 0x80;
+    buffer2[62] = 0x01;
+    uint32_t s[8];
+    for (size_t i = 0; i < blocks; i++) {
+        sha256::Initialize(s);
+        Transform(s, input + 64 * i, 1);
+        Transform(s, padding1, 1);
+        for (int j = 0; j < 8; j++) {
+            WriteBE32(buffer2 + 4 * j, s[j]);
+        }
+        sha256::Initialize(s);
+        Transform(s, buffer2, 1);
+        for (int j = 0; j < 8; j++) {
+            WriteBE32(output + 32 * i + 4 * j, s[j]);
+        }
+    }
+}
+
 ////// SHA-256
 
 CSHA256::CSHA256() : bytes(0)
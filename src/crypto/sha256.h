@@ -26,6 +26,13 @@ public:
     CSHA256& Reset();
 };
 
+/** Compute the double-SHA256 of each of a series of 64 byte inputs, such as
+ *  the pairs of hashes of a merkle tree level. Output i may overlap inputs
+ *  at or before i, so a level can be hashed in place.
+ *  output: blocks*32 bytes, input: blocks*64 bytes.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 /** Autodetect the best available SHA256 implementation.
  *  Returns the name of the implementation.
  */
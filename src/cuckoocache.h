@@ -22,7 +22,8 @@
  *
  * 2) cache is a cache which is performant in memory usage and lookup speed. It
  * is lockfree for erase operations. Elements are lazily erased on the next
- * insert.
+ * insert. A one byte fingerprint per slot lets lookups skip the full
+ * comparison (and the cache miss it costs) for nearly all non-matching slots.
  */
 namespace CuckooCache
 {
@@ -163,6 +164,12 @@ private:
     /** table stores all the elements */
     std::vector<Element> table;
 
+    /** fingerprints stores a byte of hash of each element in table, so that
+     * probing a slot only loads the element itself when the byte matches.
+     * Being 1/sizeof(Element) of the table, it mostly stays in the CPU cache.
+     */
+    std::vector<uint8_t> fingerprints;
+
     /** size stores the total available slots in the hash table */
     uint32_t size;
 
@@ -252,6 +259,36 @@ private:
                  (uint32_t)((hash_function.template operator()<7>(e) * (uint64_t)size) >> 32)}};
     }
 
+    /** compute_fingerprint derives the fingerprint of e from the low bits of
+     * its first hash, which compute_hashes all but discards.
+     *
+     * @param e the element whose fingerprint will be returned
+     * @returns the fingerprint stored alongside e
+     */
+    inline uint8_t compute_fingerprint(const Element& e) const
+    {
+        return (uint8_t)hash_function.template operator()<0>(e);
+    }
+
+    /** prefetch asks the CPU to start loading the fingerprints of all
+     * locations, rather than waiting on each in turn.
+     */
+    inline void prefetch(const std::array<uint32_t, 8>& locs) const
+    {
+#if defined(__GNUC__)
+        for (uint32_t loc : locs)
+            __builtin_prefetch(&fingerprints[loc]);
+#endif
+    }
+
+    /** matches checks whether slot loc holds e, comparing the element only if
+     * the fingerprint matches.
+     */
+    inline bool matches(uint32_t loc, const Element& e, uint8_t fingerprint) const
+    {
+        return fingerprints[loc] == fingerprint && table[loc] == e;
+    }
+
     /* end
      * @returns a constexpr index that can never be inserted to */
     constexpr uint32_t invalid() const
@@ -324,7 +361,7 @@ public:
     /** You must always construct a cache with some elements via a subsequent
      * call to setup or setup_bytes, otherwise operations may segfault.
      */
-    cache() : table(), size(), collection_flags(0), epoch_flags(),
+    cache() : table(), fingerprints(), size(), collection_flags(0), epoch_flags(),
     epoch_heuristic_counter(), epoch_size(), depth_limit(0), hash_function()
     {
     }
@@ -343,6 +380,7 @@ public:
         depth_limit = static_cast<uint8_t>(std::log2(static_cast<float>(std::max((uint32_t)2, new_size))));
         size = std::max<uint32_t>(2, new_size);
         table.resize(size);
+        fingerprints.assign(size, compute_fingerprint(Element()));
         collection_flags.setup(size);
         epoch_flags.resize(size);
         // Set to 45% as described above
@@ -355,9 +393,9 @@ public:
     /** setup_bytes is a convenience function which accounts for internal memory
      * usage when deciding how many elements to store. It isn't perfect because
      * it doesn't account for any overhead (struct size, MallocUsage, collection
-     * and epoch flags). This was done to simplify selecting a power of two
-     * size. In the expected use case, an extra two bits per entry should be
-     * negligible compared to the size of the elements.
+     * and epoch flags, fingerprints). This was done to simplify selecting a
+     * power of two size. In the expected use case, an extra byte and two bits
+     * per entry should be negligible compared to the size of the elements.
      *
      * @param bytes the approximate number of bytes to use for this data
      * structure.
@@ -388,20 +426,24 @@ public:
      * now in the table, one previously inserted element is evicted from the
      * table, the entry attempted to be inserted is evicted.
      *
+     * @returns false if an element which was not marked for garbage
+     * collection had to be evicted, true otherwise
      */
-    inline void insert(Element e)
+    inline bool insert(Element e)
     {
         epoch_check();
         uint32_t last_loc = invalid();
         bool last_epoch = true;
         std::array<uint32_t, 8> locs = compute_hashes(e);
+        uint8_t fingerprint = compute_fingerprint(e);
+        prefetch(locs);
         // Make sure we have not already inserted this element
         // If we have, make sure that it does not get deleted
         for (uint32_t loc : locs)
-            if (table[loc] == e) {
+            if (matches(loc, e, fingerprint)) {
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return true;
             }
         for (uint8_t depth = 0; depth < depth_limit; ++depth) {
             // First try to insert to an empty slot, if one exists
@@ -409,9 +451,10 @@ public:
                 if (!collection_flags.bit_is_set(loc))
                     continue;
                 table[loc] = std::move(e);
+                fingerprints[loc] = fingerprint;
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return true;
             }
             /** Swap with the element at the location that was
             * not the last one looked at. Example:
@@ -429,6 +472,7 @@ public:
             */
             last_loc = locs[(1 + (std::find(locs.begin(), locs.end(), last_loc) - locs.begin())) & 7];
             std::swap(table[last_loc], e);
+            std::swap(fingerprints[last_loc], fingerprint);
             // Can't std::swap a std::vector<bool>::reference and a bool&.
             bool epoch = last_epoch;
             last_epoch = epoch_flags[last_loc];
@@ -437,6 +481,7 @@ public:
             // Recompute the locs -- unfortunately happens one too many times!
             locs = compute_hashes(e);
         }
+        return false;
     }
 
     /* contains iterates through the hash locations for a given element
@@ -467,14 +512,31 @@ public:
     inline bool contains(const Element& e, const bool erase) const
     {
         std::array<uint32_t, 8> locs = compute_hashes(e);
+        uint8_t fingerprint = compute_fingerprint(e);
+        prefetch(locs);
         for (uint32_t loc : locs)
-            if (table[loc] == e) {
+            if (matches(loc, e, fingerprint)) {
                 if (erase)
                     allow_erase(loc);
                 return true;
             }
         return false;
     }
+
+    /** for_each calls f on every element which is not marked for garbage
+     * collection, e.g. to save the cache to disk.
+     *
+     * Not threadsafe with respect to insert.
+     *
+     * @param f a callable taking a const Element&
+     */
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (uint32_t i = 0; i < size; ++i)
+            if (!collection_flags.bit_is_set(i))
+                f(table[i]);
+    }
 };
 } // namespace CuckooCache
 
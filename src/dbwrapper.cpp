@@ -4,8 +4,13 @@
 
 #include "dbwrapper.h"
 
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
 #include "fs.h"
 #include "util.h"
+#include "utilstrencodings.h"
 #include "random.h"
 
 #include <leveldb/cache.h>
@@ -14,6 +19,11 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
+#include <sstream>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -73,14 +83,151 @@ public:
     }
 };
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+/** Block cache that counts lookups, so the hit rate can be reported. */
+class CCountingCache : public leveldb::Cache
+{
+private:
+    leveldb::Cache* const cache;
+
+public:
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    explicit CCountingCache(size_t capacity) : cache(leveldb::NewLRUCache(capacity)), hits(0), misses(0) {}
+    ~CCountingCache() { delete cache; }
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge, void (*deleter)(const leveldb::Slice& key, void* value)) override
+    {
+        return cache->Insert(key, value, charge, deleter);
+    }
+    Handle* Lookup(const leveldb::Slice& key) override
+    {
+        Handle* handle = cache->Lookup(key);
+        if (handle) {
+            hits++;
+        } else {
+            misses++;
+        }
+        return handle;
+    }
+    void Release(Handle* handle) override { cache->Release(handle); }
+    void* Value(Handle* handle) override { return cache->Value(handle); }
+    void Erase(const leveldb::Slice& key) override { cache->Erase(key); }
+    uint64_t NewId() override { return cache->NewId(); }
+    void Prune() override { cache->Prune(); }
+    size_t TotalCharge() const override { return cache->TotalCharge(); }
+};
+
+static std::atomic<int> nDBMaxOpenFiles(MIN_DB_MAX_OPEN_FILES);
+
+/** Profiles that -dboption can refer to */
+static const std::vector<std::string> DB_PROFILE_NAMES = {"chainstate", "index", "txindex", "scripthashindex"};
+
+void SetDBMaxOpenFiles(int nMaxOpenFiles)
+{
+    nDBMaxOpenFiles = std::max(nMaxOpenFiles, MIN_DB_MAX_OPEN_FILES);
+}
+
+bool DBCompressionAvailable()
+{
+#ifdef HAVE_SNAPPY
+    return true;
+#else
+    return false;
+#endif
+}
+
+/** Split -dboption=<profile>:<option>:<value> into its parts. */
+static bool ParseDBOption(const std::string& arg, std::string& name, std::string& option, int64_t& value, std::string& strError)
+{
+    std::vector<std::string> vParts;
+    boost::split(vParts, arg, boost::is_any_of(":"));
+    if (vParts.size() != 3 || !ParseInt64(vParts[2], &value)) {
+        strError = strprintf("Invalid -dboption=%s, expected <profile>:<option>:<value>", arg);
+        return false;
+    }
+    name = vParts[0];
+    option = vParts[1];
+    return true;
+}
+
+/** Apply one option to profile. nCacheSize is the budget the cache split is computed from. */
+static bool SetDBOption(DBProfile& profile, size_t nCacheSize, const std::string& option, int64_t value, std::string& strError)
+{
+    if (option == "compression" && (value == 0 || value == 1)) {
+        profile.compression = value;
+    } else if (option == "bloombits" && value >= 0 && value <= 32) {
+        profile.bloom_bits_per_key = value;
+    } else if (option == "blocksize" && value >= 1024 && value <= (4 << 20)) {
+        profile.block_size = value;
+    } else if (option == "writebuffer" && value >= 1 && value <= 45) {
+        // Percentage of the budget per memtable; the block cache gets what the two memtables leave.
+        profile.write_buffer_size = nCacheSize * value / 100;
+        profile.block_cache_size = nCacheSize - 2 * profile.write_buffer_size;
+    } else {
+        strError = strprintf("Invalid -dboption value %d for option '%s'", value, option);
+        return false;
+    }
+    return true;
+}
+
+DBProfile GetDBProfile(const std::string& name, size_t nCacheSize)
+{
+    DBProfile profile;
+    profile.name = name;
+    profile.block_cache_size = nCacheSize / 2;
+    profile.write_buffer_size = nCacheSize / 4;
+    profile.block_size = 4 * 1024;
+    profile.bloom_bits_per_key = 10;
+    profile.compression = false;
+    profile.max_open_files = nDBMaxOpenFiles;
+    if (name == "index" || name == "txindex") {
+        // The block index is written a few entries per block and read back
+        // once at startup, while transaction index lookups are random reads:
+        // favour the block cache over memtables.
+        profile.write_buffer_size = nCacheSize / 8;
+        profile.block_cache_size = nCacheSize - 2 * profile.write_buffer_size;
+    }
+
+    for (const std::string& arg : gArgs.GetArgs("-dboption")) {
+        std::string strName, strOption, strError;
+        int64_t value;
+        if (ParseDBOption(arg, strName, strOption, value, strError) && strName == name) {
+            SetDBOption(profile, nCacheSize, strOption, value, strError);
+        }
+    }
+    return profile;
+}
+
+bool CheckDBOptions(std::string& strError)
+{
+    for (const std::string& arg : gArgs.GetArgs("-dboption")) {
+        std::string strName, strOption;
+        int64_t value;
+        if (!ParseDBOption(arg, strName, strOption, value, strError)) {
+            return false;
+        }
+        if (std::find(DB_PROFILE_NAMES.begin(), DB_PROFILE_NAMES.end(), strName) == DB_PROFILE_NAMES.end()) {
+            strError = strprintf("Unknown database profile '%s' in -dboption", strName);
+            return false;
+        }
+        DBProfile profile;
+        if (!SetDBOption(profile, 0, strOption, value, strError)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static leveldb::Options GetOptions(const DBProfile& profile)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.block_cache = new CCountingCache(profile.block_cache_size);
+    options.write_buffer_size = profile.write_buffer_size;
+    options.block_size = profile.block_size;
+    options.filter_policy = profile.bloom_bits_per_key > 0 ? leveldb::NewBloomFilterPolicy(profile.bloom_bits_per_key) : nullptr;
+    options.compression = profile.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = profile.max_open_files;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -90,14 +237,19 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate) :
+    CDBWrapper(path, GetDBProfile("", nCacheSize), fMemory, fWipe, obfuscate)
+{
+}
+
+CDBWrapper::CDBWrapper(const fs::path& path, const DBProfile& profileIn, bool fMemory, bool fWipe, bool obfuscate) : profile(profileIn)
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -111,6 +263,12 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
         TryCreateDirectories(path);
         LogPrintf("Opening LevelDB in %s\n", path.string());
     }
+    if (profile.compression && !DBCompressionAvailable()) {
+        LogPrintf("LevelDB was built without Snappy, compression for %s has no effect\n", path.string());
+    }
+    LogPrint(BCLog::LEVELDB, "LevelDB profile %s: block cache %u, write buffer %u, block size %u, bloom bits %d, compression %d, max open files %d\n",
+        profile.name.empty() ? "default" : profile.name, profile.block_cache_size, profile.write_buffer_size, profile.block_size,
+        profile.bloom_bits_per_key, profile.compression, profile.max_open_files);
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
@@ -182,6 +340,42 @@ std::vector<unsigned char> CDBWrapper::CreateObfuscateKey() const
 
 }
 
+DBStats CDBWrapper::GetStats() const
+{
+    DBStats stats;
+    const CCountingCache* cache = static_cast<const CCountingCache*>(options.block_cache);
+    stats.cache_hits = cache->hits;
+    stats.cache_misses = cache->misses;
+    stats.cache_usage = cache->TotalCharge();
+
+    std::string strValue;
+    stats.memory_usage = 0;
+    if (pdb->GetProperty("leveldb.approximate-memory-usage", &strValue)) {
+        stats.memory_usage = atoi64(strValue);
+    }
+
+    // Compaction totals are only available in the human-readable stats table.
+    std::map<int, DBStats::Level> mapLevels;
+    if (pdb->GetProperty("leveldb.stats", &strValue)) {
+        std::istringstream table(strValue);
+        std::string line;
+        while (std::getline(table, line)) {
+            int level;
+            DBStats::Level entry;
+            if (sscanf(line.c_str(), "%d %d %lf %lf %lf %lf", &level, &entry.files, &entry.size_mb, &entry.compaction_sec, &entry.read_mb, &entry.write_mb) == 6) {
+                mapLevels[level] = entry;
+            }
+        }
+    }
+    for (int level = 0; ; level++) {
+        if (!pdb->GetProperty("leveldb.num-files-at-level" + std::to_string(level), &strValue)) break;
+        DBStats::Level entry = {0, 0, 0, 0, 0};
+        if (mapLevels.count(level)) entry = mapLevels[level];
+        stats.levels.push_back(entry);
+    }
+    return stats;
+}
+
 bool CDBWrapper::IsEmpty()
 {
     std::unique_ptr<CDBIterator> it(NewIterator());
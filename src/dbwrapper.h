@@ -19,6 +19,11 @@
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+//! Table files each database may keep open when no file descriptor budget was assigned (see SetDBMaxOpenFiles)
+static const int MIN_DB_MAX_OPEN_FILES = 64;
+//! -dbmaxopenfiles default; the budget actually used is capped by the available file descriptors
+static const int DEFAULT_DB_MAX_OPEN_FILES = 1000;
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -43,6 +48,62 @@ const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w);
 
 };
 
+/**
+ * LevelDB tuning for one database. Every database opens with the defaults of
+ * its named profile, see GetDBProfile(); individual settings can be
+ * overridden with -dboption=<profile>:<option>:<value>.
+ */
+struct DBProfile
+{
+    std::string name;
+    //! Size of the LRU cache of uncompressed table blocks
+    size_t block_cache_size;
+    //! Size of a memtable; up to two may be held in memory simultaneously
+    size_t write_buffer_size;
+    //! Approximate size of uncompressed data per table block
+    size_t block_size;
+    //! Bloom filter bits per key, 0 for no filter
+    int bloom_bits_per_key;
+    //! Snappy-compress table blocks (ignored if LevelDB was built without Snappy)
+    bool compression;
+    int max_open_files;
+};
+
+/**
+ * Profile for the named database ("chainstate" or "index") with an nCacheSize
+ * byte budget for its block cache and memtables. Unknown names get the
+ * generic defaults.
+ */
+DBProfile GetDBProfile(const std::string& name, size_t nCacheSize);
+
+/** Check all -dboption arguments. Returns false with strError set on the first invalid one. */
+bool CheckDBOptions(std::string& strError);
+
+/** Set the number of table files each database opened from now on may keep open. */
+void SetDBMaxOpenFiles(int nMaxOpenFiles);
+
+/** Whether LevelDB was built with Snappy, i.e. whether DBProfile::compression has any effect. */
+bool DBCompressionAvailable();
+
+/** Statistics reported by a database, see CDBWrapper::GetStats(). */
+struct DBStats
+{
+    struct Level {
+        int files;
+        double size_mb;
+        //! Cumulative compaction work into this level since startup
+        double compaction_sec;
+        double read_mb;
+        double write_mb;
+    };
+    std::vector<Level> levels;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    size_t cache_usage;
+    //! Memtables plus block cache, as estimated by LevelDB
+    size_t memory_usage;
+};
+
 /** Batch of changes queued to be written to a CDBWrapper */
 class CDBBatch
 {
@@ -180,6 +241,9 @@ private:
     //! custom environment this database is using (may be nullptr in case of default environment)
     leveldb::Env* penv;
 
+    //! profile the database was opened with
+    DBProfile profile;
+
     //! database options used
     leveldb::Options options;
 
@@ -219,6 +283,8 @@ public:
      *                        with a zero'd byte array.
      */
     CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    /** As above, with the LevelDB settings taken from profileIn instead of derived from a cache size. */
+    CDBWrapper(const fs::path& path, const DBProfile& profileIn, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -306,6 +372,11 @@ public:
      */
     bool IsEmpty();
 
+    const DBProfile& GetProfile() const { return profile; }
+
+    /** Per-level sizes and compaction totals, block cache hit rate and memory usage. */
+    DBStats GetStats() const;
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
@@ -0,0 +1,313 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/base.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "init.h"
+#include "tinyformat.h"
+#include "ui_interface.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "warnings.h"
+
+#include <functional>
+
+static const char DB_BEST_BLOCK = 'B';
+
+//! Seconds between progress messages while an index catches up
+static const int64_t SYNC_LOG_INTERVAL = 30;
+
+template<typename... Args>
+static void FatalError(const char* fmt, const Args&... args)
+{
+    std::string strMessage = tfm::format(fmt, args...);
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"),
+                                     "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+/**
+ * Locator for pindex. Unlike CChain::GetLocator() this only follows the
+ * immutable pprev/pskip links of the block index, so it needs no cs_main.
+ */
+static CBlockLocator GetLocator(const CBlockIndex* pindex)
+{
+    std::vector<uint256> vHave;
+    int nStep = 1;
+    while (pindex) {
+        vHave.push_back(pindex->GetBlockHash());
+        if (pindex->nHeight == 0)
+            break;
+        pindex = pindex->GetAncestor(std::max(pindex->nHeight - nStep, 0));
+        if (vHave.size() > 10)
+            nStep *= 2;
+    }
+    return CBlockLocator(vHave);
+}
+
+/** The active chain block to index after pindexPrev, which must be on the active chain; nullptr at the tip. */
+static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindexPrev)
+{
+    AssertLockHeld(cs_main);
+    if (!pindexPrev) {
+        return chainActive.Genesis();
+    }
+    return chainActive.Next(pindexPrev);
+}
+
+BaseIndex::DB::DB(const fs::path& path, const DBProfile& profile, bool fMemory, bool fWipe) :
+    CDBWrapper(path, profile, fMemory, fWipe)
+{
+}
+
+bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
+{
+    bool fSuccess = Read(DB_BEST_BLOCK, locator);
+    if (!fSuccess) {
+        locator.SetNull();
+    }
+    return fSuccess;
+}
+
+void BaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator)
+{
+    batch.Write(DB_BEST_BLOCK, locator);
+}
+
+BaseIndex::BaseIndex() : fSynced(false), pindexBest(nullptr), fInterrupted(false)
+{
+}
+
+BaseIndex::~BaseIndex()
+{
+    Stop();
+}
+
+void BaseIndex::Start()
+{
+    CBlockLocator locator;
+    GetDB().ReadBestBlock(locator);
+    if (!locator.IsNull()) {
+        LOCK(cs_main);
+        // Resume from the indexed block itself even if it has left the active
+        // chain since, so that CatchUp() rewinds its entries.
+        BlockMap::iterator mi = mapBlockIndex.find(locator.vHave[0]);
+        pindexBest = mi != mapBlockIndex.end() ? mi->second : FindForkInGlobalIndex(chainActive, locator);
+    }
+
+    RegisterValidationInterface(this);
+    threadSync = std::thread(&TraceThread<std::function<void()>>, GetName(),
+                             std::function<void()>(std::bind(&BaseIndex::ThreadSync, this)));
+}
+
+void BaseIndex::Interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_queue);
+        fInterrupted = true;
+    }
+    condQueue.notify_all();
+}
+
+void BaseIndex::Stop()
+{
+    if (!threadSync.joinable())
+        return;
+    UnregisterValidationInterface(this);
+    Interrupt();
+    threadSync.join();
+}
+
+void BaseIndex::ThreadSync()
+{
+    while (!fInterrupted) {
+        if (!fSynced) {
+            if (!CatchUp())
+                return;
+            Synced();
+            continue;
+        }
+
+        std::shared_ptr<const CBlock> pblock;
+        const CBlockIndex* pindex;
+        {
+            std::unique_lock<std::mutex> lock(cs_queue);
+            while (queue.empty() && fSynced && !fInterrupted) {
+                condQueue.wait(lock);
+            }
+            if (queue.empty())
+                continue;
+            pblock = queue.front().first;
+            pindex = queue.front().second;
+            queue.pop_front();
+        }
+        if (!IndexQueuedBlock(*pblock, pindex))
+            return;
+    }
+}
+
+bool BaseIndex::CatchUp()
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    const int nThreads = std::max(1, GetNumCores());
+    int64_t nLastLog = GetTime();
+
+    while (!fInterrupted) {
+        std::vector<const CBlockIndex*> vBlocks;
+        const CBlockIndex* pindexFork = nullptr;
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindex = pindexBest;
+            if (pindex && !chainActive.Contains(pindex)) {
+                // The chain has moved away from the indexed blocks.
+                pindexFork = chainActive.FindFork(pindex);
+            } else {
+                while ((int)vBlocks.size() < INDEX_SYNC_BATCH_BLOCKS && (pindex = NextSyncBlock(pindex))) {
+                    vBlocks.push_back(pindex);
+                }
+                if (vBlocks.empty()) {
+                    // BlockConnected() also runs under cs_main, so from here on
+                    // it queues exactly the blocks connected after the tip we
+                    // have reached.
+                    fSynced = true;
+                    const CBlockIndex* pindexTip = pindexBest;
+                    LogPrintf("%s is enabled at height %d\n", GetName(), pindexTip ? pindexTip->nHeight : -1);
+                    return true;
+                }
+            }
+        }
+
+        if (pindexFork) {
+            if (!Rewind(pindexBest, pindexFork))
+                return false;
+            continue;
+        }
+
+        // Read and index contiguous ranges of the round on separate threads,
+        // each into its own batch, and write the batches in chain order.
+        const int nWorkers = std::min<int>(nThreads, vBlocks.size());
+        std::vector<std::unique_ptr<CDBBatch>> batches;
+        for (int i = 0; i < nWorkers; i++) {
+            batches.emplace_back(new CDBBatch(GetDB()));
+        }
+        std::atomic<bool> fFailed(false);
+        auto worker = [&](int nWorker) {
+            size_t nBegin = vBlocks.size() * nWorker / nWorkers;
+            size_t nEnd = vBlocks.size() * (nWorker + 1) / nWorkers;
+            for (size_t i = nBegin; i < nEnd && !fFailed && !fInterrupted; i++) {
+                CBlock block;
+                if (!ReadBlockFromDisk(block, vBlocks[i], consensusParams) ||
+                    !WriteBlock(*batches[nWorker], block, vBlocks[i])) {
+                    fFailed = true;
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (int i = 1; i < nWorkers; i++) {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        if (fFailed) {
+            FatalError("%s: Failed to index blocks %d to %d for %s", __func__,
+                       vBlocks.front()->nHeight, vBlocks.back()->nHeight, GetName());
+            return false;
+        }
+        if (fInterrupted)
+            return false;
+
+        for (const auto& batch : batches) {
+            GetDB().WriteBatch(*batch);
+        }
+        if (!Commit(vBlocks.back()))
+            return false;
+
+        if (GetTime() >= nLastLog + SYNC_LOG_INTERVAL) {
+            LogPrintf("Syncing %s with block chain from height %d\n", GetName(), vBlocks.back()->nHeight);
+            nLastLog = GetTime();
+        }
+    }
+    return false;
+}
+
+bool BaseIndex::IndexQueuedBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // After a reorg the block connects to an ancestor of the last indexed
+    // block, and the blocks in between are rewound first.
+    const CBlockIndex* pindexPrev = pindexBest;
+    if (pindexPrev ? pindexPrev->GetAncestor(pindex->nHeight - 1) != pindex->pprev : pindex->nHeight != 0) {
+        LogPrintf("%s: WARNING: Block %s does not connect to the indexed chain (best %s), not indexing it in %s\n", __func__,
+                  pindex->GetBlockHash().ToString(), pindexPrev ? pindexPrev->GetBlockHash().ToString() : "none", GetName());
+        return true;
+    }
+    if (pindexPrev && pindexPrev != pindex->pprev && !Rewind(pindexPrev, pindex->pprev))
+        return false;
+
+    CDBBatch batch(GetDB());
+    if (!WriteBlock(batch, block, pindex)) {
+        FatalError("%s: Failed to write block %s to %s", __func__, pindex->GetBlockHash().ToString(), GetName());
+        return false;
+    }
+    GetDB().WriteBestBlock(batch, GetLocator(pindex));
+    GetDB().WriteBatch(batch);
+    pindexBest = pindex;
+    return true;
+}
+
+bool BaseIndex::Commit(const CBlockIndex* pindex)
+{
+    CDBBatch batch(GetDB());
+    GetDB().WriteBestBlock(batch, GetLocator(pindex));
+    if (!GetDB().WriteBatch(batch)) {
+        FatalError("%s: Failed to commit latest %s state", __func__, GetName());
+        return false;
+    }
+    pindexBest = pindex;
+    return true;
+}
+
+bool BaseIndex::Rewind(const CBlockIndex* pindexCurrent, const CBlockIndex* pindexNew)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    CDBBatch batch(GetDB());
+    for (const CBlockIndex* pindex = pindexCurrent; pindex != pindexNew; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensusParams) || !EraseBlock(batch, block, pindex)) {
+            FatalError("%s: Failed to rewind %s from block %s", __func__, GetName(), pindex->GetBlockHash().ToString());
+            return false;
+        }
+    }
+    GetDB().WriteBestBlock(batch, GetLocator(pindexNew));
+    GetDB().WriteBatch(batch);
+    pindexBest = pindexNew;
+    LogPrint(BCLog::LEVELDB, "%s: %s rewound to height %d\n", __func__, GetName(), pindexNew ? pindexNew->nHeight : -1);
+    return true;
+}
+
+void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    // Called with cs_main held, like the hand-over at the end of CatchUp().
+    if (!fSynced)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(cs_queue);
+        if (queue.size() >= MAX_INDEX_QUEUE_BLOCKS) {
+            // Rather than holding on to ever more blocks, let the sync thread
+            // read them back from disk once it gets there.
+            queue.clear();
+            fSynced = false;
+        } else {
+            queue.emplace_back(block, pindex);
+        }
+    }
+    condQueue.notify_one();
+}
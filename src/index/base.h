@@ -0,0 +1,122 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BASE_H
+#define BITCOIN_INDEX_BASE_H
+
+#include "dbwrapper.h"
+#include "primitives/block.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+
+//! Blocks a caught-up index may have queued before it falls back to reading them from disk
+static const size_t MAX_INDEX_QUEUE_BLOCKS = 1000;
+//! Blocks read from disk per round while an index catches up with the chain
+static const int INDEX_SYNC_BATCH_BLOCKS = 1000;
+
+/**
+ * Base class for optional indexes that are kept in their own database and
+ * follow the active chain in the background.
+ *
+ * After Start() a sync thread catches the index up with the active chain
+ * from the block files, reading and indexing blocks on several threads and
+ * committing them in chain order. Once it has caught up, blocks connected
+ * afterwards are queued by BlockConnected() and written by the same thread,
+ * so connecting a tip never waits for the index. If validation outruns the
+ * index by more than MAX_INDEX_QUEUE_BLOCKS, the queue is dropped and the
+ * index catches up from disk again.
+ *
+ * Every commit stores a locator of the last indexed block next to its
+ * entries, which is where an interrupted index resumes. Blocks the active
+ * chain has moved away from are handed to EraseBlock() before indexing
+ * continues on the new branch.
+ */
+class BaseIndex : public CValidationInterface
+{
+protected:
+    class DB : public CDBWrapper
+    {
+    public:
+        DB(const fs::path& path, const DBProfile& profile, bool fMemory = false, bool fWipe = false);
+
+        bool ReadBestBlock(CBlockLocator& locator) const;
+        void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
+    };
+
+private:
+    //! Whether the index has caught up with the active chain and BlockConnected() queues blocks
+    std::atomic<bool> fSynced;
+    //! Last block whose entries have been committed, nullptr if none
+    std::atomic<const CBlockIndex*> pindexBest;
+    std::atomic<bool> fInterrupted;
+
+    std::thread threadSync;
+
+    std::mutex cs_queue;
+    std::condition_variable condQueue;
+    std::deque<std::pair<std::shared_ptr<const CBlock>, const CBlockIndex*>> queue;
+
+    void ThreadSync();
+    /** Index blocks from disk until the active chain tip is reached. Returns false on failure or interruption. */
+    bool CatchUp();
+    /** Index one queued block. */
+    bool IndexQueuedBlock(const CBlock& block, const CBlockIndex* pindex);
+    /** Write the locator of pindex as the new best block. */
+    bool Commit(const CBlockIndex* pindex);
+    /** Erase the blocks after its ancestor pindexNew from the index, starting at pindexCurrent. */
+    bool Rewind(const CBlockIndex* pindexCurrent, const CBlockIndex* pindexNew);
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+
+    /**
+     * Add the entries of a block to batch. While catching up this is called
+     * from several threads at once, each with its own batch, so
+     * implementations must not modify shared state.
+     */
+    virtual bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) = 0;
+
+    /**
+     * Remove the entries of a block that was disconnected from the active
+     * chain. By default they are left in place, for indexes whose entries
+     * remain valid or are superseded when the data is connected again.
+     */
+    virtual bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) { return true; }
+
+    /** Called on the sync thread each time the index has caught up with the active chain. */
+    virtual void Synced() {}
+
+    virtual DB& GetDB() const = 0;
+
+    /** Name used in log messages and for the sync thread. */
+    virtual const char* GetName() const = 0;
+
+public:
+    BaseIndex();
+    virtual ~BaseIndex();
+
+    /** Start following the chain. Must be called once the block index has been loaded. */
+    void Start();
+    /** Ask the sync thread to stop at the next opportunity. */
+    void Interrupt();
+    /** Stop following the chain and wait for the sync thread to exit. */
+    void Stop();
+
+    /** Whether the index has caught up with the active chain. */
+    bool IsSynced() const { return fSynced; }
+    /** Last indexed block, nullptr if the index is empty. */
+    const CBlockIndex* GetBestBlockIndex() const { return pindexBest; }
+};
+
+#endif // BITCOIN_INDEX_BASE_H
@@ -0,0 +1,157 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/scripthashindex.h"
+
+#include "chain.h"
+#include "coins.h"
+#include "crypto/sha256.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+
+#include <utility>
+
+static const char DB_SCRIPTHASH = 's';
+
+std::unique_ptr<ScriptHashIndex> g_scripthashindex;
+
+namespace {
+
+struct ScriptHashKey
+{
+    uint256 scripthash;
+    ScriptHashPosition pos;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_SCRIPTHASH);
+        s << scripthash << pos;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        if (ser_readdata8(s) != DB_SCRIPTHASH)
+            throw std::ios_base::failure("Invalid format for script hash index key");
+        s >> scripthash >> pos;
+    }
+};
+
+/**
+ * Call f(key, entry) for every output of block paying to a spendable script
+ * and every input, keyed by the script of the output it spends.
+ */
+template<typename F>
+bool ForEachEntry(const CBlock& block, const CBlockIndex* pindex, F f)
+{
+    // The genesis coinbase is not spendable and has no undo data.
+    if (pindex->nHeight == 0)
+        return true;
+
+    CBlockUndo blockundo;
+    if (!UndoReadFromDisk(blockundo, pindex))
+        return false;
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: undo data does not match block %s", __func__, pindex->GetBlockHash().ToString());
+
+    ScriptHashKey key;
+    ScriptHashEntry entry;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+        for (uint32_t n = 0; n < tx.vout.size(); n++) {
+            const CTxOut& out = tx.vout[n];
+            if (out.scriptPubKey.IsUnspendable())
+                continue;
+            key.scripthash = GetScriptHash(out.scriptPubKey);
+            entry.pos = key.pos = ScriptHashPosition(pindex->nHeight, txid, false, n);
+            entry.nValue = out.nValue;
+            entry.prevout.SetNull();
+            f(key, entry);
+        }
+        if (i == 0)
+            continue;
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        if (txundo.vprevout.size() != tx.vin.size())
+            return error("%s: undo data does not match transaction %s", __func__, txid.ToString());
+        for (uint32_t n = 0; n < tx.vin.size(); n++) {
+            const Coin& coin = txundo.vprevout[n];
+            key.scripthash = GetScriptHash(coin.out.scriptPubKey);
+            entry.pos = key.pos = ScriptHashPosition(pindex->nHeight, txid, true, n);
+            entry.nValue = coin.out.nValue;
+            entry.prevout = tx.vin[n].prevout;
+            f(key, entry);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+uint256 GetScriptHash(const CScript& scriptPubKey)
+{
+    uint256 hash;
+    CSHA256().Write(scriptPubKey.data(), scriptPubKey.size()).Finalize(hash.begin());
+    return hash;
+}
+
+ScriptHashIndex::ScriptHashIndex(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(new BaseIndex::DB(GetDataDir() / "indexes" / "scripthash", GetDBProfile("scripthashindex", nCacheSize), fMemory, fWipe))
+{
+}
+
+ScriptHashIndex::~ScriptHashIndex()
+{
+    // Stop the sync thread before the database it writes to goes away.
+    Stop();
+}
+
+bool ScriptHashIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    return ForEachEntry(block, pindex, [&batch](const ScriptHashKey& key, const ScriptHashEntry& entry) {
+        // Outputs only need their amount, spends also the output they spend.
+        if (entry.pos.fSpend) {
+            batch.Write(key, std::make_pair(entry.nValue, entry.prevout));
+        } else {
+            batch.Write(key, entry.nValue);
+        }
+    });
+}
+
+bool ScriptHashIndex::EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    return ForEachEntry(block, pindex, [&batch](const ScriptHashKey& key, const ScriptHashEntry& entry) {
+        batch.Erase(key);
+    });
+}
+
+bool ScriptHashIndex::FindEntries(const uint256& scripthash, const ScriptHashPosition& start, size_t nMax, std::vector<ScriptHashEntry>& entries) const
+{
+    ScriptHashKey key;
+    key.scripthash = scripthash;
+    key.pos = start;
+
+    std::unique_ptr<CDBIterator> pcursor(db->NewIterator());
+    pcursor->Seek(key);
+    while (entries.size() < nMax && pcursor->Valid()) {
+        if (!pcursor->GetKey(key) || key.scripthash != scripthash)
+            break;
+        ScriptHashEntry entry;
+        entry.pos = key.pos;
+        if (key.pos.fSpend) {
+            std::pair<CAmount, COutPoint> value;
+            if (!pcursor->GetValue(value))
+                return error("%s: unable to read value", __func__);
+            entry.nValue = value.first;
+            entry.prevout = value.second;
+        } else if (!pcursor->GetValue(entry.nValue)) {
+            return error("%s: unable to read value", __func__);
+        }
+        entries.push_back(entry);
+        pcursor->Next();
+    }
+    return true;
+}
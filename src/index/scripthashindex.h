@@ -0,0 +1,101 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SCRIPTHASHINDEX_H
+#define BITCOIN_INDEX_SCRIPTHASHINDEX_H
+
+#include "amount.h"
+#include "crypto/common.h"
+#include "index/base.h"
+#include "primitives/transaction.h"
+#include "script/script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <memory>
+#include <vector>
+
+/** SHA256 of a scriptPubKey, the key of the script hash index. */
+uint256 GetScriptHash(const CScript& scriptPubKey);
+
+/**
+ * Where an entry sorts in the history of a script hash: by height, then
+ * txid, outputs before spends, then output or input number. Serialized
+ * big-endian so that the database orders entries the same way.
+ */
+struct ScriptHashPosition
+{
+    int nHeight;
+    uint256 txid;
+    bool fSpend;
+    uint32_t n;
+
+    ScriptHashPosition() : nHeight(0), fSpend(false), n(0) {}
+    ScriptHashPosition(int nHeightIn, const uint256& txidIn, bool fSpendIn, uint32_t nIn) :
+        nHeight(nHeightIn), txid(txidIn), fSpend(fSpendIn), n(nIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        unsigned char buf[4];
+        WriteBE32(buf, nHeight);
+        s.write((const char*)buf, sizeof(buf));
+        s << txid;
+        ser_writedata8(s, fSpend);
+        WriteBE32(buf, n);
+        s.write((const char*)buf, sizeof(buf));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char buf[4];
+        s.read((char*)buf, sizeof(buf));
+        nHeight = ReadBE32(buf);
+        s >> txid;
+        fSpend = ser_readdata8(s);
+        s.read((char*)buf, sizeof(buf));
+        n = ReadBE32(buf);
+    }
+};
+
+/** An output paying to a script, or an input spending such an output. */
+struct ScriptHashEntry
+{
+    ScriptHashPosition pos;
+    CAmount nValue;
+    //! The output spent, for spends
+    COutPoint prevout;
+
+    ScriptHashEntry() : nValue(0) {}
+};
+
+/**
+ * Index of the outputs paying to and inputs spending from each script,
+ * keyed by GetScriptHash() (-scripthashindex). Kept in
+ * indexes/scripthash/ and built in the background, see BaseIndex.
+ */
+class ScriptHashIndex final : public BaseIndex
+{
+private:
+    std::unique_ptr<BaseIndex::DB> db;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+    bool EraseBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+    BaseIndex::DB& GetDB() const override { return *db; }
+    const char* GetName() const override { return "scripthashindex"; }
+
+public:
+    explicit ScriptHashIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~ScriptHashIndex();
+
+    /** Up to nMax entries for scripthash, in order, starting at start. */
+    bool FindEntries(const uint256& scripthash, const ScriptHashPosition& start, size_t nMax, std::vector<ScriptHashEntry>& entries) const;
+};
+
+/** The script hash index, nullptr unless -scripthashindex is set. */
+extern std::unique_ptr<ScriptHashIndex> g_scripthashindex;
+
+#endif // BITCOIN_INDEX_SCRIPTHASHINDEX_H
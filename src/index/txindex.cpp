@@ -0,0 +1,94 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "index/txindex.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+
+static const char DB_TXINDEX = 't';
+
+std::unique_ptr<TxIndex> g_txindex;
+
+TxIndex::TxIndex(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(new BaseIndex::DB(GetDataDir() / "indexes" / "txindex", GetDBProfile("txindex", nCacheSize), fMemory, fWipe))
+{
+}
+
+TxIndex::~TxIndex()
+{
+    // Stop the sync thread before the database it writes to goes away.
+    Stop();
+}
+
+bool TxIndex::WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex)
+{
+    // The genesis coinbase is not spendable and was never indexed.
+    if (pindex->nHeight == 0)
+        return true;
+
+    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+    for (const CTransactionRef& tx : block.vtx) {
+        batch.Write(std::make_pair(DB_TXINDEX, tx->GetHash()), pos);
+        pos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
+    }
+    return true;
+}
+
+void TxIndex::Synced()
+{
+    // This index has replaced the one older versions kept in the block index
+    // database, whose entries can go now.
+    if (!pblocktree->EraseLegacyTxIndex())
+        LogPrintf("%s: failed to erase the old transaction index entries from the block index database\n", __func__);
+}
+
+bool TxIndex::FindTx(const uint256& txid, uint256& hashBlock, CTransactionRef& tx) const
+{
+    CDiskTxPos postx;
+    if (!db->Read(std::make_pair(DB_TXINDEX, txid), postx))
+        return false;
+
+    // Offsets are into the standard serialization, so transactions in blocks
+    // stored compactly are looked up in the decoded block.
+    unsigned int nBlockSize;
+    bool fCompact;
+    if (!ReadBlockRecordHeader(postx, Params().MessageStart(), nBlockSize, fCompact))
+        return error("%s: ReadBlockRecordHeader failed", __func__);
+    if (fCompact) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, postx, Params().GetConsensus()))
+            return error("%s: ReadBlockFromDisk failed", __func__);
+        for (const CTransactionRef& txBlock : block.vtx) {
+            if (txBlock->GetHash() == txid) {
+                tx = txBlock;
+                hashBlock = block.GetHash();
+                return true;
+            }
+        }
+        return error("%s: txid not found in block", __func__);
+    }
+
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: OpenBlockFile failed", __func__);
+    CBlockHeader header;
+    try {
+        file >> header;
+        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR))
+            return error("%s: fseek(...) failed", __func__);
+        file >> tx;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    if (tx->GetHash() != txid)
+        return error("%s: txid mismatch", __func__);
+    hashBlock = header.GetHash();
+    return true;
+}
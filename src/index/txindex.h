@@ -0,0 +1,39 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_TXINDEX_H
+#define BITCOIN_INDEX_TXINDEX_H
+
+#include "index/base.h"
+#include "primitives/transaction.h"
+
+#include <memory>
+
+/**
+ * Maps txids to the on-disk position of the transaction (-txindex). Kept in
+ * indexes/txindex/ and built in the background, see BaseIndex.
+ */
+class TxIndex final : public BaseIndex
+{
+private:
+    std::unique_ptr<BaseIndex::DB> db;
+
+protected:
+    bool WriteBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex) override;
+    void Synced() override;
+    BaseIndex::DB& GetDB() const override { return *db; }
+    const char* GetName() const override { return "txindex"; }
+
+public:
+    explicit TxIndex(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~TxIndex();
+
+    /** Look up a confirmed transaction. On success, tx is set and hashBlock is the hash of the block containing it. */
+    bool FindTx(const uint256& txid, uint256& hashBlock, CTransactionRef& tx) const;
+};
+
+/** The transaction index, nullptr unless -txindex is set. */
+extern std::unique_ptr<TxIndex> g_txindex;
+
+#endif // BITCOIN_INDEX_TXINDEX_H
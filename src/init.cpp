@@ -11,6 +11,7 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "blockcache.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -19,6 +20,8 @@
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "index/scripthashindex.h"
+#include "index/txindex.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -34,6 +37,7 @@
 #include "script/standard.h"
 #include "script/sigcache.h"
 #include "scheduler.h"
+#include "startupprofile.h"
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -69,6 +73,8 @@
 #endif
 
 bool fFeeEstimatesInitialized = false;
+//! Whether -checklevel asks for levels that are checked once the node is up
+static bool fVerifyInBackground = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_DISABLE_SAFEMODE = false;
@@ -90,6 +96,20 @@ static CZMQNotificationInterface* pzmqNotificationInterface = nullptr;
 #define MIN_CORE_FILEDESCRIPTORS 150
 #endif
 
+//! LevelDB databases that are always open: the chain state and the block index
+static const int LEVELDB_CORE_DATABASES = 2;
+
+/** Number of LevelDB databases that will be open, the enabled indexes included */
+static int GetLevelDBDatabases()
+{
+    int nDatabases = LEVELDB_CORE_DATABASES;
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
+        nDatabases++;
+    if (gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX))
+        nDatabases++;
+    return nDatabases;
+}
+
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
 
 //////////////////////////////////////////////////////////////////////////////
@@ -125,6 +145,10 @@ void StartShutdown()
 {
     fRequestShutdown = true;
 }
+void AbortShutdown()
+{
+    fRequestShutdown = false;
+}
 bool ShutdownRequested()
 {
     return fRequestShutdown;
@@ -167,6 +191,10 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptTorControl();
     if (g_connman)
         g_connman->Interrupt();
+    if (g_txindex)
+        g_txindex->Interrupt();
+    if (g_scripthashindex)
+        g_scripthashindex->Interrupt();
     threadGroup.interrupt_all();
 }
 
@@ -204,10 +232,16 @@ void Shutdown()
     if(g_connman) g_connman->Stop();
     peerLogic.reset();
     g_connman.reset();
+    g_txindex.reset();
+    g_scripthashindex.reset();
+    StopBackgroundVerifyDB();
 
     StopTorControl();
     if (fDumpMempoolLater && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
+        if (gArgs.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIGCACHE)) {
+            DumpSignatureCaches();
+        }
     }
 
     if (fFeeEstimatesInitialized)
@@ -251,6 +285,7 @@ void Shutdown()
         delete pblocktree;
         pblocktree = nullptr;
     }
+    StopBlockFileFlusher();
 #ifdef ENABLE_WALLET
     for (CWalletRef pwallet : vpwallets) {
         pwallet->Flush(true);
@@ -347,10 +382,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("Print this help message and exit"));
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-blockcachesize=<n>", strprintf(_("Keep recently connected and requested blocks in up to <n> megabytes of memory (0 to disable, at most %d, default: %d)"), MAX_BLOCK_CACHE_SIZE, DEFAULT_BLOCK_CACHE_SIZE));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-compressblocks", strprintf(_("Store new blocks in a compact encoding. Blocks stored either way stay readable; -reindex rewrites the block files to match (default: %u)"), DEFAULT_COMPRESS_BLOCKS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -363,6 +400,8 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
     }
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbmaxopenfiles=<n>", strprintf(_("Allow each database to keep up to <n> table files open, as far as file descriptors allow (%d or more, default: %d)"), MIN_DB_MAX_OPEN_FILES, DEFAULT_DB_MAX_OPEN_FILES));
+    strUsage += HelpMessageOpt("-dboption=<profile>:<option>:<value>", _("Override a LevelDB setting of the chainstate, index, txindex or scripthashindex database. Options: compression (0/1, needs Snappy), bloombits (bloom filter bits per key, 0 to disable), blocksize (bytes), writebuffer (percent of the database's cache per memtable). Can be specified multiple times"));
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
@@ -373,13 +412,14 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()));
     }
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
+    strUsage += HelpMessageOpt("-persistsigcache", strprintf(_("Whether to save the signature and script execution caches along with the mempool (default: %u)"), DEFAULT_PERSIST_SIGCACHE));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
-    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex, -scripthashindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
@@ -387,7 +427,9 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifndef WIN32
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
-    strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-scripthashindex", strprintf(_("Maintain an index of the outputs paying to and the inputs spending from every script, used by the getscripthashhistory rpc call. It is built in the background and can be enabled at any time (default: %u)"), DEFAULT_SCRIPTHASHINDEX));
+    strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call. It is built in the background and can be enabled at any time (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-utxostats", strprintf(_("Maintain UTXO set statistics as blocks are connected, so gettxoutsetinfo can answer immediately with hash_type muhash or none (default: %u)"), DEFAULT_UTXOSTATS));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -446,7 +488,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
     {
         strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
-        strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+        strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u). Levels 3 and 4 run in the background once the node is up"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
@@ -642,18 +684,8 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
 
     // -reindex
     if (fReindex) {
-        int nFile = 0;
-        while (true) {
-            CDiskBlockPos pos(nFile, 0);
-            if (!fs::exists(GetBlockPosFilename(pos, "blk")))
-                break; // No block files left to reindex
-            FILE *file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(chainparams, file, &pos);
-            nFile++;
-        }
+        StartupPhase phase("reindex");
+        ReindexBlockFiles(chainparams);
         pblocktree->WriteReindexing(false);
         fReindex = false;
         LogPrintf("Reindexing finished\n");
@@ -661,6 +693,7 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
         LoadGenesisBlock(chainparams);
     }
 
+    StartupPhase phaseImport("importblocks");
     // hardcoded $DATADIR/bootstrap.dat
     fs::path pathBootstrap = GetDataDir() / "bootstrap.dat";
     if (fs::exists(pathBootstrap)) {
@@ -686,7 +719,10 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
         }
     }
 
+    phaseImport.End();
+
     // scan for better chains in the block chain database, that are not yet connected in the active best chain
+    StartupPhase phaseActivate("activatebestchain");
     CValidationState state;
     if (!ActivateBestChain(state, chainparams)) {
         LogPrintf("Failed to connect best block");
@@ -699,9 +735,19 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
     }
     } // End scope of CImportingNow
     if (gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        StartupPhase phase("loadmempool");
+        // Load the caches first so that the mempool transactions find their
+        // signatures in them.
+        if (gArgs.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIGCACHE)) {
+            LoadSignatureCaches();
+        }
         LoadMempool();
         fDumpMempoolLater = !fRequestShutdown;
     }
+    if (fVerifyInBackground && !fRequestShutdown) {
+        StartBackgroundVerifyDB(chainparams, gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL), gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS));
+    }
+    DumpStartupProfile();
 }
 
 /** Sanity checks
@@ -839,6 +885,7 @@ ServiceFlags nRelevantServices = NODE_NETWORK;
 int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
+int nDBMaxOpenFiles;
 ServiceFlags nLocalServices = NODE_NETWORK;
 
 } // namespace
@@ -911,10 +958,12 @@ bool AppInitParameterInteraction()
 
     // also see: InitParameterInteraction()
 
-    // if using block pruning, then disallow txindex
+    // if using block pruning, then disallow txindex and scripthashindex
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX))
+            return InitError(_("Prune mode is incompatible with -scripthashindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -928,12 +977,37 @@ bool AppInitParameterInteraction()
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
+    // MIN_CORE_FILEDESCRIPTORS covers MIN_DB_MAX_OPEN_FILES table files of the
+    // chain state and the block index; every enabled index needs as many again.
+    const int nDatabases = GetLevelDBDatabases();
+    int nMinCoreFD = MIN_CORE_FILEDESCRIPTORS;
+#ifndef WIN32
+    nMinCoreFD += (nDatabases - LEVELDB_CORE_DATABASES) * MIN_DB_MAX_OPEN_FILES;
+#endif
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
-    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
-    if (nFD < MIN_CORE_FILEDESCRIPTORS)
+    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - nMinCoreFD - MAX_ADDNODE_CONNECTIONS)), 0);
+
+    // More table files per database need extra descriptors. Those must stay
+    // below FD_SETSIZE too, or sockets opened later would get descriptors
+    // select() can't handle.
+    nDBMaxOpenFiles = std::max((int)gArgs.GetArg("-dbmaxopenfiles", DEFAULT_DB_MAX_OPEN_FILES), MIN_DB_MAX_OPEN_FILES);
+    int nDBExtraFD = 0;
+#ifndef WIN32
+    nDBExtraFD = std::max(std::min(nDatabases * (nDBMaxOpenFiles - MIN_DB_MAX_OPEN_FILES),
+                                   (int)(FD_SETSIZE - nBind - nMinCoreFD - MAX_ADDNODE_CONNECTIONS) - nMaxConnections), 0);
+#endif
+    nFD = RaiseFileDescriptorLimit(nMaxConnections + nMinCoreFD + MAX_ADDNODE_CONNECTIONS + nDBExtraFD);
+    if (nFD < nMinCoreFD)
         return InitError(_("Not enough file descriptors available."));
-    nMaxConnections = std::min(nFD - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS, nMaxConnections);
+    // Connections take precedence over extra table files.
+    nDBExtraFD = std::max(std::min(nDBExtraFD, nFD - nMinCoreFD - MAX_ADDNODE_CONNECTIONS - nMaxConnections), 0);
+    nMaxConnections = std::min(nFD - nMinCoreFD - MAX_ADDNODE_CONNECTIONS - nDBExtraFD, nMaxConnections);
+#ifndef WIN32
+    // LevelDB doesn't use file descriptors on Windows, elsewhere it gets what is left.
+    nDBMaxOpenFiles = MIN_DB_MAX_OPEN_FILES + nDBExtraFD / nDatabases;
+#endif
+    SetDBMaxOpenFiles(nDBMaxOpenFiles);
 
     if (nMaxConnections < nUserMaxConnections)
         InitWarning(strprintf(_("Reducing -maxconnections from %d to %d, because of system limitations."), nUserMaxConnections, nMaxConnections));
@@ -991,6 +1065,12 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fUTXOStats = gArgs.GetBoolArg("-utxostats", DEFAULT_UTXOSTATS);
+
+    std::string strDBOptionsError;
+    if (!CheckDBOptions(strDBOptionsError)) {
+        return InitError(strDBOptionsError);
+    }
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1054,6 +1134,8 @@ bool AppInitParameterInteraction()
         fPruneMode = true;
     }
 
+    fCompressBlocks = gArgs.GetBoolArg("-compressblocks", DEFAULT_COMPRESS_BLOCKS);
+
     RegisterAllCoreRPCCommands(tableRPC);
 #ifdef ENABLE_WALLET
     RegisterWalletRPCCommands(tableRPC);
@@ -1227,9 +1309,13 @@ bool AppInitLockDataDirectory()
 bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 {
     const CChainParams& chainparams = Params();
+    StartupPhase phaseInit("init");
     // ********************************************************* Step 4a: application initialization
 
-	Metronome::CMetronomeHelper::LoadMetronomes();
+    {
+        StartupPhase phase("loadmetronomes");
+        Metronome::CMetronomeHelper::LoadMetronomes();
+    }
 
 #ifndef WIN32
     CreatePidFile(GetPidFile(), getpid());
@@ -1249,6 +1335,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using data directory %s\n", GetDataDir().string());
     LogPrintf("Using config file %s\n", GetConfigFile(gArgs.GetArg("-conf", BITCOIN_CONF_FILENAME)).string());
     LogPrintf("Using at most %i automatic connections (%i file descriptors available)\n", nMaxConnections, nFD);
+    LogPrintf("Using at most %i open table files per database\n", nDBMaxOpenFiles);
 
     InitSignatureCache();
     InitScriptExecutionCache();
@@ -1406,9 +1493,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nTotalCache = (gArgs.GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
-    int64_t nBlockTreeDBCache = nTotalCache / 8;
-    nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
+    int64_t nBlockTreeDBCache = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nTxIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
+    nTotalCache -= nTxIndexCache;
+    int64_t nScriptHashIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX) ? nMaxScriptHashIndexCache << 20 : 0);
+    nTotalCache -= nScriptHashIndexCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1416,8 +1506,19 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        LogPrintf("* Using %.1fMiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX)) {
+        LogPrintf("* Using %.1fMiB for script hash index database\n", nScriptHashIndexCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    int64_t nBlockCacheSize = gArgs.GetArg("-blockcachesize", DEFAULT_BLOCK_CACHE_SIZE);
+    nBlockCacheSize = std::max<int64_t>(nBlockCacheSize, 0);
+    nBlockCacheSize = std::min(nBlockCacheSize, MAX_BLOCK_CACHE_SIZE) << 20; // cannot be greater than MAX_BLOCK_CACHE_SIZE
+    blockCache.SetMaxUsage(nBlockCacheSize);
+    LogPrintf("* Using %.1fMiB for recently used blocks\n", nBlockCacheSize * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     while (!fLoaded && !fRequestShutdown) {
@@ -1446,27 +1547,22 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 if (fRequestShutdown) break;
 
-                // LoadBlockIndex will load fTxIndex from the db, or set it if
-                // we're reindexing. It will also load fHavePruned if we've
+                // LoadBlockIndex will load fHavePruned if we've
                 // ever removed a block file from disk.
                 // Note that it also sets fReindex based on the disk flag!
                 // From here on out fReindex and fReset mean something different!
+                StartupPhase phaseLoad("loadblockindex");
                 if (!LoadBlockIndex(chainparams)) {
                     strLoadError = _("Error loading block database");
                     break;
                 }
+                phaseLoad.End();
 
                 // If the loaded chain has a wrong genesis, bail out immediately
                 // (we're likely using a testnet datadir, or the other way around).
                 if (!mapBlockIndex.empty() && mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock) == 0)
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
 
-                // Check for changed -txindex state
-                if (fTxIndex != gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
-                    break;
-                }
-
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1497,10 +1593,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 }
 
                 // ReplayBlocks is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
+                StartupPhase phaseReplay("replayblocks");
                 if (!ReplayBlocks(chainparams, pcoinsdbview)) {
                     strLoadError = _("Unable to replay blocks. You will need to rebuild the database using -reindex-chainstate.");
                     break;
                 }
+                phaseReplay.End();
 
                 // The on-disk coinsdb is now in a good state, create the cache
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
@@ -1545,11 +1643,25 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                         }
                     }
 
-                    if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                    // Only the block files are checked before the node starts. Levels
+                    // that replay blocks on the coins run once it is up.
+                    int nCheckLevel = gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL);
+                    StartupPhase phaseVerify("verifydb");
+                    if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, std::min(nCheckLevel, 2),
                                   gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
                         strLoadError = _("Corrupted block database detected");
                         break;
                     }
+                    phaseVerify.End();
+                    fVerifyInBackground = nCheckLevel >= 3;
+                }
+
+                if (fUTXOStats) {
+                    uiInterface.InitMessage(_("Loading UTXO set statistics..."));
+                    if (!LoadCoinsStats()) {
+                        strLoadError = _("Error loading UTXO set statistics");
+                        break;
+                    }
                 }
             } catch (const std::exception& e) {
                 LogPrintf("%s\n", e.what());
@@ -1599,10 +1711,24 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ::feeEstimator.Read(est_filein);
     fFeeEstimatesInitialized = true;
 
+    // The optional indexes catch up with the chain in the background and
+    // are wiped along with the block index on -reindex.
+    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+        g_txindex.reset(new TxIndex(nTxIndexCache, false, fReindex));
+        g_txindex->Start();
+    }
+    if (gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX)) {
+        g_scripthashindex.reset(new ScriptHashIndex(nScriptHashIndexCache, false, fReindex));
+        g_scripthashindex->Start();
+    }
+
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
-    if (!CWallet::InitLoadWallet())
-        return false;
+    {
+        StartupPhase phase("loadwallets");
+        if (!CWallet::InitLoadWallet())
+            return false;
+    }
 #else
     LogPrintf("No wallet support compiled in!\n");
 #endif
@@ -1653,6 +1779,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         vImportFiles.push_back(strFile);
     }
 
+    StartBlockFileFlusher();
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
     // Wait for genesis block to be processed
@@ -1731,6 +1858,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
+    phaseInit.End();
+    DumpStartupProfile();
 
 #ifdef ENABLE_WALLET
     for (CWalletRef pwallet : vpwallets) {
@@ -17,6 +17,8 @@ class thread_group;
 } // namespace boost
 
 void StartShutdown();
+/** Clear a shutdown request, used only in testing */
+void AbortShutdown();
 bool ShutdownRequested();
 /** Interrupt threads */
 void Interrupt(boost::thread_group& threadGroup);
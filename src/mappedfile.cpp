@@ -0,0 +1,80 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mappedfile.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::~CMappedFile()
+{
+#ifndef WIN32
+    if (nSize > 0) {
+        munmap(const_cast<unsigned char*>(pdata), nSize);
+    }
+#endif
+}
+
+std::shared_ptr<const CMappedFile> CMappedFile::Open(const fs::path& path)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t nSize = st.st_size;
+    void* pdata = mmap(nullptr, nSize, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the file.
+    close(fd);
+    if (pdata == MAP_FAILED)
+        return nullptr;
+    return std::shared_ptr<const CMappedFile>(new CMappedFile(static_cast<const unsigned char*>(pdata), nSize));
+#endif
+}
+
+std::shared_ptr<const CMappedFile> CMappedFileCache::Get(int nFile, const fs::path& path, size_t nMinSize)
+{
+    LOCK(cs);
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        if (it->first != nFile)
+            continue;
+        if (it->second->size() >= nMinSize) {
+            files.splice(files.begin(), files, it);
+            return it->second;
+        }
+        files.erase(it);
+        break;
+    }
+
+    std::shared_ptr<const CMappedFile> file = CMappedFile::Open(path);
+    if (!file || file->size() < nMinSize)
+        return nullptr;
+    files.emplace_front(nFile, file);
+    if (files.size() > nMaxFiles) {
+        files.pop_back();
+    }
+    return file;
+}
+
+void CMappedFileCache::Erase(int nFile)
+{
+    LOCK(cs);
+    files.remove_if([nFile](const std::pair<int, std::shared_ptr<const CMappedFile>>& entry) { return entry.first == nFile; });
+}
+
+void CMappedFileCache::Clear()
+{
+    LOCK(cs);
+    files.clear();
+}
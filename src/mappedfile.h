@@ -0,0 +1,69 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MAPPEDFILE_H
+#define BITCOIN_MAPPEDFILE_H
+
+#include "fs.h"
+#include "sync.h"
+
+#include <list>
+#include <memory>
+#include <stddef.h>
+#include <utility>
+
+/**
+ * A read-only memory mapping of a whole file, as large as the file was when
+ * it was mapped. Data appended to the file afterwards lies beyond size().
+ */
+class CMappedFile
+{
+private:
+    const unsigned char* pdata;
+    size_t nSize;
+
+    CMappedFile(const unsigned char* pdataIn, size_t nSizeIn) : pdata(pdataIn), nSize(nSizeIn) {}
+
+public:
+    ~CMappedFile();
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    /** Map the file at path. Returns nullptr if it cannot be mapped, e.g. on platforms without mmap. */
+    static std::shared_ptr<const CMappedFile> Open(const fs::path& path);
+
+    const unsigned char* data() const { return pdata; }
+    size_t size() const { return nSize; }
+};
+
+/**
+ * Keeps the most recently used mappings of up to nMaxFiles numbered files,
+ * such as blk?????.dat. Mappings handed out stay valid while they are held,
+ * even if the cache drops them in the meantime.
+ */
+class CMappedFileCache
+{
+private:
+    CCriticalSection cs;
+    const size_t nMaxFiles;
+    //! Most recently used first
+    std::list<std::pair<int, std::shared_ptr<const CMappedFile>>> files;
+
+public:
+    explicit CMappedFileCache(size_t nMaxFilesIn) : nMaxFiles(nMaxFilesIn) {}
+
+    /**
+     * Mapping of file nFile at path covering at least its first nMinSize
+     * bytes. A cached mapping that is too short for that, because the file
+     * has grown since, is replaced. Returns nullptr if the file cannot be
+     * mapped or is shorter than nMinSize.
+     */
+    std::shared_ptr<const CMappedFile> Get(int nFile, const fs::path& path, size_t nMinSize);
+
+    /** Drop the mapping of nFile, e.g. before the file is deleted. */
+    void Erase(int nFile);
+    void Clear();
+};
+
+#endif // BITCOIN_MAPPEDFILE_H
@@ -33,6 +33,7 @@
 #include "tinyformat.h"
 #include "util.h"
 #include "netbase.h"
+#include "sync.h"
 
 #include <stdio.h>
 
@@ -50,6 +51,8 @@ static const bool DEFAULT_NAMED = false;
 static const int CONTINUE_EXECUTION = -1;
 static const int MAX_RETRIES = 3;
 
+//! Guards metroMap, which block checks may consult from several threads
+static CCriticalSection cs_metroMap;
 metromap_t metroMap;
 
 void addToHash(const CMetronomeBeat& beat);
@@ -423,21 +426,30 @@ bool DeserializeFileDB(const fs::path& path, Data& data)
 }
 
 void CMetronomeHelper::SerializeMetronomes() {
-	SerializeFileDB("metronomes", GetMetronomesPath(), metroMap);
+	metromap_t metroMapCopy;
+	{
+		LOCK(cs_metroMap);
+		metroMapCopy = metroMap;
+	}
+	SerializeFileDB("metronomes", GetMetronomesPath(), metroMapCopy);
 }
 
 void CMetronomeHelper::LoadMetronomes() {
+	LOCK(cs_metroMap);
 	DeserializeFileDB(GetMetronomesPath(), metroMap);
 }
 
 CMetronomeBeat getBeatFromHash(uint256 hash) {
-	if (metroMap.find(hash) != metroMap.end()) {
-		return metroMap.find(hash)->second;
+	LOCK(cs_metroMap);
+	metromap_t::const_iterator it = metroMap.find(hash);
+	if (it != metroMap.end()) {
+		return it->second;
 	}
 	return CMetronomeBeat();
 }
 
 void addToHash(const CMetronomeBeat& beat) {
+	LOCK(cs_metroMap);
 	if (metroMap.find(beat.hash) == metroMap.end()) {
 		metroMap.insert(std::pair<uint256, CMetronomeBeat>(beat.hash, beat));
 	}
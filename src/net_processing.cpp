@@ -7,6 +7,7 @@
 
 #include "addrman.h"
 #include "arith_uint256.h"
+#include "blockcache.h"
 #include "blockencodings.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
@@ -1089,14 +1090,31 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                     std::shared_ptr<const CBlock> pblock;
                     if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
                         pblock = a_recent_block;
+                    } else {
+                        pblock = blockCache.Get((*mi).second->GetBlockHash());
+                    }
+                    if (pblock) {
+                        // Already in memory
+                    } else if (inv.type == MSG_WITNESS_BLOCK || (inv.type == MSG_BLOCK && !IsWitnessEnabled((*mi).second->pprev, consensusParams))) {
+                        // Blocks are stored with their witness data, and blocks from before
+                        // segwit activation have none to strip, so send the bytes from disk
+                        // without deserializing the block.
+                        CSerializedNetMsg msg;
+                        msg.command = NetMsgType::BLOCK;
+                        if (!ReadRawBlockFromDisk(msg.data, (*mi).second, Params().MessageStart()))
+                            assert(!"cannot load block from disk");
+                        connman->PushMessage(pfrom, std::move(msg));
                     } else {
                         // Send block from disk
                         std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
                         if (!ReadBlockFromDisk(*pblockRead, (*mi).second, consensusParams))
                             assert(!"cannot load block from disk");
+                        blockCache.Insert(pblockRead, false);
                         pblock = pblockRead;
                     }
-                    if (inv.type == MSG_BLOCK)
+                    if (!pblock) {
+                        // Already sent as stored on disk
+                    } else if (inv.type == MSG_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
                     else if (inv.type == MSG_WITNESS_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
@@ -1989,11 +2007,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        CBlock block;
-        bool ret = ReadBlockFromDisk(block, it->second, chainparams.GetConsensus());
-        assert(ret);
+        std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(it->second, chainparams.GetConsensus());
+        assert(pblock);
 
-        SendBlockTransactions(block, req, pfrom, connman);
+        SendBlockTransactions(*pblock, req, pfrom, connman);
     }
 
 
@@ -2565,7 +2582,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     else if (strCommand == NetMsgType::BLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
     {
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-        vRecv >> *pblock;
+        DeserializeBlock(vRecv, *pblock);
 
         LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->GetId());
 
@@ -3306,10 +3323,9 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                         }
                     }
                     if (!fGotBlockFromCache) {
-                        CBlock block;
-                        bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
-                        assert(ret);
-                        CBlockHeaderAndShortTxIDs cmpctblock(block, state.fWantsCmpctWitness);
+                        std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pBestIndex, consensusParams);
+                        assert(pblock);
+                        CBlockHeaderAndShortTxIDs cmpctblock(*pblock, state.fWantsCmpctWitness);
                         connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
                     }
                     state.pindexBestHeaderSent = pBestIndex;
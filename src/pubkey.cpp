@@ -181,6 +181,69 @@ bool CPubKey::Verify(const uint256 &hash, const std::vector<unsigned char>& vchS
     return secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, hash.begin(), &pubkey);
 }
 
+size_t CSignatureBatch::Add(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    assert(!fVerified);
+    entries.push_back(Entry{pubkey, hash, vchSig});
+    return entries.size() - 1;
+}
+
+int CSignatureBatch::Find(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig, size_t nBegin) const
+{
+    for (size_t i = nBegin; i < entries.size(); i++) {
+        if (entries[i].hash == hash && entries[i].pubkey == pubkey && entries[i].vchSig == vchSig)
+            return i;
+    }
+    return -1;
+}
+
+bool CSignatureBatch::Verify()
+{
+    // Parse and normalize as CPubKey::Verify does; what fails to parse is
+    // invalid and stays out of the batch.
+    std::vector<secp256k1_pubkey> vPubKeys(entries.size());
+    std::vector<secp256k1_ecdsa_signature> vSigs(entries.size());
+    std::vector<const secp256k1_pubkey*> vPubKeyPtrs;
+    std::vector<const secp256k1_ecdsa_signature*> vSigPtrs;
+    std::vector<const unsigned char*> vHashPtrs;
+    std::vector<size_t> vPositions;
+    vValid.assign(entries.size(), false);
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry& entry = entries[i];
+        if (!entry.pubkey.IsValid())
+            continue;
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &vPubKeys[i], &entry.pubkey[0], entry.pubkey.size()))
+            continue;
+        if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &vSigs[i], entry.vchSig.data(), entry.vchSig.size()))
+            continue;
+        secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, &vSigs[i], &vSigs[i]);
+        vPubKeyPtrs.push_back(&vPubKeys[i]);
+        vSigPtrs.push_back(&vSigs[i]);
+        vHashPtrs.push_back(entry.hash.begin());
+        vPositions.push_back(i);
+    }
+    bool fAllValid = vPositions.size() == entries.size();
+    std::vector<int> vResults(vPositions.size());
+    if (!vPositions.empty()) {
+        fAllValid &= secp256k1_ecdsa_verify_batch(secp256k1_context_verify, vResults.data(), vSigPtrs.data(), vHashPtrs.data(), vPubKeyPtrs.data(), vPositions.size()) == 1;
+    }
+    for (size_t j = 0; j < vPositions.size(); j++) {
+        vValid[vPositions[j]] = vResults[j] != 0;
+    }
+    fVerified = true;
+    return fAllValid;
+}
+
+bool CSignatureBatch::AllValid(size_t nBegin, size_t nEnd) const
+{
+    assert(fVerified);
+    for (size_t i = nBegin; i < nEnd; i++) {
+        if (!vValid[i])
+            return false;
+    }
+    return true;
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash, const std::vector<unsigned char>& vchSig) {
     if (vchSig.size() != 65)
         return false;
@@ -190,6 +190,47 @@ public:
     bool Derive(CPubKey& pubkeyChild, ChainCode &ccChild, unsigned int nChild, const ChainCode& cc) const;
 };
 
+/**
+ * Signatures to verify together, which is cheaper than verifying them one
+ * by one. Each gets the answer CPubKey::Verify would give.
+ */
+class CSignatureBatch
+{
+private:
+    struct Entry
+    {
+        CPubKey pubkey;
+        uint256 hash;
+        std::vector<unsigned char> vchSig;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<bool> vValid;
+    bool fVerified;
+
+public:
+    CSignatureBatch() : fVerified(false) {}
+
+    //! Add a signature to verify, returning its position in the batch.
+    size_t Add(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig);
+
+    //! The position of an identical signature added at or after nBegin, or -1.
+    int Find(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig, size_t nBegin = 0) const;
+
+    //! Verify every signature added so far. Returns whether all are valid.
+    bool Verify();
+
+    bool IsVerified() const { return fVerified; }
+
+    //! Whether the signature at position i is valid. Only after Verify().
+    bool IsValid(size_t i) const { return vValid[i]; }
+
+    //! Whether the signatures at positions [nBegin, nEnd) are all valid. Only after Verify().
+    bool AllValid(size_t nBegin, size_t nEnd) const;
+
+    size_t size() const { return entries.size(); }
+};
+
 struct CExtPubKey {
     unsigned char nDepth;
     unsigned char vchFingerprint[4];
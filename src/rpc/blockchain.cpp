@@ -6,23 +6,29 @@
 #include "rpc/blockchain.h"
 
 #include "amount.h"
+#include "blockcache.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "coins.h"
+#include "coinstats.h"
 #include "consensus/validation.h"
+#include "index/scripthashindex.h"
 #include "validation.h"
+#include "validationstats.h"
 #include "core_io.h"
 #include "policy/feerate.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
+#include "script/sigcache.h"
 #include "streams.h"
 #include "sync.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
 #include "hash.h"
 
 #include <stdint.h>
@@ -753,13 +759,13 @@ UniValue getblock(const JSONRPCRequest& request)
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
 
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+    std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pblockindex, Params().GetConsensus());
+    if (!pblock)
         // Block not found on disk. This could be because we have the block
         // header in our index but don't have the block (for example if a
         // non-whitelisted node sends us an unrequested long chain of valid
@@ -770,82 +776,12 @@ UniValue getblock(const JSONRPCRequest& request)
     if (verbosity <= 0)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
+        ssBlock << *pblock;
         std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
         return strHex;
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
-}
-
-struct CCoinsStats
-{
-    int nHeight;
-    uint256 hashBlock;
-    uint64_t nTransactions;
-    uint64_t nTransactionOutputs;
-    uint64_t nBogoSize;
-    uint256 hashSerialized;
-    uint64_t nDiskSize;
-    CAmount nTotalAmount;
-
-    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nBogoSize(0), nDiskSize(0), nTotalAmount(0) {}
-};
-
-static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
-{
-    assert(!outputs.empty());
-    ss << hash;
-    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase);
-    stats.nTransactions++;
-    for (const auto output : outputs) {
-        ss << VARINT(output.first + 1);
-        ss << output.second.out.scriptPubKey;
-        ss << VARINT(output.second.out.nValue);
-        stats.nTransactionOutputs++;
-        stats.nTotalAmount += output.second.out.nValue;
-        stats.nBogoSize += 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
-                           2 /* scriptPubKey len */ + output.second.out.scriptPubKey.size() /* scriptPubKey */;
-    }
-    ss << VARINT(0);
-}
-
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
-{
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
-    {
-        LOCK(cs_main);
-        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
-    }
-    ss << stats.hashBlock;
-    uint256 prevkey;
-    std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        COutPoint key;
-        Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, ss, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
-        } else {
-            return error("%s: unable to read value", __func__);
-        }
-        pcursor->Next();
-    }
-    if (!outputs.empty()) {
-        ApplyStats(stats, ss, prevkey, outputs);
-    }
-    stats.hashSerialized = ss.GetHash();
-    stats.nDiskSize = view->EstimateSize();
-    return true;
+    return blockToJSON(*pblock, pblockindex, verbosity >= 2);
 }
 
 UniValue pruneblockchain(const JSONRPCRequest& request)
@@ -899,43 +835,219 @@ UniValue pruneblockchain(const JSONRPCRequest& request)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, unless the node runs with -utxostats and hash_type is muhash or none.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"   (string, optional, default=\"hash_serialized_2\") Which UTXO set hash to calculate:\n"
+            "                   \"hash_serialized_2\" (sequential scan of the whole set),\n"
+            "                   \"muhash\" (rolling set hash, maintained with -utxostats or computed by a parallel scan),\n"
+            "                   \"none\" (statistics only)\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (only with hash_serialized_2)\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash (only with hash_serialized_2)\n"
+            "  \"muhash\": \"hash\",      (string) The rolling set hash (only with muhash)\n"
             "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
-            + HelpExampleRpc("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"muhash\"")
+            + HelpExampleRpc("gettxoutsetinfo", "\"muhash\"")
         );
 
     UniValue ret(UniValue::VOBJ);
 
-    CCoinsStats stats;
-    FlushStateToDisk();
-    if (GetUTXOStats(pcoinsdbview, stats)) {
-        ret.push_back(Pair("height", (int64_t)stats.nHeight));
-        ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
-        ret.push_back(Pair("transactions", (int64_t)stats.nTransactions));
-        ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
-        ret.push_back(Pair("bogosize", (int64_t)stats.nBogoSize));
-        ret.push_back(Pair("hash_serialized_2", stats.hashSerialized.GetHex()));
-        ret.push_back(Pair("disk_size", stats.nDiskSize));
-        ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
-    } else {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+    std::string hash_type = "hash_serialized_2";
+    if (!request.params[0].isNull()) {
+        hash_type = request.params[0].get_str();
+    }
+
+    if (hash_type == "hash_serialized_2") {
+        CCoinsStats stats;
+        FlushStateToDisk();
+        if (GetUTXOStats(pcoinsdbview, stats)) {
+            ret.push_back(Pair("height", (int64_t)stats.nHeight));
+            ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
+            ret.push_back(Pair("transactions", (int64_t)stats.nTransactions));
+            ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
+            ret.push_back(Pair("bogosize", (int64_t)stats.nBogoSize));
+            ret.push_back(Pair("hash_serialized_2", stats.hashSerialized.GetHex()));
+            ret.push_back(Pair("disk_size", stats.nDiskSize));
+            ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
+        } else {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+        }
+        return ret;
+    }
+
+    if (hash_type != "muhash" && hash_type != "none") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown hash_type " + hash_type);
+    }
+
+    CIncrementalCoinsStats stats;
+    if (!GetIncrementalCoinsStats(stats)) {
+        // Not maintained: fall back to a parallel scan of the coins database.
+        FlushStateToDisk();
+        if (!ComputeCoinsStats(pcoinsdbview, stats, GetNumCores())) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+        }
+    }
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = mapBlockIndex.at(stats.hashBlock)->nHeight;
+    }
+    ret.push_back(Pair("height", nHeight));
+    ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
+    ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
+    ret.push_back(Pair("bogosize", (int64_t)stats.nBogoSize));
+    if (hash_type == "muhash") {
+        ret.push_back(Pair("muhash", stats.GetHash().GetHex()));
+    }
+    ret.push_back(Pair("disk_size", (uint64_t)pcoinsdbview->EstimateSize()));
+    ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
+    return ret;
+}
+
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrite the unspent transaction output set to a snapshot file that can be loaded with loadtxoutset.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"       (string, required) Path to the snapshot file. If relative, will be prefixed by datadir.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_written\": n,           (numeric) The number of coins written to the snapshot\n"
+            "  \"base_hash\": \"hash\",          (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,             (numeric) The height of that block\n"
+            "  \"nchaintx\": n,                (numeric) The number of transactions up to and including that block\n"
+            "  \"hash_serialized_2\": \"hash\",  (string) The serialized hash of the coins, as in gettxoutsetinfo\n"
+            "  \"path\": \"path\"                (string) The absolute path the snapshot was written to\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    // Write to a temporary path and rename at the end, so an interrupted dump
+    // never leaves a file that looks complete.
+    fs::path temppath = fs::absolute(request.params[0].get_str() + ".incomplete", GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+
+    FILE* filestr = fsbridge::fopen(temppath, "wb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to open " + temppath.string() + " for writing");
+    }
+
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    const CBlockIndex* pindexBase;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        // The cursor iterates over a consistent database snapshot, so blocks
+        // may be connected while the file is written.
+        pcursor.reset(pcoinsdbview->Cursor());
+        pindexBase = mapBlockIndex.at(pcursor->GetBestBlock());
+    }
+
+    SnapshotMetadata metadata(Params().MessageStart(), pindexBase->GetBlockHash(), pindexBase->nChainTx);
+    if (!WriteUTXOSnapshot(file, pcursor.get(), metadata)) {
+        file.fclose();
+        fs::remove(temppath);
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to write UTXO snapshot");
     }
+    file.fclose();
+    fs::rename(temppath, path);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("coins_written", (int64_t)metadata.nCoins));
+    ret.push_back(Pair("base_hash", metadata.hashBaseBlock.GetHex()));
+    ret.push_back(Pair("base_height", pindexBase->nHeight));
+    ret.push_back(Pair("nchaintx", (int64_t)metadata.nChainTx));
+    ret.push_back(Pair("hash_serialized_2", metadata.hashSerialized.GetHex()));
+    ret.push_back(Pair("path", path.string()));
+    return ret;
+}
+
+UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "loadtxoutset \"path\"\n"
+            "\nReplace the unspent transaction output set with a snapshot written by dumptxoutset, and make\n"
+            "the snapshot's block the chain tip. The block's header must be known and must descend from the\n"
+            "current tip. Blocks below the snapshot are not downloaded, so this requires -prune.\n"
+            "Only load snapshots from a source you trust: their contents are not validated against the block chain.\n"
+            "\nArguments:\n"
+            "1. \"path\"       (string, required) Path to the snapshot file. If relative, will be prefixed by datadir.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_loaded\": n,            (numeric) The number of coins loaded\n"
+            "  \"base_hash\": \"hash\",          (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,             (numeric) The height of that block\n"
+            "  \"hash_serialized_2\": \"hash\",  (string) The serialized hash of the loaded coins\n"
+            "  \"path\": \"path\"                (string) The absolute path the snapshot was read from\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+        );
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    FILE* filestr = fsbridge::fopen(path, "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unable to open " + path.string());
+    }
+
+    SnapshotMetadata metadata;
+    try {
+        file >> metadata;
+    } catch (const std::exception& e) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("Unable to read snapshot header: %s", e.what()));
+    }
+    if (memcmp(metadata.pchMessageStart, Params().MessageStart(), sizeof(metadata.pchMessageStart)) != 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Snapshot was created for a different network");
+    }
+    long nBodyPos = ftell(file.Get());
+
+    // Check the whole file against its header before touching the chainstate.
+    std::string strError;
+    if (!VerifyUTXOSnapshot(file, metadata, strError)) {
+        throw JSONRPCError(RPC_VERIFY_ERROR, "Invalid snapshot: " + strError);
+    }
+    if (nBodyPos < 0 || fseek(file.Get(), nBodyPos, SEEK_SET) != 0) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to rewind snapshot file");
+    }
+
+    if (!LoadUTXOSnapshot(Params(), file, metadata, strError)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to load snapshot: " + strError);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("coins_loaded", (int64_t)metadata.nCoins));
+    ret.push_back(Pair("base_hash", metadata.hashBaseBlock.GetHex()));
+    {
+        LOCK(cs_main);
+        ret.push_back(Pair("base_height", mapBlockIndex.at(metadata.hashBaseBlock)->nHeight));
+    }
+    ret.push_back(Pair("hash_serialized_2", metadata.hashSerialized.GetHex()));
+    ret.push_back(Pair("path", path.string()));
     return ret;
 }
 
@@ -1047,6 +1159,40 @@ UniValue verifychain(const JSONRPCRequest& request)
     return CVerifyDB().VerifyDB(Params(), pcoinsTip, nCheckLevel, nCheckDepth);
 }
 
+UniValue getverifychaininfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getverifychaininfo\n"
+            "\nReturns the progress of the startup block verification levels 3 and 4 (see -checklevel),\n"
+            "which run in the background once the node is up.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"running\": true|false,  (boolean) Whether the verification is running\n"
+            "  \"status\": \"xxxx\",      (string) \"not started\", \"running\", \"ok\", \"failed\", \"interrupted\", or \"incomplete\" if the tip kept moving\n"
+            "  \"checklevel\": n,        (numeric) The level being checked\n"
+            "  \"checkblocks\": n,       (numeric) The number of blocks being checked\n"
+            "  \"height\": n,            (numeric) Height of the block last checked\n"
+            "  \"progress\": x.xxx,      (numeric) Estimate of the work done, from 0 to 1\n"
+            "  \"restarts\": n           (numeric) Times the verification started over because the tip moved\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getverifychaininfo", "")
+            + HelpExampleRpc("getverifychaininfo", "")
+        );
+
+    VerifyDBProgress progress = GetBackgroundVerifyDBProgress();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("running", progress.fRunning));
+    ret.push_back(Pair("status", progress.strStatus));
+    ret.push_back(Pair("checklevel", progress.nCheckLevel));
+    ret.push_back(Pair("checkblocks", progress.nCheckDepth));
+    ret.push_back(Pair("height", progress.nHeight));
+    ret.push_back(Pair("progress", progress.dProgress));
+    ret.push_back(Pair("restarts", progress.nRestarts));
+    return ret;
+}
+
 /** Implementation of IsSuperMajority with better feedback */
 static UniValue SoftForkMajorityDesc(int version, CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
@@ -1534,6 +1680,311 @@ UniValue getchaintxstats(const JSONRPCRequest& request)
     return ret;
 }
 
+//! Default and maximum number of entries getscripthashhistory returns per call
+static const int DEFAULT_SCRIPTHASH_HISTORY_COUNT = 100;
+static const int MAX_SCRIPTHASH_HISTORY_COUNT = 1000;
+
+UniValue scripthashHistoryToJSON(const uint256& scripthash, int nCount, const std::string& strCursor)
+{
+    if (!g_scripthashindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Script hash index is disabled, use -scripthashindex to enable it");
+    if (nCount < 1 || nCount > MAX_SCRIPTHASH_HISTORY_COUNT)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 1 and %d", MAX_SCRIPTHASH_HISTORY_COUNT));
+
+    ScriptHashPosition start;
+    if (!strCursor.empty()) {
+        std::vector<unsigned char> vCursor(ParseHex(strCursor));
+        CDataStream ssCursor(vCursor, SER_DISK, CLIENT_VERSION);
+        try {
+            ssCursor >> start;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        if (!IsHex(strCursor) || !ssCursor.empty())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+
+    // Fetch one entry more than requested to know where the next page starts.
+    const CBlockIndex* pindexBest = g_scripthashindex->GetBestBlockIndex();
+    std::vector<ScriptHashEntry> entries;
+    if (!g_scripthashindex->FindEntries(scripthash, start, nCount + 1, entries))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read script hash index");
+
+    UniValue history(UniValue::VARR);
+    for (size_t i = 0; i < entries.size() && (int)i < nCount; i++) {
+        const ScriptHashEntry& entry = entries[i];
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("txid", entry.pos.txid.GetHex()));
+        obj.push_back(Pair("height", entry.pos.nHeight));
+        obj.push_back(Pair("type", entry.pos.fSpend ? "spend" : "output"));
+        obj.push_back(Pair(entry.pos.fSpend ? "vin" : "vout", (int64_t)entry.pos.n));
+        obj.push_back(Pair("value", ValueFromAmount(entry.nValue)));
+        if (entry.pos.fSpend) {
+            obj.push_back(Pair("prevout_txid", entry.prevout.hash.GetHex()));
+            obj.push_back(Pair("prevout_vout", (int64_t)entry.prevout.n));
+        }
+        history.push_back(obj);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("scripthash", scripthash.GetHex()));
+    ret.push_back(Pair("synced", g_scripthashindex->IsSynced()));
+    ret.push_back(Pair("height", pindexBest ? pindexBest->nHeight : -1));
+    ret.push_back(Pair("history", history));
+    if ((int)entries.size() > nCount) {
+        CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+        ssCursor << entries.back().pos;
+        ret.push_back(Pair("next", HexStr(ssCursor.begin(), ssCursor.end())));
+    }
+    return ret;
+}
+
+UniValue getscripthashhistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            "getscripthashhistory \"scripthash\" ( count \"cursor\" )\n"
+            "\nReturns the confirmed outputs paying to a script and the inputs spending them, oldest first.\n"
+            "Requires -scripthashindex.\n"
+            "\nArguments:\n"
+            "1. \"scripthash\"   (string, required) The SHA256 of the scriptPubKey in reversed byte order, as\n"
+            "                  shown by validateaddress and used by Electrum servers\n"
+            "2. count          (numeric, optional, default=" + std::to_string(DEFAULT_SCRIPTHASH_HISTORY_COUNT) + ") The maximum number of entries to return, at most " + std::to_string(MAX_SCRIPTHASH_HISTORY_COUNT) + "\n"
+            "3. \"cursor\"       (string, optional) The \"next\" value of the previous call, to continue where it stopped\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"scripthash\": \"hash\",   (string) The script hash\n"
+            "  \"synced\": true|false,   (boolean) Whether the index has caught up with the active chain\n"
+            "  \"height\": n,            (numeric) The height up to which blocks have been indexed\n"
+            "  \"history\": [\n"
+            "    {\n"
+            "      \"txid\": \"hash\",       (string) The transaction id\n"
+            "      \"height\": n,          (numeric) The height of the block containing the transaction\n"
+            "      \"type\": \"output\",     (string) \"output\" for an output paying to the script, \"spend\" for an input spending one\n"
+            "      \"vout\"|\"vin\": n,      (numeric) The output or input number within the transaction\n"
+            "      \"value\": x.xxx,       (numeric) The amount in " + CURRENCY_UNIT + " paid or spent\n"
+            "      \"prevout_txid\": \"hash\", (string, spends only) The transaction of the output spent\n"
+            "      \"prevout_vout\": n     (numeric, spends only) The output number spent\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"next\": \"cursor\"       (string, optional) Present if there are more entries, pass it as cursor to get them\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getscripthashhistory", "\"8b01df4e368ea28f8dc0423bcf7a4923e3a12d307c875e47a0cfbf90b5c39161\" 10")
+            + HelpExampleRpc("getscripthashhistory", "\"8b01df4e368ea28f8dc0423bcf7a4923e3a12d307c875e47a0cfbf90b5c39161\", 10")
+        );
+
+    uint256 scripthash = ParseHashV(request.params[0], "scripthash");
+    int nCount = DEFAULT_SCRIPTHASH_HISTORY_COUNT;
+    if (!request.params[1].isNull())
+        nCount = request.params[1].get_int();
+    std::string strCursor;
+    if (!request.params[2].isNull())
+        strCursor = request.params[2].get_str();
+
+    return scripthashHistoryToJSON(scripthash, nCount, strCursor);
+}
+
+static UniValue DBStatsToJSON(const CDBWrapper& db)
+{
+    const DBProfile& profile = db.GetProfile();
+    UniValue options(UniValue::VOBJ);
+    options.push_back(Pair("block_cache_size", (uint64_t)profile.block_cache_size));
+    options.push_back(Pair("write_buffer_size", (uint64_t)profile.write_buffer_size));
+    options.push_back(Pair("block_size", (uint64_t)profile.block_size));
+    options.push_back(Pair("bloom_bits_per_key", profile.bloom_bits_per_key));
+    options.push_back(Pair("compression", profile.compression && DBCompressionAvailable()));
+    options.push_back(Pair("max_open_files", profile.max_open_files));
+
+    DBStats stats = db.GetStats();
+    UniValue cache(UniValue::VOBJ);
+    cache.push_back(Pair("usage", (uint64_t)stats.cache_usage));
+    cache.push_back(Pair("hits", stats.cache_hits));
+    cache.push_back(Pair("misses", stats.cache_misses));
+    uint64_t nLookups = stats.cache_hits + stats.cache_misses;
+    cache.push_back(Pair("hit_rate", nLookups ? (double)stats.cache_hits / nLookups : 0.0));
+
+    UniValue levels(UniValue::VARR);
+    double dCompactionTime = 0;
+    for (const DBStats::Level& level : stats.levels) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("files", level.files));
+        entry.push_back(Pair("size_mb", level.size_mb));
+        entry.push_back(Pair("compaction_time", level.compaction_sec));
+        entry.push_back(Pair("compaction_read_mb", level.read_mb));
+        entry.push_back(Pair("compaction_write_mb", level.write_mb));
+        levels.push_back(entry);
+        dCompactionTime += level.compaction_sec;
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("profile", profile.name));
+    ret.push_back(Pair("options", options));
+    ret.push_back(Pair("memory_usage", (uint64_t)stats.memory_usage));
+    ret.push_back(Pair("block_cache", cache));
+    ret.push_back(Pair("compaction_time", dCompactionTime));
+    ret.push_back(Pair("levels", levels));
+    return ret;
+}
+
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getdbstats\n"
+            "\nReturns settings and statistics of the LevelDB databases.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"chainstate\": {               (json object) The coins database, \"index\" has the same fields for the block index\n"
+            "    \"profile\": \"name\",          (string) The settings profile the database was opened with\n"
+            "    \"options\": {                 (json object) The LevelDB settings in use, see -dboption\n"
+            "      \"block_cache_size\": n,\n"
+            "      \"write_buffer_size\": n,\n"
+            "      \"block_size\": n,\n"
+            "      \"bloom_bits_per_key\": n,\n"
+            "      \"compression\": true|false,\n"
+            "      \"max_open_files\": n\n"
+            "    },\n"
+            "    \"memory_usage\": n,           (numeric) Bytes used by memtables and the block cache\n"
+            "    \"block_cache\": {             (json object) Blocks of memory-mapped table files are never cached and count as misses\n"
+            "      \"usage\": n,                (numeric) Bytes in the block cache\n"
+            "      \"hits\": n,                 (numeric) Block cache lookups that hit since startup\n"
+            "      \"misses\": n,               (numeric) Block cache lookups that missed since startup\n"
+            "      \"hit_rate\": x.xxx          (numeric) hits / (hits + misses)\n"
+            "    },\n"
+            "    \"compaction_time\": x.xxx,    (numeric) Seconds spent compacting since startup\n"
+            "    \"levels\": [                  (array) One entry per LevelDB level, starting at level 0\n"
+            "      {\n"
+            "        \"files\": n,              (numeric) Number of table files\n"
+            "        \"size_mb\": n,            (numeric) Size of the level in MiB (rounded)\n"
+            "        \"compaction_time\": n,    (numeric) Seconds spent on compactions into this level (rounded)\n"
+            "        \"compaction_read_mb\": n, (numeric) MiB read by those compactions (rounded)\n"
+            "        \"compaction_write_mb\": n (numeric) MiB written by those compactions (rounded)\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  },\n"
+            "  \"index\": { ... }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    LOCK(cs_main);
+    ret.push_back(Pair("chainstate", DBStatsToJSON(pcoinsdbview->GetDB())));
+    ret.push_back(Pair("index", DBStatsToJSON(*pblocktree)));
+    return ret;
+}
+
+UniValue getblockcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getblockcacheinfo\n"
+            "\nReturns statistics of the cache of recently connected and requested blocks (see -blockcachesize).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": n,        (numeric) Number of blocks in the cache\n"
+            "  \"usage\": n,         (numeric) Bytes used by those blocks\n"
+            "  \"maxusage\": n,      (numeric) Maximum bytes the cache may use\n"
+            "  \"hits\": n,          (numeric) Lookups that found the block since startup\n"
+            "  \"misses\": n,        (numeric) Lookups that had to read the block from disk since startup\n"
+            "  \"hit_rate\": x.xxx   (numeric) hits / (hits + misses)\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockcacheinfo", "")
+            + HelpExampleRpc("getblockcacheinfo", "")
+        );
+
+    CBlockCache::Stats stats = blockCache.GetStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("blocks", (uint64_t)stats.nBlocks));
+    ret.push_back(Pair("usage", (uint64_t)stats.nUsage));
+    ret.push_back(Pair("maxusage", (uint64_t)stats.nMaxUsage));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    uint64_t nLookups = stats.nHits + stats.nMisses;
+    ret.push_back(Pair("hit_rate", nLookups ? (double)stats.nHits / nLookups : 0.0));
+    return ret;
+}
+
+static UniValue SignatureCacheStatsToJSON(const SignatureCacheStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("capacity", (uint64_t)stats.nCapacity));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    ret.push_back(Pair("inserts", stats.nInserts));
+    ret.push_back(Pair("evictions", stats.nEvictions));
+    uint64_t nLookups = stats.nHits + stats.nMisses;
+    ret.push_back(Pair("hit_rate", nLookups ? (double)stats.nHits / nLookups : 0.0));
+    return ret;
+}
+
+UniValue getvalidationstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getvalidationstats\n"
+            "\nReturns the activity of the signature and script execution caches (see -maxsigcachesize)\n"
+            "and where the time went for the last blocks connected. Times are in milliseconds.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"sigcache\": {             (json object) The signature cache\n"
+            "    \"capacity\": n,          (numeric) Number of entries the cache can hold\n"
+            "    \"hits\": n,              (numeric) Lookups that found the entry since startup\n"
+            "    \"misses\": n,            (numeric) Lookups that did not find the entry since startup\n"
+            "    \"inserts\": n,           (numeric) Entries added since startup\n"
+            "    \"evictions\": n,         (numeric) Inserts that pushed out a live entry since startup\n"
+            "    \"hit_rate\": x.xxx       (numeric) hits / (hits + misses)\n"
+            "  },\n"
+            "  \"scriptcache\": { ... },   (json object) The script execution cache, same fields as sigcache\n"
+            "  \"blocks\": [               (json array) The last blocks connected, oldest first\n"
+            "    {\n"
+            "      \"hash\": \"hash\",         (string) The block hash\n"
+            "      \"height\": n,            (numeric) The block height\n"
+            "      \"txs\": n,               (numeric) Number of transactions\n"
+            "      \"inputs\": n,            (numeric) Number of inputs, not counting the coinbase\n"
+            "      \"read\": x.xxx,          (numeric) Loading the block from disk\n"
+            "      \"fetch_inputs\": x.xxx,  (numeric) Fetching inputs and checking amounts and sigops\n"
+            "      \"script_checks\": x.xxx, (numeric) Waiting for script checks after fetching the inputs\n"
+            "      \"undo\": x.xxx,          (numeric) Writing undo data\n"
+            "      \"flush\": x.xxx,         (numeric) Flushing into the coins cache\n"
+            "      \"chainstate\": x.xxx,    (numeric) Writing the chain state to disk\n"
+            "      \"total\": x.xxx          (numeric) Connecting the block, including the above\n"
+            "    },\n"
+            "    ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationstats", "")
+            + HelpExampleRpc("getvalidationstats", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("sigcache", SignatureCacheStatsToJSON(GetSignatureCacheStats())));
+    ret.push_back(Pair("scriptcache", SignatureCacheStatsToJSON(GetScriptExecutionCacheStats())));
+    UniValue blocks(UniValue::VARR);
+    for (const BlockConnectTimes& times : connectTimesLog.GetRecent()) {
+        UniValue block(UniValue::VOBJ);
+        block.push_back(Pair("hash", times.hash.GetHex()));
+        block.push_back(Pair("height", times.nHeight));
+        block.push_back(Pair("txs", (uint64_t)times.nTx));
+        block.push_back(Pair("inputs", (uint64_t)times.nInputs));
+        block.push_back(Pair("read", 0.001 * times.nTimeRead));
+        block.push_back(Pair("fetch_inputs", 0.001 * times.nTimeInputs));
+        block.push_back(Pair("script_checks", 0.001 * times.nTimeScripts));
+        block.push_back(Pair("undo", 0.001 * times.nTimeUndo));
+        block.push_back(Pair("flush", 0.001 * times.nTimeFlush));
+        block.push_back(Pair("chainstate", 0.001 * times.nTimeChainState));
+        block.push_back(Pair("total", 0.001 * times.nTimeTotal));
+        blocks.push_back(block);
+    }
+    ret.push_back(Pair("blocks", blocks));
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ ----------
@@ -1542,19 +1993,26 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {} },
     { "blockchain",         "getblockcount",          &getblockcount,          true,  {} },
     { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbosity|verbose"} },
+    { "blockchain",         "getblockcacheinfo",      &getblockcacheinfo,      true,  {} },
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         true,  {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {} },
+    { "blockchain",         "getdbstats",             &getdbstats,             true,  {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    true,  {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true,  {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
+    { "blockchain",         "getscripthashhistory",   &getscripthashhistory,   true,  {"scripthash","count","cursor"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {"hash_type"} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true,  {"path"} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           false, {"path"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel","nblocks"} },
+    { "blockchain",         "getverifychaininfo",     &getverifychaininfo,     true,  {} },
+    { "blockchain",         "getvalidationstats",     &getvalidationstats,     true,  {} },
 
     { "blockchain",         "preciousblock",          &preciousblock,          true,  {"blockhash"} },
 
@@ -5,9 +5,12 @@
 #ifndef BITCOIN_RPC_BLOCKCHAIN_H
 #define BITCOIN_RPC_BLOCKCHAIN_H
 
+#include <string>
+
 class CBlock;
 class CBlockIndex;
 class UniValue;
+class uint256;
 
 /**
  * Get the difficulty of the net wrt to the given block index, or the chain tip if
@@ -33,5 +36,12 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
+/**
+ * Up to nCount entries of the history of a script hash to JSON, continuing
+ * at strCursor if not empty. Throws a JSONRPCError if -scripthashindex is
+ * disabled or the arguments are invalid.
+ */
+UniValue scripthashHistoryToJSON(const uint256& scripthash, int nCount, const std::string& strCursor);
+
 #endif
 
@@ -7,6 +7,7 @@
 #include "chain.h"
 #include "clientversion.h"
 #include "core_io.h"
+#include "index/scripthashindex.h"
 #include "init.h"
 #include "validation.h"
 #include "httpserver.h"
@@ -14,6 +15,7 @@
 #include "netbase.h"
 #include "rpc/blockchain.h"
 #include "rpc/server.h"
+#include "startupprofile.h"
 #include "timedata.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -176,6 +178,7 @@ UniValue validateaddress(const JSONRPCRequest& request)
             "  \"isvalid\" : true|false,       (boolean) If the address is valid or not. If not, this is the only property returned.\n"
             "  \"address\" : \"address\", (string) The bitcoin address validated\n"
             "  \"scriptPubKey\" : \"hex\",       (string) The hex encoded scriptPubKey generated by the address\n"
+            "  \"scripthash\" : \"hash\",        (string) The script hash of the scriptPubKey, see getscripthashhistory\n"
             "  \"ismine\" : true|false,        (boolean) If the address is yours or not\n"
             "  \"iswatchonly\" : true|false,   (boolean) If the address is watchonly\n"
             "  \"isscript\" : true|false,      (boolean) If the key is a script\n"
@@ -220,6 +223,7 @@ UniValue validateaddress(const JSONRPCRequest& request)
 
         CScript scriptPubKey = GetScriptForDestination(dest);
         ret.push_back(Pair("scriptPubKey", HexStr(scriptPubKey.begin(), scriptPubKey.end())));
+        ret.push_back(Pair("scripthash", GetScriptHash(scriptPubKey).GetHex()));
 
 #ifdef ENABLE_WALLET
         isminetype mine = pwallet ? IsMine(*pwallet, dest) : ISMINE_NO;
@@ -502,6 +506,21 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCBlockIndexMemoryInfo()
+{
+    CBlockIndexArena::Stats stats;
+    {
+        LOCK(cs_main);
+        stats = blockIndexArena.GetStats();
+    }
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("entries", uint64_t(stats.nEntries)));
+    obj.push_back(Pair("used", uint64_t(stats.nEntries * sizeof(CBlockIndex))));
+    obj.push_back(Pair("allocated", uint64_t(stats.nAllocated)));
+    obj.push_back(Pair("saved", int64_t(stats.nSeparate) - int64_t(stats.nAllocated)));
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -543,6 +562,12 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"blockindex\": {           (json object) Information about block index storage\n"
+            "    \"entries\": xxxxx,       (numeric) Number of block index entries\n"
+            "    \"used\": xxxxx,          (numeric) Number of bytes used by the entries\n"
+            "    \"allocated\": xxxxx,     (numeric) Number of bytes allocated for the entries\n"
+            "    \"saved\": xxxxx,         (numeric) Number of bytes saved over allocating each entry separately\n"
             "  }\n"
             "}\n"
             "\nResult (mode \"mallocinfo\"):\n"
@@ -556,6 +581,7 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+        obj.push_back(Pair("blockindex", RPCBlockIndexMemoryInfo()));
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -568,6 +594,38 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+UniValue getstartupinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getstartupinfo\n"
+            "Returns the time and resources taken by each phase of startup, in the order they started.\n"
+            "CPU time and I/O are counted for the whole process, so phases that overlap include each other's share.\n"
+            "The same information is written to startup.json in the data directory when startup completes.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"phases\": [\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",        (string) Name of the phase, such as loadblockindex, verifydb or loadmempool\n"
+            "      \"start\": x.xxx,        (numeric) Seconds from the start of the first phase\n"
+            "      \"wall\": x.xxx,         (numeric) Seconds the phase took, or has taken so far\n"
+            "      \"cpu\": x.xxx,          (numeric) Seconds of CPU time used by the process during the phase\n"
+            "      \"read_bytes\": xxxxx,   (numeric) Bytes read from storage\n"
+            "      \"write_bytes\": xxxxx,  (numeric) Bytes written to storage\n"
+            "      \"peak_memory\": xxxxx,  (numeric) Largest resident size of the process in bytes by the end of the phase, 0 if unknown\n"
+            "      \"running\": true|false  (boolean) Whether the phase is still running\n"
+            "    },\n"
+            "    ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getstartupinfo", "")
+            + HelpExampleRpc("getstartupinfo", "")
+        );
+
+    return StartupProfileToJSON();
+}
+
 uint32_t getCategoryMask(UniValue cats) {
     cats = cats.get_array();
     uint32_t mask = 0;
@@ -653,6 +711,7 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
     { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {"mode"} },
+    { "control",            "getstartupinfo",         &getstartupinfo,         true,  {} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
@@ -8,6 +8,7 @@
 #include "coins.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "index/txindex.h"
 #include "init.h"
 #include "keystore.h"
 #include "validation.h"
@@ -155,10 +156,17 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
 
     CTransactionRef tx;
     uint256 hashBlock;
-    if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string(fTxIndex ? "No such mempool or blockchain transaction"
-            : "No such mempool transaction. Use -txindex to enable blockchain transaction queries") +
-            ". Use gettransaction for wallet transactions.");
+    if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true)) {
+        std::string strError;
+        if (!g_txindex) {
+            strError = "No such mempool transaction. Use -txindex to enable blockchain transaction queries";
+        } else if (!g_txindex->IsSynced()) {
+            strError = "No such mempool transaction. Blockchain transactions are still in the process of being indexed";
+        } else {
+            strError = "No such mempool or blockchain transaction";
+        }
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strError + ". Use gettransaction for wallet transactions.");
+    }
 
     if (!fVerbose)
         return EncodeHexTx(*tx, RPCSerializationFlags());
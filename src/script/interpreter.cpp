@@ -11,6 +11,7 @@
 #include "crypto/sha256.h"
 #include "pubkey.h"
 #include "script/script.h"
+#include "streams.h"
 #include "uint256.h"
 
 typedef std::vector<unsigned char> valtype;
@@ -54,13 +55,96 @@ bool CastToBool(const valtype& vch)
  */
 #define stacktop(i)  (stack.at(stack.size()+(i)))
 #define altstacktop(i)  (altstack.at(altstack.size()+(i)))
+
+namespace {
+
+/**
+ * Buffers of stack elements that were popped, kept per thread so that
+ * pushes reuse them instead of allocating. Scripts are checked on several
+ * threads at once (-par), and allocations there contend on the heap.
+ */
+class StackElementPool
+{
+private:
+    //! More than the stacks of standard scripts ever hold
+    static const size_t MAX_BUFFERS = 64;
+    std::vector<valtype> vBuffers;
+
+public:
+    StackElementPool()
+    {
+        vBuffers.reserve(MAX_BUFFERS);
+    }
+
+    /** An empty element, with room for data if a buffer was available. */
+    valtype Get()
+    {
+        if (vBuffers.empty())
+            return valtype();
+        valtype vch = std::move(vBuffers.back());
+        vBuffers.pop_back();
+        vch.clear();
+        return vch;
+    }
+
+    void Put(valtype&& vch)
+    {
+        if (vBuffers.size() < MAX_BUFFERS && vch.capacity() > 0 && vch.capacity() <= MAX_SCRIPT_ELEMENT_SIZE)
+            vBuffers.push_back(std::move(vch));
+    }
+};
+
+StackElementPool& GetStackElementPool()
+{
+    static thread_local StackElementPool pool;
+    return pool;
+}
+
+/** A buffer from the pool, given back when it goes out of scope */
+class PooledElement
+{
+public:
+    valtype vch;
+
+    PooledElement() : vch(GetStackElementPool().Get()) {}
+    ~PooledElement() { GetStackElementPool().Put(std::move(vch)); }
+};
+
+/** Gives the elements left on a stack back to the pool when it goes out of scope */
+class StackRecycler
+{
+private:
+    std::vector<valtype>& stack;
+
+public:
+    explicit StackRecycler(std::vector<valtype>& stackIn) : stack(stackIn) {}
+    ~StackRecycler()
+    {
+        StackElementPool& pool = GetStackElementPool();
+        for (valtype& vch : stack)
+            pool.Put(std::move(vch));
+        stack.clear();
+    }
+};
+
+} // namespace
+
 static inline void popstack(std::vector<valtype>& stack)
 {
     if (stack.empty())
         throw std::runtime_error("popstack(): stack empty");
+    GetStackElementPool().Put(std::move(stack.back()));
     stack.pop_back();
 }
 
+/** Push a copy of vch, which may be an element of the stack itself. */
+static inline void pushcopy(std::vector<valtype>& stack, const valtype& vch)
+{
+    valtype vchCopy = GetStackElementPool().Get();
+    vchCopy.assign(vch.begin(), vch.end());
+    stack.push_back(std::move(vchCopy));
+}
+
 bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
     if (vchPubKey.size() < 33) {
         //  Non-canonical public key: too short
@@ -257,7 +341,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     CScript::const_iterator pend = script.end();
     CScript::const_iterator pbegincodehash = script.begin();
     opcodetype opcode;
-    valtype vchPushValue;
+    PooledElement pushValue;
+    valtype& vchPushValue = pushValue.vch;
     std::vector<bool> vfExec;
     std::vector<valtype> altstack;
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
@@ -305,7 +390,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 if (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) {
                     return set_error(serror, SCRIPT_ERR_MINIMALDATA);
                 }
-                stack.push_back(vchPushValue);
+                pushcopy(stack, vchPushValue);
             } else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -501,8 +586,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    altstack.push_back(stacktop(-1));
-                    popstack(stack);
+                    altstack.push_back(std::move(stacktop(-1)));
+                    stack.pop_back();
                 }
                 break;
 
@@ -510,8 +595,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     if (altstack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_ALTSTACK_OPERATION);
-                    stack.push_back(altstacktop(-1));
-                    popstack(altstack);
+                    stack.push_back(std::move(altstacktop(-1)));
+                    altstack.pop_back();
                 }
                 break;
 
@@ -619,8 +704,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x -- x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    stack.push_back(vch);
+                    pushcopy(stack, stacktop(-1));
                 }
                 break;
 
@@ -638,8 +722,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x1 x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-2);
-                    stack.push_back(vch);
+                    pushcopy(stack, stacktop(-2));
                 }
                 break;
 
@@ -724,7 +807,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     //    fEqual = !fEqual;
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fEqual ? vchTrue : vchFalse);
+                    pushcopy(stack, fEqual ? vchTrue : vchFalse);
                     if (opcode == OP_EQUALVERIFY)
                     {
                         if (fEqual)
@@ -834,7 +917,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     popstack(stack);
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fValue ? vchTrue : vchFalse);
+                    pushcopy(stack, fValue ? vchTrue : vchFalse);
                 }
                 break;
 
@@ -852,19 +935,20 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    unsigned char vchHash[32];
+                    size_t nHashSize = (opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32;
                     if (opcode == OP_RIPEMD160)
-                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA1)
-                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA256)
-                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH160)
-                        CHash160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CHash160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH256)
-                        CHash256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
-                    popstack(stack);
-                    stack.push_back(vchHash);
+                        CHash256().Write(vch.data(), vch.size()).Finalize(vchHash);
+                    // Replace the input in place, reusing its buffer
+                    vch.assign(vchHash, vchHash + nHashSize);
                 }
                 break;                                   
 
@@ -904,7 +988,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
 
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    pushcopy(stack, fSuccess ? vchTrue : vchFalse);
                     if (opcode == OP_CHECKSIGVERIFY)
                     {
                         if (fSuccess)
@@ -1011,7 +1095,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                         return set_error(serror, SCRIPT_ERR_SIG_NULLDUMMY);
                     popstack(stack);
 
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    pushcopy(stack, fSuccess ? vchTrue : vchFalse);
 
                     if (opcode == OP_CHECKMULTISIGVERIFY)
                     {
@@ -1164,6 +1248,50 @@ uint256 GetOutputsHash(const CTransaction& txTo) {
     return ss.GetHash();
 }
 
+//! Serialized size of an input with its script blanked: prevout, empty script, nSequence
+const size_t BLANKED_INPUT_SIZE = 32 + 4 + 1 + 4;
+
+/** Like CHashWriter, but resuming from a SHA256 midstate */
+class CMidstateHashWriter
+{
+private:
+    CSHA256 ctx;
+
+public:
+    explicit CMidstateHashWriter(const CSHA256& ctxIn) : ctx(ctxIn) {}
+
+    int GetType() const { return SER_GETHASH; }
+    int GetVersion() const { return 0; }
+
+    void write(const char* pch, size_t size) {
+        ctx.Write((const unsigned char*)pch, size);
+    }
+
+    template<typename T>
+    CMidstateHashWriter& operator<<(const T& obj) {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    uint256 GetHash() {
+        unsigned char buf[CSHA256::OUTPUT_SIZE];
+        uint256 result;
+        ctx.Finalize(buf);
+        CSHA256().Write(buf, sizeof(buf)).Finalize(result.begin());
+        return result;
+    }
+};
+
+/** Whether the legacy signature hashes of txTo are worth precomputing */
+bool HasSeveralScriptSigs(const CTransaction& txTo) {
+    unsigned int nScriptSigs = 0;
+    for (const auto& txin : txTo.vin) {
+        if (!txin.scriptSig.empty() && ++nScriptSigs > 1)
+            return true;
+    }
+    return false;
+}
+
 } // namespace
 
 PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
@@ -1171,6 +1299,28 @@ PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
     hashPrevouts = GetPrevoutHash(txTo);
     hashSequence = GetSequenceHash(txTo);
     hashOutputs = GetOutputsHash(txTo);
+
+    // Witness spends and single inputs gain nothing from it
+    if (!HasSeveralScriptSigs(txTo))
+        return;
+    std::vector<unsigned char> vchHeader;
+    CVectorWriter header(SER_GETHASH, 0, vchHeader, 0);
+    header << txTo.nVersion;
+    WriteCompactSize(header, txTo.vin.size());
+    CVectorWriter inputs(SER_GETHASH, 0, vchLegacyInputs, 0);
+    for (const auto& txin : txTo.vin) {
+        inputs << txin.prevout << CScript() << txin.nSequence;
+    }
+    assert(vchLegacyInputs.size() == txTo.vin.size() * BLANKED_INPUT_SIZE);
+    CVectorWriter(SER_GETHASH, 0, vchLegacyOutputs, 0) << txTo.vout << txTo.nLockTime;
+
+    CSHA256 ctx;
+    ctx.Write(vchHeader.data(), vchHeader.size());
+    vLegacyMidstates.reserve(txTo.vin.size());
+    for (size_t i = 0; i < txTo.vin.size(); i++) {
+        vLegacyMidstates.push_back(ctx);
+        ctx.Write(vchLegacyInputs.data() + i * BLANKED_INPUT_SIZE, BLANKED_INPUT_SIZE);
+    }
 }
 
 uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
@@ -1237,6 +1387,20 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
+    // With SIGHASH_ALL only the input being signed differs from the precomputed serialization
+    if (cache && cache->vLegacyMidstates.size() == txTo.vin.size() && !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        CMidstateHashWriter ss(cache->vLegacyMidstates[nIn]);
+        ss << txTo.vin[nIn].prevout;
+        txTmp.SerializeScriptCode(ss);
+        ss << txTo.vin[nIn].nSequence;
+        const size_t nInputsEnd = (nIn + 1) * BLANKED_INPUT_SIZE;
+        ss.write((const char*)cache->vchLegacyInputs.data() + nInputsEnd, cache->vchLegacyInputs.size() - nInputsEnd);
+        ss.write((const char*)cache->vchLegacyOutputs.data(), cache->vchLegacyOutputs.size());
+        ss << nHashType;
+        return ss.GetHash();
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -1354,6 +1518,7 @@ bool TransactionSignatureChecker::CheckSequence(const CScriptNum& nSequence) con
 static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     std::vector<std::vector<unsigned char> > stack;
+    StackRecycler recycleStack(stack);
     CScript scriptPubKey;
 
     if (witversion == 0) {
@@ -1363,7 +1528,8 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_WITNESS_EMPTY);
             }
             scriptPubKey = CScript(witness.stack.back().begin(), witness.stack.back().end());
-            stack = std::vector<std::vector<unsigned char> >(witness.stack.begin(), witness.stack.end() - 1);
+            for (size_t i = 0; i + 1 < witness.stack.size(); i++)
+                pushcopy(stack, witness.stack[i]);
             uint256 hashScriptPubKey;
             CSHA256().Write(&scriptPubKey[0], scriptPubKey.size()).Finalize(hashScriptPubKey.begin());
             if (memcmp(hashScriptPubKey.begin(), &program[0], 32)) {
@@ -1375,7 +1541,8 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH); // 2 items in witness
             }
             scriptPubKey << OP_DUP << OP_HASH160 << program << OP_EQUALVERIFY << OP_CHECKSIG;
-            stack = witness.stack;
+            for (const valtype& item : witness.stack)
+                pushcopy(stack, item);
         } else {
             return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_WRONG_LENGTH);
         }
@@ -1404,7 +1571,141 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     return true;
 }
 
+namespace {
+
+/** CastToBool over a range of bytes, without copying them into a stack element */
+bool CastBytesToBool(CScript::const_iterator begin, CScript::const_iterator end)
+{
+    for (CScript::const_iterator it = begin; it != end; ++it) {
+        if (*it != 0) {
+            // Can be negative zero
+            return !(it == end - 1 && *it == 0x80);
+        }
+    }
+    return false;
+}
+
+/** Read a direct push of 2 to 75 bytes, which is minimal whatever the data. */
+bool GetDirectPush(const CScript& script, CScript::const_iterator& pc, valtype& data)
+{
+    if (pc == script.end() || *pc < 2 || *pc > 75 || script.end() - pc - 1 < *pc)
+        return false;
+    data.assign(pc + 1, pc + 1 + *pc);
+    pc += 1 + *pc;
+    return true;
+}
+
+bool IsHash160Of(const unsigned char* data, size_t size, CScript::const_iterator hash)
+{
+    unsigned char vch[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, size).Finalize(vch);
+    CRIPEMD160().Write(vch, sizeof(vch)).Finalize(vch);
+    return std::equal(vch, vch + CRIPEMD160::OUTPUT_SIZE, hash);
+}
+
+/**
+ * The signature check that ends every pay-to-pubkeyhash script, once the
+ * stack holds just the signature and a key matching the hash. Fails the way
+ * OP_CHECKSIG followed by the final stack checks would.
+ */
+bool CheckPubKeyHashSig(const valtype& vchSig, const valtype& vchPubKey, const CScript& scriptCode, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror))
+        return false;
+    if (!checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion))
+        return set_error(serror, (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size() ? SCRIPT_ERR_SIG_NULLFAIL : SCRIPT_ERR_EVAL_FALSE);
+    return set_success(serror);
+}
+
+/**
+ * Spend of a version 0 witness program of 20 bytes, starting at program,
+ * once the scriptSig and scriptPubKey have been checked.
+ */
+bool VerifyWitnessPubKeyHash(const CScriptWitness& witness, CScript::const_iterator program, unsigned int flags, const BaseSignatureChecker& checker, bool& fResult, ScriptError* serror)
+{
+    if (witness.stack.size() != 2 || witness.stack[0].size() > MAX_SCRIPT_ELEMENT_SIZE || witness.stack[1].size() > MAX_SCRIPT_ELEMENT_SIZE)
+        return false;
+    if (!IsHash160Of(witness.stack[1].data(), witness.stack[1].size(), program))
+        return false;
+    CScript scriptCode;
+    scriptCode << OP_DUP << OP_HASH160;
+    // The program is preceded by its push opcode in both templates.
+    scriptCode.insert(scriptCode.end(), program - 1, program + 20);
+    scriptCode << OP_EQUALVERIFY << OP_CHECKSIG;
+    fResult = CheckPubKeyHashSig(witness.stack[0], witness.stack[1], scriptCode, flags, checker, SIGVERSION_WITNESS_V0, serror);
+    return true;
+}
+
+/**
+ * Verify spends of the common standard templates (P2PKH, P2WPKH and P2WPKH
+ * nested in P2SH) without running the stack machine: check the key hash,
+ * then the one signature.
+ *
+ * Returns false if the spend does not have exactly the expected form, or
+ * fails before the signature check. EvalScript then handles it, and sets
+ * the exact error. Otherwise the result is in fResult and serror, and is
+ * what the generic path would have come to.
+ */
+bool VerifyStandardScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, bool& fResult, ScriptError* serror)
+{
+    // OP_DUP OP_HASH160 <20 bytes> OP_EQUALVERIFY OP_CHECKSIG
+    if (scriptPubKey.size() == 25 && scriptPubKey[0] == OP_DUP && scriptPubKey[1] == OP_HASH160 &&
+        scriptPubKey[2] == 20 && scriptPubKey[23] == OP_EQUALVERIFY && scriptPubKey[24] == OP_CHECKSIG) {
+        if (!witness.IsNull())
+            return false;
+        valtype vchSig, vchPubKey;
+        CScript::const_iterator pc = scriptSig.begin();
+        if (!GetDirectPush(scriptSig, pc, vchSig) || !GetDirectPush(scriptSig, pc, vchPubKey) || pc != scriptSig.end())
+            return false;
+        // OP_CHECKSIG would delete a push of the signature from the
+        // scriptCode, which can only match the 20 byte hash.
+        if (vchSig.size() == 20)
+            return false;
+        if (!IsHash160Of(vchPubKey.data(), vchPubKey.size(), scriptPubKey.begin() + 3))
+            return false;
+        fResult = CheckPubKeyHashSig(vchSig, vchPubKey, scriptPubKey, flags, checker, SIGVERSION_BASE, serror);
+        return true;
+    }
+
+    if ((flags & SCRIPT_VERIFY_WITNESS) == 0)
+        return false;
+
+    // OP_0 <20 bytes>
+    if (scriptPubKey.size() == 22 && scriptPubKey[0] == OP_0 && scriptPubKey[1] == 20) {
+        if (!scriptSig.empty() || !CastBytesToBool(scriptPubKey.begin() + 2, scriptPubKey.end()))
+            return false;
+        return VerifyWitnessPubKeyHash(witness, scriptPubKey.begin() + 2, flags, checker, fResult, serror);
+    }
+
+    // OP_HASH160 <20 bytes> OP_EQUAL, redeemed by a push of OP_0 <20 bytes>
+    if ((flags & SCRIPT_VERIFY_P2SH) && scriptPubKey.IsPayToScriptHash()) {
+        if (scriptSig.size() != 23 || scriptSig[0] != 22 || scriptSig[1] != OP_0 || scriptSig[2] != 20)
+            return false;
+        if (!IsHash160Of(&scriptSig[1], 22, scriptPubKey.begin() + 2))
+            return false;
+        if (!CastBytesToBool(scriptSig.begin() + 3, scriptSig.end()))
+            return false;
+        return VerifyWitnessPubKeyHash(witness, scriptSig.begin() + 3, flags, checker, fResult, serror);
+    }
+
+    return false;
+}
+
+} // namespace
+
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    static const CScriptWitness emptyWitness;
+    if (witness == nullptr) {
+        witness = &emptyWitness;
+    }
+    bool fResult;
+    if (VerifyStandardScript(scriptSig, scriptPubKey, *witness, flags, checker, fResult, serror))
+        return fResult;
+    return VerifyScriptGeneric(scriptSig, scriptPubKey, witness, flags, checker, serror);
+}
+
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     static const CScriptWitness emptyWitness;
     if (witness == nullptr) {
@@ -1419,11 +1720,14 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
     }
 
     std::vector<std::vector<unsigned char> > stack, stackCopy;
+    StackRecycler recycleStack(stack), recycleStackCopy(stackCopy);
     if (!EvalScript(stack, scriptSig, flags, checker, SIGVERSION_BASE, serror))
         // serror is set
         return false;
-    if (flags & SCRIPT_VERIFY_P2SH)
-        stackCopy = stack;
+    if (flags & SCRIPT_VERIFY_P2SH) {
+        for (const valtype& vch : stack)
+            pushcopy(stackCopy, vch);
+    }
     if (!EvalScript(stack, scriptPubKey, flags, checker, SIGVERSION_BASE, serror))
         // serror is set
         return false;
@@ -7,6 +7,7 @@
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
 #include "script_error.h"
+#include "crypto/sha256.h"
 #include "primitives/transaction.h"
 
 #include <vector>
@@ -114,6 +115,18 @@ struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs;
 
+    /**
+     * Legacy SIGHASH_ALL hashes serialize the whole transaction for every
+     * input, with only the input being signed differing. For transactions
+     * with several signed inputs we keep the SHA256 state after the inputs
+     * before each one, the serialization of all inputs with blanked
+     * scripts, and the serialization of the outputs and nLockTime.
+     */
+    std::vector<CSHA256> vLegacyMidstates;
+    std::vector<unsigned char> vchLegacyInputs;
+    std::vector<unsigned char> vchLegacyOutputs;
+
+    PrecomputedTransactionData() {}
     PrecomputedTransactionData(const CTransaction& tx);
 };
 
@@ -176,6 +189,11 @@ public:
 
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* error = nullptr);
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
+/**
+ * VerifyScript without the shortcut for standard templates, running every
+ * script on the stack machine. The reference the shortcut is tested against.
+ */
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
 
 size_t CountWitnessSigOps(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags);
 
@@ -12,6 +12,9 @@
 #include "util.h"
 
 #include "cuckoocache.h"
+
+#include <atomic>
+
 #include <boost/thread.hpp>
 
 namespace {
@@ -28,9 +31,14 @@ private:
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
     map_type setValid;
     boost::shared_mutex cs_sigcache;
+    uint32_t nCapacity;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nInserts;
+    std::atomic<uint64_t> nEvictions;
 
 public:
-    CSignatureCache()
+    CSignatureCache() : nCapacity(0), nHits(0), nMisses(0), nInserts(0), nEvictions(0)
     {
         GetRandBytes(nonce.begin(), 32);
     }
@@ -38,6 +46,8 @@ public:
     void
     ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
     {
+        // The nonce is replaced when a saved cache is loaded.
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
         CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(&pubkey[0], pubkey.size()).Write(&vchSig[0], vchSig.size()).Finalize(entry.begin());
     }
 
@@ -45,17 +55,48 @@ public:
     Get(const uint256& entry, const bool erase)
     {
         boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        bool fFound = setValid.contains(entry, erase);
+        (fFound ? nHits : nMisses).fetch_add(1, std::memory_order_relaxed);
+        return fFound;
     }
 
     void Set(uint256& entry)
     {
         boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        nInserts.fetch_add(1, std::memory_order_relaxed);
+        if (!setValid.insert(entry))
+            nEvictions.fetch_add(1, std::memory_order_relaxed);
     }
     uint32_t setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        nCapacity = setValid.setup_bytes(n);
+        return nCapacity;
+    }
+
+    SignatureCacheStats GetStats()
+    {
+        SignatureCacheStats stats;
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+        stats.nInserts = nInserts;
+        stats.nEvictions = nEvictions;
+        stats.nCapacity = nCapacity;
+        return stats;
+    }
+
+    void GetEntries(uint256& nonceOut, std::vector<uint256>& entries)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        nonceOut = nonce;
+        setValid.for_each([&entries](const uint256& entry) { entries.push_back(entry); });
+    }
+
+    void LoadEntries(const uint256& nonceIn, const std::vector<uint256>& entries)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        nonce = nonceIn;
+        for (uint256 entry : entries)
+            setValid.insert(entry);
     }
 };
 
@@ -80,6 +121,21 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+void GetSignatureCacheEntries(uint256& nonce, std::vector<uint256>& entries)
+{
+    signatureCache.GetEntries(nonce, entries);
+}
+
+void LoadSignatureCacheEntries(const uint256& nonce, const std::vector<uint256>& entries)
+{
+    signatureCache.LoadEntries(nonce, entries);
+}
+
+SignatureCacheStats GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -92,3 +148,19 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
         signatureCache.Set(entry);
     return true;
 }
+
+bool BatchingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    if (batch.IsVerified()) {
+        int nPos = batch.Find(pubkey, sighash, vchSig, nBatchBegin);
+        if (nPos >= 0)
+            return batch.IsValid(nPos);
+        return CachingTransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash);
+    }
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
+    if (signatureCache.Get(entry, true))
+        return true;
+    batch.Add(pubkey, sighash, vchSig);
+    return true;
+}
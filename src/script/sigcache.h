@@ -18,6 +18,8 @@ static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
 class CPubKey;
+class CSignatureBatch;
+class uint256;
 
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
@@ -40,6 +42,17 @@ public:
     }
 };
 
+/** Activity of a signature or script execution cache since startup */
+struct SignatureCacheStats
+{
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nInserts;
+    //! Inserts which pushed out an entry that was still live
+    uint64_t nEvictions;
+    size_t nCapacity;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -51,6 +64,32 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
+/**
+ * Signature checker that defers the signatures missing from the cache to a
+ * CSignatureBatch, assuming they are valid until the batch is verified. If
+ * they all turn out valid, the script did what it would have done with every
+ * signature checked. Otherwise it has to be run again with a checker over
+ * the verified batch and the same nBatchBegin, which answers the signatures
+ * deferred from nBatchBegin on from the batch and checks any others directly.
+ */
+class BatchingTransactionSignatureChecker : public CachingTransactionSignatureChecker
+{
+private:
+    CSignatureBatch& batch;
+    const size_t nBatchBegin;
+
+public:
+    BatchingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, PrecomputedTransactionData& txdataIn, CSignatureBatch& batchIn, size_t nBatchBeginIn) : CachingTransactionSignatureChecker(txToIn, nInIn, amountIn, false, txdataIn), batch(batchIn), nBatchBegin(nBatchBeginIn) {}
+
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
+};
+
 void InitSignatureCache();
 
+/** Copy the nonce and the live entries of the signature cache, to save it. */
+void GetSignatureCacheEntries(uint256& nonce, std::vector<uint256>& entries);
+/** Add saved entries to the signature cache, switching it to the nonce they were computed with. */
+void LoadSignatureCacheEntries(const uint256& nonce, const std::vector<uint256>& entries);
+SignatureCacheStats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -381,6 +381,32 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_verify(
     const secp256k1_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/** Verify several ECDSA signatures, sharing work between them.
+ *
+ *  Returns: 1: all signatures are correct
+ *           0: at least one signature is incorrect or unparseable
+ *  Args:    ctx:       a secp256k1 context object, initialized for verification.
+ *  Out:     results:   if not NULL, an array of n ints, each set to 1 if the
+ *                      corresponding signature is correct and 0 otherwise
+ *  In:      sigs:      array of n pointers to the signatures being verified
+ *           msgs32:    array of n pointers to the 32-byte message hashes
+ *           pubkeys:   array of n pointers to initialized public keys
+ *           n:         the number of signatures
+ *
+ * Each result is the same as secp256k1_ecdsa_verify would give for that
+ * signature, so in particular only lower-S signatures are accepted. Verifying
+ * a batch is faster than verifying its signatures one at a time because the
+ * modular inversions are shared.
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_verify_batch(
+    const secp256k1_context* ctx,
+    int *results,
+    const secp256k1_ecdsa_signature * const *sigs,
+    const unsigned char * const *msgs32,
+    const secp256k1_pubkey * const *pubkeys,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
 /** Convert a signature to a normalized lower-S form.
  *
  *  Returns: 1 if sigin was not normalized, 0 if it already was.
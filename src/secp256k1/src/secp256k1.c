@@ -25,6 +25,9 @@
     } \
 } while(0)
 
+/* Number of signatures secp256k1_ecdsa_verify_batch inverts together. */
+#define ECDSA_VERIFY_BATCH_CHUNK 64
+
 static void default_illegal_callback_fn(const char* str, void* data) {
     (void)data;
     fprintf(stderr, "[libsecp256k1] illegal argument: %s\n", str);
@@ -307,6 +310,62 @@ int secp256k1_ecdsa_verify(const secp256k1_context* ctx, const secp256k1_ecdsa_s
             secp256k1_ecdsa_sig_verify(&ctx->ecmult_ctx, &r, &s, &q, &m));
 }
 
+int secp256k1_ecdsa_verify_batch(const secp256k1_context* ctx, int *results, const secp256k1_ecdsa_signature * const *sigs, const unsigned char * const *msgs32, const secp256k1_pubkey * const *pubkeys, size_t n) {
+    /* The s values of a chunk are inverted together with Montgomery's trick:
+     * one inversion and three multiplications per signature instead of one
+     * inversion per signature. */
+    secp256k1_scalar r[ECDSA_VERIFY_BATCH_CHUNK];
+    secp256k1_scalar s[ECDSA_VERIFY_BATCH_CHUNK];
+    secp256k1_scalar prefix[ECDSA_VERIFY_BATCH_CHUNK];
+    int ok[ECDSA_VERIFY_BATCH_CHUNK];
+    secp256k1_scalar acc, inv, m;
+    secp256k1_ge q;
+    size_t start, count, i;
+    int all = 1;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n == 0 || sigs != NULL);
+    ARG_CHECK(n == 0 || msgs32 != NULL);
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+
+    for (start = 0; start < n; start += count) {
+        count = n - start < ECDSA_VERIFY_BATCH_CHUNK ? n - start : ECDSA_VERIFY_BATCH_CHUNK;
+        secp256k1_scalar_set_int(&acc, 1);
+        for (i = 0; i < count; i++) {
+            ARG_CHECK(sigs[start + i] != NULL);
+            ARG_CHECK(msgs32[start + i] != NULL);
+            ARG_CHECK(pubkeys[start + i] != NULL);
+            secp256k1_ecdsa_signature_load(ctx, &r[i], &s[i], sigs[start + i]);
+            ok[i] = !secp256k1_scalar_is_high(&s[i]) && !secp256k1_scalar_is_zero(&r[i]) && !secp256k1_scalar_is_zero(&s[i]);
+            if (ok[i]) {
+                prefix[i] = acc;
+                secp256k1_scalar_mul(&acc, &acc, &s[i]);
+            }
+        }
+        secp256k1_scalar_inverse_var(&inv, &acc);
+        /* Walk back, turning each s into its inverse. */
+        for (i = count; i-- > 0;) {
+            if (ok[i]) {
+                secp256k1_scalar si = s[i];
+                secp256k1_scalar_mul(&s[i], &inv, &prefix[i]);
+                secp256k1_scalar_mul(&inv, &inv, &si);
+            }
+        }
+        for (i = 0; i < count; i++) {
+            if (ok[i]) {
+                secp256k1_scalar_set_b32(&m, msgs32[start + i], NULL);
+                ok[i] = secp256k1_pubkey_load(ctx, &q, pubkeys[start + i]) &&
+                        secp256k1_ecdsa_sig_verify_sinv(&ctx->ecmult_ctx, &r[i], &s[i], &q, &m);
+            }
+            if (results != NULL) {
+                results[start + i] = ok[i];
+            }
+            all &= ok[i];
+        }
+    }
+    return all;
+}
+
 static int nonce_function_rfc6979(unsigned char *nonce32, const unsigned char *msg32, const unsigned char *key32, const unsigned char *algo16, void *data, unsigned int counter) {
    unsigned char keydata[112];
    int keylen = 64;
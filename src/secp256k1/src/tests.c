@@ -3384,6 +3384,64 @@ void run_ecdsa_sign_verify(void) {
     }
 }
 
+void test_ecdsa_verify_batch(void) {
+    /* Up to two chunks and a bit, with some signatures broken in various ways. */
+    secp256k1_ecdsa_signature sig[130];
+    secp256k1_pubkey pubkey[130];
+    unsigned char msg[130][32];
+    const secp256k1_ecdsa_signature *sigptr[130];
+    const unsigned char *msgptr[130];
+    const secp256k1_pubkey *pubkeyptr[130];
+    int results[130];
+    int expected[130];
+    size_t n = 1 + secp256k1_rand_int(130);
+    size_t i;
+    int all = 1;
+    for (i = 0; i < n; i++) {
+        unsigned char key[32];
+        secp256k1_scalar k, r, s;
+        random_scalar_order_test(&k);
+        secp256k1_scalar_get_b32(key, &k);
+        secp256k1_rand256_test(msg[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkey[i], key) == 1);
+        CHECK(secp256k1_ecdsa_sign(ctx, &sig[i], msg[i], key, NULL, NULL) == 1);
+        secp256k1_ecdsa_signature_load(ctx, &r, &s, &sig[i]);
+        switch (secp256k1_rand_int(16)) {
+        case 0:
+            msg[i][0] ^= 1;
+            break;
+        case 1:
+            secp256k1_scalar_negate(&s, &s);
+            break;
+        case 2:
+            secp256k1_scalar_clear(&s);
+            break;
+        case 3:
+            secp256k1_scalar_clear(&r);
+            break;
+        }
+        secp256k1_ecdsa_signature_save(&sig[i], &r, &s);
+        sigptr[i] = &sig[i];
+        msgptr[i] = msg[i];
+        pubkeyptr[i] = &pubkey[i];
+        expected[i] = secp256k1_ecdsa_verify(ctx, &sig[i], msg[i], &pubkey[i]);
+        all &= expected[i];
+    }
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, results, sigptr, msgptr, pubkeyptr, n) == all);
+    for (i = 0; i < n; i++) {
+        CHECK(results[i] == expected[i]);
+    }
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, NULL, sigptr, msgptr, pubkeyptr, n) == all);
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, NULL, NULL, NULL, NULL, 0) == 1);
+}
+
+void run_ecdsa_verify_batch(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_verify_batch();
+    }
+}
+
 /** Dummy nonce generation function that just uses a precomputed nonce, and fails if it is not accepted. Use only for testing. */
 static int precomputed_nonce_function(unsigned char *nonce32, const unsigned char *msg32, const unsigned char *key32, const unsigned char *algo16, void *data, unsigned int counter) {
     (void)msg32;
@@ -4514,6 +4572,7 @@ int main(int argc, char **argv) {
     run_random_pubkeys();
     run_ecdsa_der_parse();
     run_ecdsa_sign_verify();
+    run_ecdsa_verify_batch();
     run_ecdsa_end_to_end();
     run_ecdsa_edge_cases();
 #ifdef ENABLE_OPENSSL_TESTS
@@ -0,0 +1,168 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "startupprofile.h"
+
+#include "fs.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <mutex>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+#include <univalue.h>
+
+namespace {
+
+struct ResourceUsage
+{
+    int64_t nCPUTime;
+    uint64_t nReadBytes;
+    uint64_t nWriteBytes;
+    uint64_t nPeakMemory;
+};
+
+ResourceUsage GetResourceUsage()
+{
+    ResourceUsage usage = {};
+#ifdef WIN32
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        // 100 nanosecond units
+        usage.nCPUTime = ((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+                          (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) / 10;
+    }
+    IO_COUNTERS io;
+    if (GetProcessIoCounters(GetCurrentProcess(), &io)) {
+        usage.nReadBytes = io.ReadTransferCount;
+        usage.nWriteBytes = io.WriteTransferCount;
+    }
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        usage.nCPUTime = (int64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+        // Counted in blocks of 512 bytes
+        usage.nReadBytes = (uint64_t)ru.ru_inblock * 512;
+        usage.nWriteBytes = (uint64_t)ru.ru_oublock * 512;
+#ifdef __APPLE__
+        usage.nPeakMemory = ru.ru_maxrss;
+#else
+        usage.nPeakMemory = (uint64_t)ru.ru_maxrss * 1024;
+#endif
+    }
+#endif
+    return usage;
+}
+
+struct Phase
+{
+    StartupPhaseStats stats;
+    ResourceUsage usageStart;
+};
+
+std::mutex cs_startupProfile;
+std::vector<Phase> vPhases;
+int64_t nProfileStart = 0;
+
+} // namespace
+
+StartupPhase::StartupPhase(const std::string& strName) : fEnded(false)
+{
+    Phase phase;
+    phase.stats.strName = strName;
+    phase.stats.nWallTime = 0;
+    phase.stats.nCPUTime = 0;
+    phase.stats.nReadBytes = 0;
+    phase.stats.nWriteBytes = 0;
+    phase.stats.nPeakMemory = 0;
+    phase.stats.fRunning = true;
+    phase.usageStart = GetResourceUsage();
+    const int64_t nNow = GetTimeMicros();
+
+    std::lock_guard<std::mutex> lock(cs_startupProfile);
+    if (vPhases.empty())
+        nProfileStart = nNow;
+    phase.stats.nStart = nNow;
+    nIndex = vPhases.size();
+    vPhases.push_back(std::move(phase));
+}
+
+StartupPhase::~StartupPhase()
+{
+    End();
+}
+
+void StartupPhase::End()
+{
+    if (fEnded)
+        return;
+    fEnded = true;
+    const ResourceUsage usage = GetResourceUsage();
+    const int64_t nNow = GetTimeMicros();
+
+    std::lock_guard<std::mutex> lock(cs_startupProfile);
+    Phase& phase = vPhases[nIndex];
+    phase.stats.nWallTime = nNow - phase.stats.nStart;
+    phase.stats.nCPUTime = usage.nCPUTime - phase.usageStart.nCPUTime;
+    phase.stats.nReadBytes = usage.nReadBytes - phase.usageStart.nReadBytes;
+    phase.stats.nWriteBytes = usage.nWriteBytes - phase.usageStart.nWriteBytes;
+    phase.stats.nPeakMemory = usage.nPeakMemory;
+    phase.stats.fRunning = false;
+    LogPrintf("Startup phase %s took %.3fs (%.3fs CPU)\n", phase.stats.strName, phase.stats.nWallTime / 1000000.0, phase.stats.nCPUTime / 1000000.0);
+}
+
+std::vector<StartupPhaseStats> GetStartupProfile()
+{
+    const int64_t nNow = GetTimeMicros();
+    std::lock_guard<std::mutex> lock(cs_startupProfile);
+    std::vector<StartupPhaseStats> vStats;
+    vStats.reserve(vPhases.size());
+    for (const Phase& phase : vPhases) {
+        vStats.push_back(phase.stats);
+        if (phase.stats.fRunning)
+            vStats.back().nWallTime = nNow - phase.stats.nStart;
+        vStats.back().nStart -= nProfileStart;
+    }
+    return vStats;
+}
+
+UniValue StartupProfileToJSON()
+{
+    UniValue phases(UniValue::VARR);
+    for (const StartupPhaseStats& stats : GetStartupProfile()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("name", stats.strName));
+        obj.push_back(Pair("start", stats.nStart / 1000000.0));
+        obj.push_back(Pair("wall", stats.nWallTime / 1000000.0));
+        obj.push_back(Pair("cpu", stats.nCPUTime / 1000000.0));
+        obj.push_back(Pair("read_bytes", stats.nReadBytes));
+        obj.push_back(Pair("write_bytes", stats.nWriteBytes));
+        obj.push_back(Pair("peak_memory", stats.nPeakMemory));
+        obj.push_back(Pair("running", stats.fRunning));
+        phases.push_back(obj);
+    }
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("phases", phases));
+    return result;
+}
+
+void DumpStartupProfile()
+{
+    const std::string strJSON = StartupProfileToJSON().write(2) + "\n";
+    const fs::path path = GetDataDir() / "startup.json";
+    const fs::path pathTmp = GetDataDir() / "startup.json.new";
+    FILE* file = fsbridge::fopen(pathTmp, "wb");
+    if (!file) {
+        LogPrintf("%s: Failed to write %s\n", __func__, path.string());
+        return;
+    }
+    const bool fWritten = fwrite(strJSON.data(), 1, strJSON.size(), file) == strJSON.size();
+    fclose(file);
+    if (!fWritten || !RenameOver(pathTmp, path)) {
+        LogPrintf("%s: Failed to write %s\n", __func__, path.string());
+    }
+}
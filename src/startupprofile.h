@@ -0,0 +1,59 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_STARTUPPROFILE_H
+#define BITCOIN_STARTUPPROFILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/** Resources used by one phase of startup */
+struct StartupPhaseStats
+{
+    std::string strName;
+    //! Microseconds from the start of the first phase to the start of this one
+    int64_t nStart;
+    //! Microseconds of wall clock time
+    int64_t nWallTime;
+    //! Microseconds of CPU time, user and system, of all threads
+    int64_t nCPUTime;
+    //! Bytes read from and written to storage (not served from the page cache)
+    uint64_t nReadBytes;
+    uint64_t nWriteBytes;
+    //! Largest resident size of the process up to the end of the phase, 0 if unknown
+    uint64_t nPeakMemory;
+    bool fRunning;
+};
+
+/**
+ * A phase of startup, measured from construction until End() or destruction.
+ * CPU time and I/O are counted for the whole process, so phases that run at
+ * the same time (block import and the rest of init) include each other's
+ * share, and an enclosing phase includes those inside it.
+ */
+class StartupPhase
+{
+private:
+    size_t nIndex;
+    bool fEnded;
+
+public:
+    explicit StartupPhase(const std::string& strName);
+    ~StartupPhase();
+
+    void End();
+};
+
+/** All phases so far, in the order they started. */
+std::vector<StartupPhaseStats> GetStartupProfile();
+
+UniValue StartupProfileToJSON();
+
+/** Write the phases so far to startup.json in the data directory. */
+void DumpStartupProfile();
+
+#endif // BITCOIN_STARTUPPROFILE_H
@@ -138,6 +138,68 @@ private:
     size_t nPos;
 };
 
+/* Minimal stream for reading from an existing byte vector, without copying it
+ */
+class CVectorReader
+{
+ public:
+
+/*
+ * @param[in]  nTypeIn Serialization Type
+ * @param[in]  nVersionIn Serialization Version (including any flags)
+ * @param[in]  vchDataIn  Referenced byte vector to read from
+ * @param[in]  nPosIn Starting position. Vector index where reads should start.
+*/
+    CVectorReader(int nTypeIn, int nVersionIn, const std::vector<unsigned char>& vchDataIn, size_t nPosIn) : nType(nTypeIn), nVersion(nVersionIn), vchData(vchDataIn), nPos(nPosIn)
+    {
+        if (nPos > vchData.size())
+            throw std::ios_base::failure("CVectorReader(...): end of data");
+    }
+    void read(char* pch, size_t nSize)
+    {
+        if (nSize > vchData.size() - nPos)
+            throw std::ios_base::failure("CVectorReader::read(): end of data");
+        if (nSize) {
+            memcpy(pch, vchData.data() + nPos, nSize);
+        }
+        nPos += nSize;
+    }
+    void ignore(size_t nSize)
+    {
+        if (nSize > vchData.size() - nPos)
+            throw std::ios_base::failure("CVectorReader::ignore(): end of data");
+        nPos += nSize;
+    }
+    template<typename T>
+    CVectorReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+    int GetVersion() const
+    {
+        return nVersion;
+    }
+    int GetType() const
+    {
+        return nType;
+    }
+    size_t size() const
+    {
+        return vchData.size() - nPos;
+    }
+    bool empty() const
+    {
+        return vchData.size() == nPos;
+    }
+private:
+    const int nType;
+    const int nVersion;
+    const std::vector<unsigned char>& vchData;
+    size_t nPos;
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -647,6 +709,16 @@ public:
         }
     }
 
+    // skip nSize bytes
+    void ignore(size_t nSize) {
+        char buf[4096];
+        while (nSize > 0) {
+            size_t nNow = std::min(nSize, sizeof(buf));
+            read(buf, nNow);
+            nSize -= nNow;
+        }
+    }
+
     // return the current reading position
     uint64_t GetPos() {
         return nReadPos;
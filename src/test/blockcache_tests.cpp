@@ -0,0 +1,126 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+#include "chainparams.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CBlock> MakeBlock(uint32_t nNonce)
+{
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << std::vector<unsigned char>(100, 0) << OP_CHECKSIG;
+    pblock->vtx.push_back(MakeTransactionRef(std::move(tx)));
+    pblock->nNonce = nNonce;
+    return pblock;
+}
+
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    for (uint32_t i = 0; i < 4; i++) {
+        blocks.push_back(MakeBlock(i));
+    }
+
+    CBlockCache cache(1 << 20);
+    cache.Insert(blocks[0]);
+    BOOST_CHECK(cache.Get(blocks[0]->GetHash()) == blocks[0]);
+    BOOST_CHECK(cache.Get(blocks[1]->GetHash()) == nullptr);
+    CBlockCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nBlocks, 1U);
+    BOOST_CHECK_EQUAL(stats.nHits, 1U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1U);
+    const size_t nBlockUsage = stats.nUsage;
+    BOOST_CHECK(nBlockUsage > 0);
+
+    // Room for three blocks: inserting a fourth evicts the least recently used.
+    cache.SetMaxUsage(nBlockUsage * 3);
+    cache.Insert(blocks[1]);
+    cache.Insert(blocks[2]);
+    BOOST_CHECK(cache.Get(blocks[0]->GetHash()) == blocks[0]);
+    cache.Insert(blocks[3]);
+    BOOST_CHECK(cache.Get(blocks[1]->GetHash()) == nullptr);
+    BOOST_CHECK(cache.Get(blocks[0]->GetHash()) != nullptr);
+    BOOST_CHECK(cache.Get(blocks[2]->GetHash()) != nullptr);
+    BOOST_CHECK(cache.Get(blocks[3]->GetHash()) != nullptr);
+    stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nBlocks, 3U);
+    BOOST_CHECK_EQUAL(stats.nUsage, nBlockUsage * 3);
+
+    // Inserting a cached block adds nothing.
+    cache.Insert(blocks[3]);
+    BOOST_CHECK_EQUAL(cache.GetStats().nUsage, nBlockUsage * 3);
+
+    // Shrinking the budget drops blocks, and 0 disables the cache.
+    cache.SetMaxUsage(nBlockUsage);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBlocks, 1U);
+    cache.SetMaxUsage(0);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBlocks, 0U);
+    cache.Insert(blocks[0]);
+    BOOST_CHECK(cache.Get(blocks[0]->GetHash()) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(cold_insert)
+{
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    for (uint32_t i = 0; i < 5; i++) {
+        blocks.push_back(MakeBlock(i));
+    }
+
+    CBlockCache cache(1 << 20);
+    cache.Insert(blocks[0]);
+    const size_t nBlockUsage = cache.GetStats().nUsage;
+    cache.SetMaxUsage(nBlockUsage * 3);
+    cache.Insert(blocks[1]);
+
+    // Old blocks only take the room left, then replace each other.
+    cache.Insert(blocks[2], false);
+    cache.Insert(blocks[3], false);
+    cache.Insert(blocks[4], false);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBlocks, 3U);
+    BOOST_CHECK(cache.Get(blocks[2]->GetHash()) == nullptr);
+    BOOST_CHECK(cache.Get(blocks[3]->GetHash()) == nullptr);
+    BOOST_CHECK(cache.Get(blocks[0]->GetHash()) != nullptr);
+    BOOST_CHECK(cache.Get(blocks[1]->GetHash()) != nullptr);
+
+    // Once asked for again, an old block is kept like a recent one.
+    BOOST_CHECK(cache.Get(blocks[4]->GetHash()) != nullptr);
+    cache.Insert(blocks[2], false);
+    BOOST_CHECK(cache.Get(blocks[4]->GetHash()) != nullptr);
+    BOOST_CHECK(cache.Get(blocks[2]->GetHash()) != nullptr);
+    BOOST_CHECK(cache.Get(blocks[0]->GetHash()) == nullptr);
+
+    // Inserting a cached block as old doesn't demote it.
+    cache.Insert(blocks[4], false);
+    cache.Insert(blocks[3], false);
+    BOOST_CHECK(cache.Get(blocks[4]->GetHash()) != nullptr);
+}
+
+BOOST_FIXTURE_TEST_CASE(read_through_cache, TestingSetup)
+{
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive.Genesis();
+    }
+    BOOST_REQUIRE(pindex != nullptr);
+
+    blockCache.Clear();
+    std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pindex, Params().GetConsensus());
+    BOOST_REQUIRE(pblock != nullptr);
+    BOOST_CHECK(pblock->GetHash() == Params().GenesisBlock().GetHash());
+    // The second read is served from memory.
+    BOOST_CHECK(ReadBlockFromDiskCached(pindex, Params().GetConsensus()) == pblock);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,135 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfileflusher.h"
+#include "utiltime.h"
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfileflusher_tests, BasicTestingSetup)
+
+namespace {
+
+/** Records the files passed to the commit function. */
+class CommitLog
+{
+private:
+    std::mutex cs;
+    std::vector<int> vFiles;
+
+public:
+    void Add(int nFile)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        vFiles.push_back(nFile);
+    }
+
+    std::vector<int> Get()
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        return vFiles;
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(not_running)
+{
+    CommitLog log;
+    CBlockFileFlusher flusher([&](int nFile) { log.Add(nFile); });
+
+    // Without the thread files are synced by the caller.
+    flusher.Commit(1);
+    BOOST_CHECK(log.Get() == std::vector<int>({1}));
+    flusher.SetDirty(2);
+    flusher.Sync();
+    BOOST_CHECK(log.Get() == std::vector<int>({1}));
+}
+
+BOOST_AUTO_TEST_CASE(commit_and_sync)
+{
+    CommitLog log;
+    CBlockFileFlusher flusher([&](int nFile) { log.Add(nFile); });
+    flusher.Start();
+
+    flusher.Commit(1);
+    flusher.Sync();
+    BOOST_CHECK(log.Get() == std::vector<int>({1}));
+
+    // Files still written to are synced by Sync() too, not only by the timer.
+    flusher.SetDirty(2);
+    flusher.SetDirty(3);
+    flusher.Sync();
+    BOOST_CHECK(log.Get() == std::vector<int>({1, 2, 3}));
+
+    // Nothing is left to sync.
+    flusher.Sync();
+    BOOST_CHECK(log.Get().size() == 3);
+    flusher.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(forget)
+{
+    CommitLog log;
+    CBlockFileFlusher flusher([&](int nFile) { log.Add(nFile); });
+    flusher.Start();
+
+    flusher.SetDirty(1);
+    flusher.SetDirty(2);
+    flusher.Forget(1);
+    flusher.Sync();
+    BOOST_CHECK(log.Get() == std::vector<int>({2}));
+    flusher.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(forget_waits_for_commit)
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    bool fEntered = false;
+    bool fRelease = false;
+    std::atomic<bool> fCommitted(false);
+    CBlockFileFlusher flusher([&](int nFile) {
+        std::unique_lock<std::mutex> lock(cs);
+        fEntered = true;
+        cond.notify_all();
+        cond.wait(lock, [&] { return fRelease; });
+        fCommitted = true;
+    });
+    flusher.Start();
+
+    // Let the thread take file 1 and block while syncing it.
+    flusher.Commit(1);
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        cond.wait(lock, [&] { return fEntered; });
+    }
+
+    std::atomic<bool> fForgotten(false);
+    std::thread forget([&] {
+        flusher.Forget(1);
+        fForgotten = true;
+    });
+    MilliSleep(50);
+    BOOST_CHECK(!fForgotten);
+
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fRelease = true;
+    }
+    cond.notify_all();
+    forget.join();
+    BOOST_CHECK(fCommitted);
+    BOOST_CHECK(fForgotten);
+    flusher.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
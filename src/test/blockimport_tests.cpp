@@ -0,0 +1,75 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockimport_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(import_known_blocks)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    const fs::path path = GetDataDir() / "bootstrap.dat";
+    {
+        // Copies of a known block, with garbage and a truncated copy in between.
+        CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!fileout.IsNull());
+        unsigned int nSize = GetSerializeSize(fileout, genesis);
+        for (int i = 0; i < 200; i++) {
+            fileout << FLATDATA(Params().MessageStart()) << nSize << genesis;
+            if (i % 50 == 0) {
+                fileout << std::string("garbage");
+                fileout << FLATDATA(Params().MessageStart()) << (nSize / 2);
+            }
+        }
+    }
+
+    // Nothing new to load, but every copy is read, checked and skipped.
+    FILE* file = fsbridge::fopen(path, "rb");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_CHECK(!LoadExternalBlockFile(Params(), file));
+    BOOST_CHECK(!ReindexBlockFiles(Params()));
+
+    LOCK(cs_main);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == genesis.GetHash());
+    BOOST_CHECK_EQUAL(chainActive.Height(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(reindex_rewrites_block_files)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = chainActive.Genesis()->GetBlockPos();
+    }
+    std::vector<unsigned char> vchStandard;
+    BOOST_REQUIRE(ReadRawBlockFromDisk(vchStandard, pos, Params().MessageStart()));
+
+    unsigned int nSize;
+    bool fCompact;
+    for (bool fCompress : {true, false}) {
+        fCompressBlocks = fCompress;
+        ReindexBlockFiles(Params());
+        BOOST_REQUIRE(ReadBlockRecordHeader(pos, Params().MessageStart(), nSize, fCompact));
+        BOOST_CHECK_EQUAL(fCompact, fCompress);
+        BOOST_CHECK_EQUAL(nSize < vchStandard.size(), fCompress);
+
+        // Either way readers see the same block.
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pos, Params().GetConsensus()));
+        BOOST_CHECK(block.GetHash() == genesis.GetHash());
+        std::vector<unsigned char> vchBlock;
+        BOOST_REQUIRE(ReadRawBlockFromDisk(vchBlock, pos, Params().MessageStart()));
+        BOOST_CHECK(vchBlock == vchStandard);
+    }
+    fCompressBlocks = DEFAULT_COMPRESS_BLOCKS;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -141,14 +141,20 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CWorkStealingCheckQueue<FakeCheckCheckCompletion> Stealing_Correct_Queue;
+typedef CWorkStealingCheckQueue<FailingCheck> Stealing_Failing_Queue;
+typedef CWorkStealingCheckQueue<UniqueCheck> Stealing_Unique_Queue;
+typedef CWorkStealingCheckQueue<MemoryCheck> Stealing_Memory_Queue;
+typedef CWorkStealingCheckQueue<FrozenCleanupCheck> Stealing_FrozenCleanup_Queue;
 
 
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
  */
+template <typename Queue = Correct_Queue>
 void Correct_Queue_range(std::vector<size_t> range)
 {
-    auto small_queue = std::unique_ptr<Correct_Queue>(new Correct_Queue {QUEUE_BATCH_SIZE});
+    auto small_queue = std::unique_ptr<Queue>(new Queue {QUEUE_BATCH_SIZE});
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{small_queue->Thread();});
@@ -158,7 +164,7 @@ void Correct_Queue_range(std::vector<size_t> range)
     for (auto i : range) {
         size_t total = i;
         FakeCheckCheckCompletion::n_calls = 0;
-        CCheckQueueControl<FakeCheckCheckCompletion> control(small_queue.get());
+        CCheckQueueControl<FakeCheckCheckCompletion, Queue> control(small_queue.get());
         while (total) {
             vChecks.resize(std::min(total, (size_t) InsecureRandRange(10)));
             total -= vChecks.size();
@@ -438,5 +444,136 @@ BOOST_AUTO_TEST_CASE(test_CheckQueueControl_Locks)
         tg.join_all();
     }
 }
+/** Test that the work-stealing queue runs every check exactly once, for
+ * any number of checks, including ones that span several batches.
+ */
+BOOST_AUTO_TEST_CASE(test_WorkStealingCheckQueue_Correct)
+{
+    std::vector<size_t> range{0, 1, QUEUE_BATCH_SIZE - 1, QUEUE_BATCH_SIZE, QUEUE_BATCH_SIZE + 1, 100000};
+    for (size_t i = 2; i < 100000; i += std::max((size_t)1, (size_t)InsecureRandRange(std::min((size_t)1000, ((size_t)100000) - i))))
+        range.push_back(i);
+    Correct_Queue_range<Stealing_Correct_Queue>(range);
+
+    // Batches of one check each, many more of them than the deque starts with.
+    auto queue = std::unique_ptr<Stealing_Unique_Queue>(new Stealing_Unique_Queue {1});
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+       tg.create_thread([&]{queue->Thread();});
+    }
+    UniqueCheck::results.clear();
+    size_t COUNT = 10000;
+    {
+        CCheckQueueControl<UniqueCheck, Stealing_Unique_Queue> control(queue.get());
+        std::vector<UniqueCheck> vChecks;
+        for (size_t i = 0; i < COUNT; i++)
+            vChecks.emplace_back(i);
+        control.Add(vChecks);
+        BOOST_REQUIRE(control.Wait());
+    }
+    BOOST_REQUIRE_EQUAL(UniqueCheck::results.size(), COUNT);
+    bool r = true;
+    for (size_t i = 0; i < COUNT; ++i)
+        r = r && UniqueCheck::results.count(i) == 1;
+    BOOST_REQUIRE(r);
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+/** Test that the work-stealing queue catches failures and that a failure does
+ * not leak into the next round.
+ */
+BOOST_AUTO_TEST_CASE(test_WorkStealingCheckQueue_Failure)
+{
+    auto fail_queue = std::unique_ptr<Stealing_Failing_Queue>(new Stealing_Failing_Queue {QUEUE_BATCH_SIZE});
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+       tg.create_thread([&]{fail_queue->Thread();});
+    }
+
+    for (size_t i = 0; i < 1001; ++i) {
+        CCheckQueueControl<FailingCheck, Stealing_Failing_Queue> control(fail_queue.get());
+        size_t remaining = i;
+        while (remaining) {
+            size_t r = InsecureRandRange(10);
+            std::vector<FailingCheck> vChecks;
+            vChecks.reserve(r);
+            for (size_t k = 0; k < r && remaining; k++, remaining--)
+                vChecks.emplace_back(remaining == 1);
+            control.Add(vChecks);
+        }
+        BOOST_REQUIRE_EQUAL(control.Wait(), i == 0);
+    }
+    for (auto times = 0; times < 10; ++times) {
+        for (bool end_fails : {true, false}) {
+            CCheckQueueControl<FailingCheck, Stealing_Failing_Queue> control(fail_queue.get());
+            std::vector<FailingCheck> vChecks;
+            vChecks.resize(1000, false);
+            vChecks[999] = end_fails;
+            control.Add(vChecks);
+            BOOST_REQUIRE_EQUAL(control.Wait(), !end_fails);
+        }
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+/** Test that the work-stealing queue destroys every check before Wait
+ * returns, so a new verification never sees leftovers of the previous one.
+ */
+BOOST_AUTO_TEST_CASE(test_WorkStealingCheckQueue_Cleanup)
+{
+    {
+        auto queue = std::unique_ptr<Stealing_Memory_Queue>(new Stealing_Memory_Queue {QUEUE_BATCH_SIZE});
+        boost::thread_group tg;
+        for (auto x = 0; x < nScriptCheckThreads; ++x) {
+           tg.create_thread([&]{queue->Thread();});
+        }
+        for (size_t i = 0; i < 1000; ++i) {
+            size_t total = i;
+            {
+                CCheckQueueControl<MemoryCheck, Stealing_Memory_Queue> control(queue.get());
+                while (total) {
+                    size_t r = InsecureRandRange(10);
+                    std::vector<MemoryCheck> vChecks;
+                    for (size_t k = 0; k < r && total; k++) {
+                        total--;
+                        vChecks.emplace_back(total == 0 || total == i || total == i/2);
+                    }
+                    control.Add(vChecks);
+                }
+            }
+            BOOST_REQUIRE_EQUAL(MemoryCheck::fake_allocated_memory, 0);
+        }
+        tg.interrupt_all();
+        tg.join_all();
+    }
+
+    auto queue = std::unique_ptr<Stealing_FrozenCleanup_Queue>(new Stealing_FrozenCleanup_Queue {QUEUE_BATCH_SIZE});
+    boost::thread_group tg;
+    bool fails = false;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+        tg.create_thread([&]{queue->Thread();});
+    }
+    std::thread t0([&]() {
+        CCheckQueueControl<FrozenCleanupCheck, Stealing_FrozenCleanup_Queue> control(queue.get());
+        std::vector<FrozenCleanupCheck> vChecks(1);
+        vChecks[0].should_freeze = true;
+        control.Add(vChecks);
+        control.Wait(); // Hangs here
+    });
+    {
+        std::unique_lock<std::mutex> l(FrozenCleanupCheck::m);
+        FrozenCleanupCheck::cv.wait(l, [](){return FrozenCleanupCheck::nFrozen == 1;});
+        for (auto x = 0; x < 100 && !fails; ++x) {
+            fails = queue->ControlMutex.try_lock();
+        }
+        FrozenCleanupCheck::nFrozen = 0;
+    }
+    FrozenCleanupCheck::cv.notify_one();
+    t0.join();
+    tg.interrupt_all();
+    tg.join_all();
+    BOOST_REQUIRE(!fails);
+}
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,117 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coins.h"
+#include "coinstats.h"
+#include "streams.h"
+#include "txdb.h"
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(coinstats_tests, TestingSetup)
+
+static Coin RandomCoin()
+{
+    CTxOut out;
+    out.nValue = InsecureRandRange(1000000) + 1;
+    out.scriptPubKey = CScript() << ToByteVector(InsecureRand256()) << OP_CHECKSIG;
+    return Coin(out, 1 + InsecureRandRange(1000), InsecureRandBool());
+}
+
+BOOST_AUTO_TEST_CASE(incremental_stats)
+{
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    for (int i = 0; i < 20; i++) {
+        coins.emplace_back(COutPoint(InsecureRand256(), InsecureRandRange(4)), RandomCoin());
+    }
+
+    // Adding the same coins in a different order gives the same statistics.
+    CIncrementalCoinsStats forward, backward;
+    for (const auto& coin : coins) {
+        forward.AddCoin(coin.first, coin.second);
+    }
+    for (auto it = coins.rbegin(); it != coins.rend(); ++it) {
+        backward.AddCoin(it->first, it->second);
+    }
+    BOOST_CHECK(forward.GetHash() == backward.GetHash());
+    BOOST_CHECK_EQUAL(forward.nTransactionOutputs, coins.size());
+    BOOST_CHECK_EQUAL(forward.nTotalAmount, backward.nTotalAmount);
+    BOOST_CHECK_EQUAL(forward.nBogoSize, backward.nBogoSize);
+
+    // Removing a coin is the same as never having added it.
+    CIncrementalCoinsStats partial;
+    for (size_t i = 1; i < coins.size(); i++) {
+        partial.AddCoin(coins[i].first, coins[i].second);
+    }
+    forward.RemoveCoin(coins[0].first, coins[0].second);
+    BOOST_CHECK(forward.GetHash() == partial.GetHash());
+    BOOST_CHECK_EQUAL(forward.nTransactionOutputs, partial.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(forward.nTotalAmount, partial.nTotalAmount);
+    BOOST_CHECK_EQUAL(forward.nBogoSize, partial.nBogoSize);
+
+    // Statistics of disjoint sets can be merged.
+    CIncrementalCoinsStats merged;
+    merged.AddCoin(coins[0].first, coins[0].second);
+    merged += partial;
+    BOOST_CHECK(merged.GetHash() == backward.GetHash());
+    BOOST_CHECK_EQUAL(merged.nTotalAmount, backward.nTotalAmount);
+
+    // A different height is a different coin.
+    CIncrementalCoinsStats other;
+    Coin changed = coins[0].second;
+    changed.nHeight++;
+    other.AddCoin(coins[0].first, changed);
+    other += partial;
+    BOOST_CHECK(other.GetHash() != backward.GetHash());
+
+    // Serialization round trip.
+    CDataStream ss(SER_DISK, 0);
+    ss << backward;
+    CIncrementalCoinsStats read;
+    ss >> read;
+    BOOST_CHECK(read.GetHash() == backward.GetHash());
+    BOOST_CHECK_EQUAL(read.nTransactionOutputs, backward.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(read.nTotalAmount, backward.nTotalAmount);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_scan)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    CIncrementalCoinsStats expected;
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 200; i++) {
+            COutPoint outpoint(InsecureRand256(), InsecureRandRange(4));
+            Coin coin = RandomCoin();
+            expected.AddCoin(outpoint, coin);
+            cache.AddCoin(outpoint, std::move(coin), false);
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // Every partitioning of the txid space covers each coin exactly once.
+    for (int nThreads : {1, 2, 3, 8, 300}) {
+        CIncrementalCoinsStats stats;
+        BOOST_CHECK(ComputeCoinsStats(&db, stats, nThreads));
+        BOOST_CHECK(stats.hashBlock == db.GetBestBlock());
+        BOOST_CHECK_EQUAL(stats.nTransactionOutputs, expected.nTransactionOutputs);
+        BOOST_CHECK_EQUAL(stats.nTotalAmount, expected.nTotalAmount);
+        BOOST_CHECK_EQUAL(stats.nBogoSize, expected.nBogoSize);
+        BOOST_CHECK(stats.GetHash() == expected.GetHash());
+    }
+
+    // Statistics stored alongside the coins come back unchanged.
+    expected.hashBlock = db.GetBestBlock();
+    BOOST_CHECK(db.WriteCoinsStats(expected));
+    CIncrementalCoinsStats read;
+    BOOST_CHECK(db.ReadCoinsStats(read));
+    BOOST_CHECK(read.hashBlock == expected.hashBlock);
+    BOOST_CHECK(read.GetHash() == expected.GetHash());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
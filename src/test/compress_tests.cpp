@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "compressor.h"
+#include "clientversion.h"
+#include "streams.h"
 #include "util.h"
 #include "test/test_bitcoin.h"
 
@@ -62,4 +64,56 @@ BOOST_AUTO_TEST_CASE(compress_amounts)
         BOOST_CHECK(TestDecode(i));
 }
 
+BOOST_AUTO_TEST_CASE(compress_block)
+{
+    CBlock block;
+    block.nVersion = 4;
+    block.nNonce = 42;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    coinbase.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(32, 0));
+    coinbase.vout.resize(2);
+    coinbase.vout[0].nValue = 50 * COIN;
+    coinbase.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    coinbase.vout[1].nValue = 0;
+    coinbase.vout[1].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(36, 2);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+
+    CMutableTransaction spend;
+    spend.nVersion = 2;
+    spend.vin.resize(2);
+    spend.vin[0].prevout = COutPoint(coinbase.GetHash(), 0);
+    spend.vin[0].nSequence = 0;
+    spend.vin[1].prevout = COutPoint(coinbase.GetHash(), 1);
+    spend.vin[1].nSequence = 0xfffffffd;
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 49 * COIN + 12345;
+    spend.vout[0].scriptPubKey = CScript() << OP_HASH160 << std::vector<unsigned char>(20, 3) << OP_EQUAL;
+    spend.nLockTime = 500000;
+    block.vtx.push_back(MakeTransactionRef(spend));
+
+    BOOST_CHECK(CBlockCompressor::IsLossless(block));
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CBlockCompressor(block);
+    BOOST_CHECK(ss.size() < ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION));
+
+    CBlock decoded;
+    ss >> REF(CBlockCompressor(decoded));
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK(decoded.GetHash() == block.GetHash());
+    BOOST_REQUIRE_EQUAL(decoded.vtx.size(), 2U);
+    BOOST_CHECK(decoded.vtx[0]->GetWitnessHash() == block.vtx[0]->GetWitnessHash());
+    BOOST_CHECK(decoded.vtx[1]->GetWitnessHash() == block.vtx[1]->GetWitnessHash());
+
+    // Output scripts CScriptCompressor would not keep rule the encoding out.
+    CMutableTransaction big;
+    big.vout.resize(1);
+    const std::vector<unsigned char> vchScript(MAX_SCRIPT_SIZE + 1, OP_NOP);
+    big.vout[0].scriptPubKey = CScript(vchScript.begin(), vchScript.end());
+    block.vtx.push_back(MakeTransactionRef(big));
+    BOOST_CHECK(!CBlockCompressor::IsLossless(block));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,10 +2,16 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #include <boost/test/unit_test.hpp>
+#include "clientversion.h"
 #include "cuckoocache.h"
+#include "fs.h"
 #include "script/sigcache.h"
+#include "streams.h"
 #include "test/test_bitcoin.h"
 #include "random.h"
+#include "util.h"
+#include "validation.h"
+#include <set>
 #include <thread>
 
 /** Test Suite for CuckooCache
@@ -377,4 +383,86 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/* Test that for_each visits exactly the elements which have not been erased.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_for_each)
+{
+    local_rand_ctx = FastRandomContext(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    cc.setup(1000);
+    std::vector<uint256> hashes(200);
+    for (uint256& h : hashes) {
+        insecure_GetRandHash(h);
+        cc.insert(h);
+    }
+    for (size_t i = 0; i < hashes.size(); i += 2)
+        cc.contains(hashes[i], true);
+
+    std::set<uint256> visited;
+    cc.for_each([&visited](const uint256& h) { visited.insert(h); });
+    BOOST_CHECK_EQUAL(visited.size(), hashes.size() / 2);
+    for (size_t i = 0; i < hashes.size(); ++i)
+        BOOST_CHECK_EQUAL(visited.count(hashes[i]), i % 2);
+}
+
+/* Test that insert reports when it has to push out a live element.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_evictions)
+{
+    local_rand_ctx = FastRandomContext(true);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    cc.setup(16);
+    uint256 v;
+    insecure_GetRandHash(v);
+    BOOST_CHECK(cc.insert(v));
+    // Inserting an element again never evicts anything
+    BOOST_CHECK(cc.insert(v));
+    size_t evictions = 0;
+    for (int x = 0; x < 100; ++x) {
+        insecure_GetRandHash(v);
+        evictions += !cc.insert(v);
+    }
+    size_t live = 0;
+    cc.for_each([&live](const uint256&) { ++live; });
+    // Every element inserted is either live or was evicted, apart from the
+    // ones aged out by the epoch mechanism.
+    BOOST_CHECK(evictions > 0);
+    BOOST_CHECK(live + evictions <= 101);
+}
+
+BOOST_FIXTURE_TEST_CASE(sigcache_persist, TestingSetup)
+{
+    local_rand_ctx = FastRandomContext(true);
+    uint256 nonce;
+    insecure_GetRandHash(nonce);
+    std::vector<uint256> entries(100);
+    for (uint256& h : entries)
+        insecure_GetRandHash(h);
+    LoadSignatureCacheEntries(nonce, entries);
+    DumpSignatureCaches();
+
+    // A restart would come up with a new nonce; loading restores the saved one.
+    uint256 other;
+    insecure_GetRandHash(other);
+    LoadSignatureCacheEntries(other, {});
+    BOOST_CHECK(LoadSignatureCaches());
+
+    uint256 loaded;
+    std::vector<uint256> loadedEntries;
+    GetSignatureCacheEntries(loaded, loadedEntries);
+    BOOST_CHECK(loaded == nonce);
+    std::set<uint256> setLoaded(loadedEntries.begin(), loadedEntries.end());
+    for (const uint256& h : entries)
+        BOOST_CHECK(setLoaded.count(h));
+
+    // A file saved by another client version is discarded.
+    {
+        CAutoFile file(fsbridge::fopen(GetDataDir() / "sigcache.dat", "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_REQUIRE(!file.IsNull());
+        file << (uint64_t)1 << (int)(CLIENT_VERSION + 1);
+        file << nonce << entries << nonce << entries;
+    }
+    BOOST_CHECK(!LoadSignatureCaches());
+}
+
 BOOST_AUTO_TEST_SUITE_END();
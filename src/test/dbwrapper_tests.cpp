@@ -317,6 +317,52 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles)
+{
+    std::string strError;
+    DBProfile defaults = GetDBProfile("chainstate", 1 << 20);
+    BOOST_CHECK_EQUAL(defaults.block_cache_size + 2 * defaults.write_buffer_size, 1U << 20);
+    DBProfile index = GetDBProfile("index", 1 << 20);
+    BOOST_CHECK(index.block_cache_size > defaults.block_cache_size);
+    BOOST_CHECK_EQUAL(index.block_cache_size + 2 * index.write_buffer_size, 1U << 20);
+
+    gArgs.ForceSetArg("-dboption", "chainstate:bloombits:0");
+    BOOST_CHECK(CheckDBOptions(strError));
+    BOOST_CHECK_EQUAL(GetDBProfile("chainstate", 1 << 20).bloom_bits_per_key, 0);
+    BOOST_CHECK_EQUAL(GetDBProfile("index", 1 << 20).bloom_bits_per_key, defaults.bloom_bits_per_key);
+
+    gArgs.ForceSetArg("-dboption", "chainstate:writebuffer:10");
+    BOOST_CHECK(CheckDBOptions(strError));
+    DBProfile profile = GetDBProfile("chainstate", 1000);
+    BOOST_CHECK_EQUAL(profile.write_buffer_size, 100U);
+    BOOST_CHECK_EQUAL(profile.block_cache_size, 800U);
+
+    for (const char* arg : {"chainstate:bloombits", "chainstate:bloombits:x", "blocks:bloombits:10",
+                            "chainstate:nosuchoption:1", "index:compression:2", "index:writebuffer:50"}) {
+        gArgs.ForceSetArg("-dboption", arg);
+        BOOST_CHECK(!CheckDBOptions(strError));
+        BOOST_CHECK(!strError.empty());
+    }
+    gArgs.ClearArg("-dboption");
+    BOOST_CHECK(gArgs.GetArgs("-dboption").empty());
 
+    // Every read of a table block is looked up in the counting block cache.
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CDBWrapper dbw(ph, GetDBProfile("chainstate", 1 << 20), true, false, false);
+    BOOST_CHECK_EQUAL(dbw.GetProfile().name, "chainstate");
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK(dbw.Write(i, InsecureRand256()));
+    }
+    // Move the memtable into a table file so lookups have to go through the cache.
+    dbw.CompactRange(0, 100);
+    uint256 value;
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK(dbw.Read(i, value));
+    }
+    DBStats stats = dbw.GetStats();
+    BOOST_CHECK(stats.cache_hits + stats.cache_misses >= 100);
+    BOOST_CHECK(stats.memory_usage > 0);
+    BOOST_CHECK(!stats.levels.empty());
+}
 
 BOOST_AUTO_TEST_SUITE_END()
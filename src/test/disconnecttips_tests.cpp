@@ -0,0 +1,174 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "coinstats.h"
+#include "consensus/validation.h"
+#include "script/interpreter.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+/**
+ * Reorgs deep enough that DisconnectTips() disconnects the old branch in more
+ * than one batch. The fork is 41 blocks below the tip, the last of which
+ * spends a coin.
+ */
+struct DisconnectTipsSetup : public TestChain100Setup {
+    bool fUTXOStatsOld;
+    CBlockIndex* pindexFork;
+    //! The first and last block of the branch the coinbase key mined on
+    CBlockIndex* pindexFirstOld;
+    CBlockIndex* pindexTipOld;
+    //! The first and last block of the longer branch
+    CBlockIndex* pindexFirstNew;
+    CBlockIndex* pindexTipNew;
+    CIncrementalCoinsStats statsNew;
+
+    DisconnectTipsSetup() : fUTXOStatsOld(fUTXOStats)
+    {
+        // Statistics are tracked on the global coins database.
+        ::pcoinsdbview = pcoinsdbview;
+        fUTXOStats = true;
+        BOOST_REQUIRE(LoadCoinsStats());
+
+        CMutableTransaction tx;
+        tx.nVersion = 1;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 11 * CENT;
+        tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        const CScript scriptCoinbase = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptCoinbase, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        tx.vin[0].scriptSig << vchSig;
+        CreateAndProcessBlock({tx}, scriptCoinbase);
+
+        // Build the longer branch block by block on top of the fork, after
+        // InvalidateBlock() disconnected the old one one block at a time.
+        CValidationState state;
+        {
+            LOCK(cs_main);
+            pindexTipOld = chainActive.Tip();
+            pindexFork = chainActive[pindexTipOld->nHeight - 41];
+            pindexFirstOld = chainActive.Next(pindexFork);
+            BOOST_REQUIRE(InvalidateBlock(state, Params(), pindexFirstOld));
+            BOOST_REQUIRE(chainActive.Tip() == pindexFork);
+        }
+        mempool.clear();
+        CKey key;
+        key.MakeNewKey(true);
+        for (int i = 0; i < 45; i++) {
+            CreateAndProcessBlock({}, CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG);
+        }
+        statsNew = GetCoinsDBStats();
+
+        // Back to the old branch, again one block at a time, leaving the
+        // longer one to be reorged to.
+        {
+            LOCK(cs_main);
+            pindexTipNew = chainActive.Tip();
+            pindexFirstNew = chainActive.Next(pindexFork);
+            BOOST_REQUIRE(InvalidateBlock(state, Params(), pindexFirstNew));
+            BOOST_REQUIRE(ResetBlockFailureFlags(pindexFirstOld));
+        }
+        BOOST_REQUIRE(ActivateBestChain(state, Params()));
+        BOOST_REQUIRE(chainActive.Tip() == pindexTipOld);
+        mempool.clear();
+    }
+
+    ~DisconnectTipsSetup()
+    {
+        fUTXOStats = fUTXOStatsOld;
+        ::pcoinsdbview = nullptr;
+    }
+
+    /** Statistics of the coins database, after flushing the coins cache into it */
+    static CIncrementalCoinsStats GetCoinsDBStats()
+    {
+        FlushStateToDisk();
+        CIncrementalCoinsStats stats;
+        BOOST_CHECK(ComputeCoinsStats(::pcoinsdbview, stats, 1));
+        return stats;
+    }
+
+    /** Whether the tracked statistics match the coins database */
+    static bool TrackedStatsMatch(const CIncrementalCoinsStats& statsDB)
+    {
+        CIncrementalCoinsStats stats;
+        return GetIncrementalCoinsStats(stats) && stats.hashBlock == statsDB.hashBlock &&
+               stats.GetHash() == statsDB.GetHash() && stats.nTransactionOutputs == statsDB.nTransactionOutputs &&
+               stats.nTotalAmount == statsDB.nTotalAmount && stats.nBogoSize == statsDB.nBogoSize;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(disconnecttips_tests, DisconnectTipsSetup)
+
+BOOST_AUTO_TEST_CASE(batched_reorg)
+{
+    BOOST_CHECK(TrackedStatsMatch(GetCoinsDBStats()));
+
+    // Disconnecting the 41 blocks of the old branch in batches ends up with
+    // the same coins as disconnecting them one by one did.
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(ResetBlockFailureFlags(pindexFirstNew));
+    }
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_CHECK(chainActive.Tip() == pindexTipNew);
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == pindexTipNew->GetBlockHash());
+    CIncrementalCoinsStats stats = GetCoinsDBStats();
+    BOOST_CHECK(stats.hashBlock == statsNew.hashBlock);
+    BOOST_CHECK(stats.GetHash() == statsNew.GetHash());
+    BOOST_CHECK_EQUAL(stats.nTransactionOutputs, statsNew.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(stats.nTotalAmount, statsNew.nTotalAmount);
+    BOOST_CHECK(TrackedStatsMatch(stats));
+
+    // The coin spent on the old branch is back.
+    BOOST_CHECK(pcoinsTip->HaveCoin(COutPoint(coinbaseTxns[0].GetHash(), 0)));
+}
+
+BOOST_AUTO_TEST_CASE(missing_undo_mid_batch)
+{
+    const CIncrementalCoinsStats statsOld = GetCoinsDBStats();
+
+    // A block in the middle of the first batch lost its undo data.
+    CValidationState state;
+    CBlockIndex* pindexNoUndo;
+    {
+        LOCK(cs_main);
+        pindexNoUndo = chainActive[pindexTipOld->nHeight - 16];
+        pindexNoUndo->nStatus &= ~BLOCK_HAVE_UNDO;
+        BOOST_CHECK(ResetBlockFailureFlags(pindexFirstNew));
+    }
+    BOOST_CHECK(!ActivateBestChain(state, Params()));
+
+    // None of the batch was applied.
+    BOOST_CHECK(chainActive.Tip() == pindexTipOld);
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == pindexTipOld->GetBlockHash());
+    CIncrementalCoinsStats stats = GetCoinsDBStats();
+    BOOST_CHECK(stats.hashBlock == statsOld.hashBlock);
+    BOOST_CHECK(stats.GetHash() == statsOld.GetHash());
+    BOOST_CHECK(TrackedStatsMatch(stats));
+
+    // Once the undo data is found again the reorg goes through.
+    {
+        LOCK(cs_main);
+        pindexNoUndo->nStatus |= BLOCK_HAVE_UNDO;
+    }
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_CHECK(chainActive.Tip() == pindexTipNew);
+    stats = GetCoinsDBStats();
+    BOOST_CHECK(stats.GetHash() == statsNew.GetHash());
+    BOOST_CHECK(TrackedStatsMatch(stats));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,81 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "mappedfile.h"
+#include "streams.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(mappedfile_tests, TestingSetup)
+
+static void AppendToFile(const fs::path& path, const std::string& str)
+{
+    FILE* file = fsbridge::fopen(path, "ab");
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_REQUIRE_EQUAL(fwrite(str.data(), 1, str.size(), file), str.size());
+    fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_file_cache)
+{
+    const fs::path path = GetDataDir() / "mapped.dat";
+    CMappedFileCache cache(1);
+    BOOST_CHECK(cache.Get(0, path, 0) == nullptr);
+
+    AppendToFile(path, "abcd");
+    std::shared_ptr<const CMappedFile> file = cache.Get(0, path, 4);
+    BOOST_REQUIRE(file != nullptr);
+    BOOST_CHECK_EQUAL(std::string((const char*)file->data(), file->size()), "abcd");
+    BOOST_CHECK(cache.Get(0, path, 2) == file);
+    BOOST_CHECK(cache.Get(0, path, 5) == nullptr);
+
+    // Data appended later is mapped once it is asked for.
+    AppendToFile(path, "ef");
+    std::shared_ptr<const CMappedFile> fileGrown = cache.Get(0, path, 6);
+    BOOST_REQUIRE(fileGrown != nullptr);
+    BOOST_CHECK_EQUAL(std::string((const char*)fileGrown->data(), fileGrown->size()), "abcdef");
+    // The mapping handed out before stays readable.
+    BOOST_CHECK_EQUAL(std::string((const char*)file->data(), file->size()), "abcd");
+
+    // Only the most recently used file is kept.
+    const fs::path pathOther = GetDataDir() / "mapped_other.dat";
+    AppendToFile(pathOther, "xyz");
+    BOOST_CHECK(cache.Get(1, pathOther, 3) != nullptr);
+    BOOST_CHECK(cache.Get(0, path, 0) != fileGrown);
+
+    cache.Erase(0);
+    cache.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(raw_block_read)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = chainActive.Genesis();
+    }
+    BOOST_REQUIRE(pindex != nullptr);
+
+    std::vector<unsigned char> vchBlock;
+    BOOST_REQUIRE(ReadRawBlockFromDisk(vchBlock, pindex, Params().MessageStart()));
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << genesis;
+    BOOST_CHECK(vchBlock == std::vector<unsigned char>(ss.begin(), ss.end()));
+
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+    BOOST_CHECK(block.GetHash() == genesis.GetHash());
+
+    // The bytes before a block must be the index header written with it.
+    CMessageHeader::MessageStartChars wrongStart = {0, 0, 0, 0};
+    BOOST_CHECK(!ReadRawBlockFromDisk(vchBlock, pindex->GetBlockPos(), wrongStart));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
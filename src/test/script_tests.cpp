@@ -1437,6 +1437,110 @@ BOOST_AUTO_TEST_CASE(script_FindAndDelete)
     BOOST_CHECK(s == expect);
 }
 
+static void MutateScript(CScript& script)
+{
+    if (!script.empty() && InsecureRandBool()) {
+        script[InsecureRandRange(script.size())] ^= 1 << InsecureRandBits(3);
+    } else if (!script.empty() && InsecureRandBool()) {
+        script.resize(InsecureRandRange(script.size()));
+    } else {
+        script.push_back(InsecureRandBits(8));
+    }
+}
+
+static void MutateWitness(CScriptWitness& witness)
+{
+    std::vector<std::vector<unsigned char> >& stack = witness.stack;
+    switch (InsecureRandRange(4)) {
+    case 0:
+        if (!stack.empty())
+            stack.pop_back();
+        break;
+    case 1:
+        stack.push_back(std::vector<unsigned char>(InsecureRandRange(3) == 0 ? MAX_SCRIPT_ELEMENT_SIZE + 1 : 1, 1));
+        break;
+    default:
+        if (!stack.empty()) {
+            std::vector<unsigned char>& item = stack[InsecureRandRange(stack.size())];
+            if (!item.empty() && InsecureRandBool()) {
+                item[InsecureRandRange(item.size())] ^= 1 << InsecureRandBits(3);
+            } else {
+                item.clear();
+            }
+        }
+    }
+}
+
+/* The shortcut VerifyScript takes for standard templates must come to the
+ * same result and error as the stack machine, for the templates themselves
+ * and for anything close to them. */
+BOOST_AUTO_TEST_CASE(script_standard_fast_path)
+{
+    SeedInsecureRand(true);
+    const unsigned int standardFlags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_DERSIG |
+        SCRIPT_VERIFY_LOW_S | SCRIPT_VERIFY_NULLDUMMY | SCRIPT_VERIFY_SIGPUSHONLY | SCRIPT_VERIFY_MINIMALDATA |
+        SCRIPT_VERIFY_CLEANSTACK | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_NULLFAIL | SCRIPT_VERIFY_WITNESS_PUBKEYTYPE;
+    const std::vector<unsigned int> vFlags = {SCRIPT_VERIFY_NONE, SCRIPT_VERIFY_P2SH, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS, standardFlags};
+    const CAmount amount = 1000;
+
+    for (bool fCompressed : {true, false}) {
+        CKey key;
+        key.MakeNewKey(fCompressed);
+        const CPubKey pubkey = key.GetPubKey();
+        const CScript scriptPubKeyHash = GetScriptForDestination(pubkey.GetID());
+        const CScript scriptWitness = CScript() << OP_0 << ToByteVector(pubkey.GetID());
+
+        for (int nTemplate = 0; nTemplate < 3; nTemplate++) {
+            CScript scriptPubKey = nTemplate == 0 ? scriptPubKeyHash : nTemplate == 1 ? scriptWitness : GetScriptForDestination(CScriptID(scriptWitness));
+            CMutableTransaction txCredit = BuildCreditingTransaction(scriptPubKey, amount);
+            CMutableTransaction tx = BuildSpendingTransaction(CScript(), CScriptWitness(), txCredit);
+
+            std::vector<unsigned char> vchSig;
+            uint256 hash = SignatureHash(scriptPubKeyHash, tx, 0, SIGHASH_ALL, amount, nTemplate == 0 ? SIGVERSION_BASE : SIGVERSION_WITNESS_V0);
+            BOOST_REQUIRE(key.Sign(hash, vchSig));
+            vchSig.push_back((unsigned char)SIGHASH_ALL);
+
+            CScript scriptSig;
+            CScriptWitness witness;
+            if (nTemplate == 0) {
+                scriptSig << vchSig << ToByteVector(pubkey);
+            } else {
+                witness.stack.push_back(vchSig);
+                witness.stack.push_back(ToByteVector(pubkey));
+                if (nTemplate == 2)
+                    scriptSig << ToByteVector(scriptWitness);
+            }
+            MutableTransactionSignatureChecker checker(&tx, 0, amount);
+
+            for (int i = 0; i < 200; i++) {
+                CScript scriptSigTest = scriptSig;
+                CScript scriptPubKeyTest = scriptPubKey;
+                CScriptWitness witnessTest = witness;
+                unsigned int flags = vFlags[InsecureRandRange(vFlags.size())];
+                if (i >= (int)vFlags.size()) {
+                    switch (InsecureRandRange(3)) {
+                    case 0: MutateScript(scriptSigTest); break;
+                    case 1: MutateScript(scriptPubKeyTest); break;
+                    case 2: MutateWitness(witnessTest); break;
+                    }
+                } else {
+                    flags = vFlags[i];
+                }
+
+                ScriptError err, errGeneric;
+                bool fResult = VerifyScript(scriptSigTest, scriptPubKeyTest, &witnessTest, flags, checker, &err);
+                bool fGeneric = VerifyScriptGeneric(scriptSigTest, scriptPubKeyTest, &witnessTest, flags, checker, &errGeneric);
+                BOOST_CHECK_EQUAL(fResult, fGeneric);
+                BOOST_CHECK_MESSAGE(err == errGeneric, std::string(ScriptErrorString(err)) + " where " + ScriptErrorString(errGeneric) + " expected");
+                if (i < (int)vFlags.size() && (nTemplate == 0 || (flags & SCRIPT_VERIFY_WITNESS))) {
+                    // Unchanged spends are valid, apart from uncompressed keys in witnesses
+                    BOOST_CHECK_EQUAL(fResult, fCompressed || nTemplate == 0 || !(flags & SCRIPT_VERIFY_WITNESS_PUBKEYTYPE));
+                }
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(script_HasValidOps)
 {
     // Exercise the HasValidOps functionality
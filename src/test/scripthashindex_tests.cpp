@@ -0,0 +1,283 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "index/scripthashindex.h"
+#include "rpc/blockchain.h"
+#include "script/interpreter.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <univalue.h>
+
+BOOST_FIXTURE_TEST_SUITE(scripthashindex_tests, TestingSetup)
+
+static bool WaitForBlock(const ScriptHashIndex& index, const CBlockIndex* pindex)
+{
+    int64_t nTimeout = GetTimeMillis() + 10 * 1000;
+    while (index.GetBestBlockIndex() != pindex) {
+        if (GetTimeMillis() > nTimeout)
+            return false;
+        MilliSleep(10);
+    }
+    return true;
+}
+
+static const CBlockIndex* GetTip()
+{
+    LOCK(cs_main);
+    return chainActive.Tip();
+}
+
+static CScript PayToKey(const CKey& key)
+{
+    return CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+}
+
+/** A transaction spending prevout, which pays to the public key of key, to vout. */
+static CMutableTransaction CreateSpend(const COutPoint& prevout, const CKey& key, const std::vector<CTxOut>& vout)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = prevout;
+    tx.vout = vout;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(PayToKey(key), tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+static std::string SerializePosition(const ScriptHashPosition& pos)
+{
+    CDataStream ss(SER_DISK, 0);
+    ss << pos;
+    return ss.str();
+}
+
+BOOST_AUTO_TEST_CASE(scripthash)
+{
+    // The script hash of the genesis block address, as displayed by Electrum servers.
+    std::vector<unsigned char> script = ParseHex("76a91462e907b15cbf27d5425399ebf6f0fb50ebb88f1888ac");
+    BOOST_CHECK_EQUAL(GetScriptHash(CScript(script.begin(), script.end())).GetHex(),
+                      "8b01df4e368ea28f8dc0423bcf7a4923e3a12d307c875e47a0cfbf90b5c39161");
+}
+
+BOOST_AUTO_TEST_CASE(position_order)
+{
+    // The serialized positions sort in the order entries are returned in.
+    uint256 txid1 = uint256S("0100"), txid2 = uint256S("02");
+    std::vector<ScriptHashPosition> positions = {
+        ScriptHashPosition(0, uint256(), false, 0),
+        ScriptHashPosition(1, txid2, true, 300),
+        ScriptHashPosition(255, txid2, false, 0),
+        ScriptHashPosition(256, txid1, false, 1),
+        ScriptHashPosition(256, txid1, false, 256),
+        ScriptHashPosition(256, txid1, true, 0),
+        ScriptHashPosition(256, txid2, false, 0),
+        ScriptHashPosition(70000, txid1, false, 0),
+    };
+    for (size_t i = 1; i < positions.size(); i++) {
+        BOOST_CHECK(SerializePosition(positions[i - 1]) < SerializePosition(positions[i]));
+    }
+
+    CDataStream ss(SER_DISK, 0);
+    ss << positions[4];
+    ScriptHashPosition read;
+    ss >> read;
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK_EQUAL(read.nHeight, 256);
+    BOOST_CHECK(read.txid == txid1);
+    BOOST_CHECK(!read.fSpend);
+    BOOST_CHECK_EQUAL(read.n, 256U);
+}
+
+BOOST_AUTO_TEST_CASE(scripthashindex_sync)
+{
+    ScriptHashIndex index(1 << 20, true);
+    index.Start();
+    int64_t nTimeout = GetTimeMillis() + 10 * 1000;
+    while (!index.IsSynced() && GetTimeMillis() < nTimeout) {
+        MilliSleep(10);
+    }
+    BOOST_REQUIRE(index.IsSynced());
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(index.GetBestBlockIndex() == chainActive.Tip());
+    }
+
+    // The genesis output is not spendable and not indexed.
+    const CTxOut& out = Params().GenesisBlock().vtx[0]->vout[0];
+    std::vector<ScriptHashEntry> entries;
+    BOOST_CHECK(index.FindEntries(GetScriptHash(out.scriptPubKey), ScriptHashPosition(), 10, entries));
+    BOOST_CHECK(entries.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(scripthashindex_history, TestChain100Setup)
+{
+    ScriptHashIndex index(1 << 20, true);
+    index.Start();
+    BOOST_REQUIRE(WaitForBlock(index, GetTip()));
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript script = PayToKey(key);
+    const uint256 scripthash = GetScriptHash(script);
+    const CScript scriptCoinbase = PayToKey(coinbaseKey);
+
+    // Pay to the script at height 101 and spend from it at height 102.
+    CMutableTransaction txPay = CreateSpend(COutPoint(coinbaseTxns[0].GetHash(), 0), coinbaseKey, {CTxOut(11 * CENT, script)});
+    CreateAndProcessBlock({txPay}, scriptCoinbase);
+    CMutableTransaction txSpend = CreateSpend(COutPoint(txPay.GetHash(), 0), key, {CTxOut(10 * CENT, scriptCoinbase)});
+    CreateAndProcessBlock({txSpend}, scriptCoinbase);
+    const CBlockIndex* pindexSpend = GetTip();
+    BOOST_REQUIRE_EQUAL(pindexSpend->nHeight, 102);
+    BOOST_REQUIRE(WaitForBlock(index, pindexSpend));
+
+    std::vector<ScriptHashEntry> entries;
+    BOOST_CHECK(index.FindEntries(scripthash, ScriptHashPosition(), 10, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK_EQUAL(entries[0].pos.nHeight, 101);
+    BOOST_CHECK(entries[0].pos.txid == txPay.GetHash());
+    BOOST_CHECK(!entries[0].pos.fSpend);
+    BOOST_CHECK_EQUAL(entries[0].pos.n, 0U);
+    BOOST_CHECK_EQUAL(entries[0].nValue, 11 * CENT);
+    BOOST_CHECK(entries[0].prevout.IsNull());
+    BOOST_CHECK_EQUAL(entries[1].pos.nHeight, 102);
+    BOOST_CHECK(entries[1].pos.txid == txSpend.GetHash());
+    BOOST_CHECK(entries[1].pos.fSpend);
+    BOOST_CHECK_EQUAL(entries[1].pos.n, 0U);
+    BOOST_CHECK_EQUAL(entries[1].nValue, 11 * CENT);
+    BOOST_CHECK(entries[1].prevout == COutPoint(txPay.GetHash(), 0));
+
+    // Replace the block with the spend. The index rewinds it when the block
+    // taking its place is connected.
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    // The spend went back to the mempool, whose fees the coinbase would claim.
+    mempool.clear();
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+    CreateAndProcessBlock({}, PayToKey(keyOther));
+    BOOST_REQUIRE(GetTip() != pindexSpend);
+    BOOST_REQUIRE(WaitForBlock(index, GetTip()));
+
+    entries.clear();
+    BOOST_CHECK(index.FindEntries(scripthash, ScriptHashPosition(), 10, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].pos.txid == txPay.GetHash());
+    BOOST_CHECK(!entries[0].pos.fSpend);
+}
+
+BOOST_FIXTURE_TEST_CASE(scripthashindex_restart_after_reorg, TestChain100Setup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript script = PayToKey(key);
+    const uint256 scripthash = GetScriptHash(script);
+    CMutableTransaction txPay = CreateSpend(COutPoint(coinbaseTxns[0].GetHash(), 0), coinbaseKey, {CTxOut(11 * CENT, script)});
+
+    {
+        ScriptHashIndex index(1 << 20, false, true);
+        index.Start();
+        CreateAndProcessBlock({txPay}, PayToKey(coinbaseKey));
+        BOOST_REQUIRE(WaitForBlock(index, GetTip()));
+    }
+
+    // While the index is stopped the block paying to the script is replaced.
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    mempool.clear();
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+    CreateAndProcessBlock({}, PayToKey(keyOther));
+
+    // On restart the index rewinds the block it had indexed.
+    ScriptHashIndex index(1 << 20, false, false);
+    index.Start();
+    BOOST_REQUIRE(WaitForBlock(index, GetTip()));
+    std::vector<ScriptHashEntry> entries;
+    BOOST_CHECK(index.FindEntries(scripthash, ScriptHashPosition(), 10, entries));
+    BOOST_CHECK(entries.empty());
+    entries.clear();
+    BOOST_CHECK(index.FindEntries(GetScriptHash(PayToKey(keyOther)), ScriptHashPosition(), 10, entries));
+    BOOST_CHECK_EQUAL(entries.size(), 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(scripthashindex_paging, TestChain100Setup)
+{
+    g_scripthashindex.reset(new ScriptHashIndex(1 << 20, true));
+    g_scripthashindex->Start();
+    BOOST_REQUIRE(WaitForBlock(*g_scripthashindex, GetTip()));
+
+    // Nine outputs paying to the script, in two blocks.
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript script = PayToKey(key);
+    const uint256 scripthash = GetScriptHash(script);
+    for (int i = 0; i < 2; i++) {
+        std::vector<CTxOut> vout(5 - i, CTxOut(CENT, script));
+        CMutableTransaction tx = CreateSpend(COutPoint(coinbaseTxns[i].GetHash(), 0), coinbaseKey, vout);
+        CreateAndProcessBlock({tx}, PayToKey(coinbaseKey));
+    }
+    BOOST_REQUIRE(WaitForBlock(*g_scripthashindex, GetTip()));
+
+    std::vector<ScriptHashEntry> entries;
+    BOOST_CHECK(g_scripthashindex->FindEntries(scripthash, ScriptHashPosition(), 100, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 9U);
+
+    BOOST_CHECK_THROW(scripthashHistoryToJSON(scripthash, 0, ""), UniValue);
+    BOOST_CHECK_THROW(scripthashHistoryToJSON(scripthash, 1001, ""), UniValue);
+    BOOST_CHECK_THROW(scripthashHistoryToJSON(scripthash, 2, "00"), UniValue);
+
+    // Pages of two return every entry once, in index order, and the last
+    // one has no cursor.
+    size_t nEntry = 0;
+    int nPages = 0;
+    std::string strCursor;
+    do {
+        UniValue page = scripthashHistoryToJSON(scripthash, 2, strCursor);
+        const UniValue& history = find_value(page, "history");
+        BOOST_REQUIRE(history.size() <= 2);
+        for (size_t i = 0; i < history.size(); i++, nEntry++) {
+            BOOST_REQUIRE(nEntry < entries.size());
+            BOOST_CHECK_EQUAL(find_value(history[i], "txid").get_str(), entries[nEntry].pos.txid.GetHex());
+            BOOST_CHECK_EQUAL(find_value(history[i], "height").get_int(), entries[nEntry].pos.nHeight);
+            BOOST_CHECK_EQUAL(find_value(history[i], "type").get_str(), "output");
+            BOOST_CHECK_EQUAL(find_value(history[i], "vout").get_int(), (int)entries[nEntry].pos.n);
+            BOOST_CHECK_EQUAL(find_value(history[i], "value").getValStr(), "0.01000000");
+        }
+        const UniValue& next = find_value(page, "next");
+        strCursor = next.isNull() ? "" : next.get_str();
+        nPages++;
+    } while (!strCursor.empty() && nPages < 10);
+    BOOST_CHECK_EQUAL(nEntry, entries.size());
+    BOOST_CHECK_EQUAL(nPages, 5);
+
+    for (size_t i = 1; i < entries.size(); i++) {
+        BOOST_CHECK(SerializePosition(entries[i - 1].pos) < SerializePosition(entries[i].pos));
+    }
+    BOOST_CHECK_EQUAL(entries.front().pos.nHeight, 101);
+    BOOST_CHECK_EQUAL(entries.back().pos.nHeight, 102);
+
+    g_scripthashindex.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
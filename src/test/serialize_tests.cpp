@@ -5,6 +5,8 @@
 #include "serialize.h"
 #include "streams.h"
 #include "hash.h"
+#include "primitives/block.h"
+#include "validation.h"
 #include "test/test_bitcoin.h"
 
 #include <stdint.h>
@@ -365,4 +367,41 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(deserialize_block)
+{
+    CBlock block;
+    for (int i = 0; i < 500; i++) {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout.hash = InsecureRand256();
+        if (i % 2)
+            mtx.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(i % 50, i));
+        mtx.vout.resize(1);
+        mtx.nLockTime = i;
+        block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block << uint8_t(42);
+
+    // Read the same as the serializer, whether or not it uses other threads
+    const int nScriptCheckThreadsOld = nScriptCheckThreads;
+    for (int nThreads : {0, 4}) {
+        nScriptCheckThreads = nThreads;
+        CDataStream ssCopy(ss);
+        CBlock blockRead;
+        DeserializeBlock(ssCopy, blockRead);
+        BOOST_CHECK(blockRead.GetHash() == block.GetHash());
+        BOOST_REQUIRE_EQUAL(blockRead.vtx.size(), block.vtx.size());
+        for (size_t i = 0; i < block.vtx.size(); i++) {
+            BOOST_CHECK(blockRead.vtx[i]->GetHash() == block.vtx[i]->GetHash());
+            BOOST_CHECK(blockRead.vtx[i]->GetWitnessHash() == block.vtx[i]->GetWitnessHash());
+        }
+        BOOST_CHECK_EQUAL(ssCopy.size(), 1U);
+
+        CDataStream ssTruncated(ss.begin(), ss.end() - 100, SER_NETWORK, PROTOCOL_VERSION);
+        BOOST_CHECK_THROW(DeserializeBlock(ssTruncated, blockRead), std::ios_base::failure);
+    }
+    nScriptCheckThreads = nScriptCheckThreadsOld;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
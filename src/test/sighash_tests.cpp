@@ -157,6 +157,9 @@ BOOST_AUTO_TEST_CASE(sighash_test)
         std::cout << "\n";
         #endif
         BOOST_CHECK(sh == sho);
+        const CTransaction tx(txTo);
+        PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, 0, SIGVERSION_BASE, &txdata) == sho);
     }
     #if defined(PRINT_SIGHASH_JSON)
     std::cout << "]\n";
@@ -208,6 +211,40 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
 
         sh = SignatureHash(scriptCode, *tx, nIn, nHashType, 0, SIGVERSION_BASE);
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
+        PrecomputedTransactionData txdata(*tx);
+        sh = SignatureHash(scriptCode, *tx, nIn, nHashType, 0, SIGVERSION_BASE, &txdata);
+        BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
+
+// Precomputed legacy hashes of a transaction with many inputs match the old implementation
+BOOST_AUTO_TEST_CASE(sighash_legacy_precomputed)
+{
+    SeedInsecureRand(false);
+
+    CMutableTransaction txTo;
+    RandomTransaction(txTo, false);
+    txTo.vin.resize(100);
+    for (CTxIn& txin : txTo.vin) {
+        txin.prevout.hash = InsecureRand256();
+        txin.prevout.n = InsecureRand32();
+        txin.scriptSig = CScript() << OP_1;
+        txin.nSequence = InsecureRand32();
+    }
+    const CTransaction tx(txTo);
+    PrecomputedTransactionData txdata(tx);
+    BOOST_CHECK_EQUAL(txdata.vLegacyMidstates.size(), tx.vin.size());
+
+    const CScript scriptCode = CScript() << OP_1 << OP_CODESEPARATOR << OP_CHECKSIG;
+    for (int nHashType : {0, (int)SIGHASH_ALL, SIGHASH_ALL | SIGHASH_ANYONECANPAY, (int)SIGHASH_NONE, 0x41}) {
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+            uint256 sho = SignatureHashOld(scriptCode, tx, nIn, nHashType);
+            BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, 0, SIGVERSION_BASE, &txdata) == sho);
+        }
+    }
+
+    // A single signed input is not worth precomputing
+    txTo.vin.resize(1);
+    BOOST_CHECK(PrecomputedTransactionData(txTo).vLegacyMidstates.empty());
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -177,4 +177,33 @@ BOOST_AUTO_TEST_CASE(findearliestatleast_edge_test)
     BOOST_CHECK(!chain.FindEarliestAtLeast(int64_t(std::numeric_limits<unsigned int>::max()) + 1));
 }
 
+BOOST_AUTO_TEST_CASE(blockindex_arena_test)
+{
+    // Enough entries for several chunks, linked as a chain.
+    CBlockIndexArena arena;
+    std::vector<CBlockIndex*> vpindex;
+    for (int i = 0; i < 10000; i++) {
+        CBlockIndex index;
+        index.nHeight = i;
+        index.pprev = vpindex.empty() ? nullptr : vpindex.back();
+        vpindex.push_back(arena.Insert(index));
+        vpindex.back()->BuildSkip();
+    }
+
+    // Entries stay where they were put as more are added.
+    for (int i = 0; i < 10000; i++) {
+        BOOST_CHECK_EQUAL(vpindex[i]->nHeight, i);
+        BOOST_CHECK(vpindex[i]->pprev == (i ? vpindex[i - 1] : nullptr));
+    }
+    BOOST_CHECK(vpindex.back()->GetAncestor(1234) == vpindex[1234]);
+
+    CBlockIndexArena::Stats stats = arena.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 10000U);
+    BOOST_CHECK(stats.nAllocated >= 10000 * sizeof(CBlockIndex));
+    BOOST_CHECK(stats.nSeparate >= 10000 * sizeof(CBlockIndex));
+
+    arena.Clear();
+    BOOST_CHECK_EQUAL(arena.GetStats().nEntries, 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,9 +6,12 @@
 
 #include "net.h"
 
+#include <atomic>
+
 #include <boost/test/unit_test.hpp>
 
 std::unique_ptr<CConnman> g_connman;
+static std::atomic<bool> fRequestShutdown(false);
 
 void Shutdown(void* parg)
 {
@@ -17,10 +20,15 @@ void Shutdown(void* parg)
 
 void StartShutdown()
 {
-  exit(EXIT_SUCCESS);
+  fRequestShutdown = true;
+}
+
+void AbortShutdown()
+{
+  fRequestShutdown = false;
 }
 
 bool ShutdownRequested()
 {
-  return false;
+  return fRequestShutdown;
 }
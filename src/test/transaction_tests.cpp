@@ -494,6 +494,73 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction) {
     threadGroup.join_all();
 }
 
+static std::vector<unsigned char> SignInput(const CKey& key, const CScript& scriptCode, const CMutableTransaction& mtx, unsigned int nIn)
+{
+    const uint256 hash = SignatureHash(scriptCode, mtx, nIn, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    return vchSig;
+}
+
+// Run the checks of all inputs as one batch, and compare with running them one by one.
+static bool CheckInputsBatched(const CMutableTransaction& mtx, const std::vector<CScript>& scriptPubKeys)
+{
+    const CTransaction tx(mtx);
+    PrecomputedTransactionData txdata(tx);
+    std::vector<CScriptCheck> vChecks;
+    bool fAllPass = true;
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        vChecks.emplace_back(scriptPubKeys[i], 0, tx, i, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG, false, &txdata);
+        fAllPass &= CScriptCheck(scriptPubKeys[i], 0, tx, i, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG, false, &txdata)();
+    }
+    const bool fBatchPass = CheckBatch(vChecks);
+    BOOST_CHECK_EQUAL(fBatchPass, fAllPass);
+    return fBatchPass;
+}
+
+BOOST_AUTO_TEST_CASE(script_check_batch)
+{
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    std::vector<CScript> scriptPubKeys;
+    scriptPubKeys.push_back(CScript() << ToByteVector(key1.GetPubKey()) << OP_CHECKSIG);
+    // Signed for the second key, so the signature is first tried (and fails) with the first one
+    scriptPubKeys.push_back(CScript() << OP_1 << ToByteVector(key1.GetPubKey()) << ToByteVector(key2.GetPubKey()) << OP_2 << OP_CHECKMULTISIG);
+    // Only passes with an invalid signature
+    scriptPubKeys.push_back(CScript() << ToByteVector(key1.GetPubKey()) << OP_CHECKSIG << OP_NOT);
+
+    CMutableTransaction mtx;
+    mtx.nVersion = 1;
+    mtx.vin.resize(scriptPubKeys.size());
+    for (unsigned int i = 0; i < mtx.vin.size(); i++) {
+        mtx.vin[i].prevout = COutPoint(uint256S("0x01"), i);
+    }
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 0;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    mtx.vin[0].scriptSig = CScript() << SignInput(key1, scriptPubKeys[0], mtx, 0);
+    mtx.vin[1].scriptSig = CScript() << OP_0 << SignInput(key2, scriptPubKeys[1], mtx, 1);
+    mtx.vin[2].scriptSig = CScript() << SignInput(key2, scriptPubKeys[2], mtx, 2);
+    BOOST_CHECK(CheckInputsBatched(mtx, scriptPubKeys));
+
+    // Signing for the first key in the multisig works too.
+    CMutableTransaction mtxFirstKey(mtx);
+    mtxFirstKey.vin[1].scriptSig = CScript() << OP_0 << SignInput(key1, scriptPubKeys[1], mtx, 1);
+    BOOST_CHECK(CheckInputsBatched(mtxFirstKey, scriptPubKeys));
+
+    // An invalid signature is caught...
+    CMutableTransaction mtxBadSig(mtx);
+    mtxBadSig.vin[0].scriptSig = CScript() << SignInput(key2, scriptPubKeys[0], mtx, 0);
+    BOOST_CHECK(!CheckInputsBatched(mtxBadSig, scriptPubKeys));
+
+    // ...and so is a valid one where the script wants an invalid one.
+    CMutableTransaction mtxGoodSig(mtx);
+    mtxGoodSig.vin[2].scriptSig = CScript() << SignInput(key1, scriptPubKeys[2], mtx, 2);
+    BOOST_CHECK(!CheckInputsBatched(mtxGoodSig, scriptPubKeys));
+}
+
 BOOST_AUTO_TEST_CASE(test_witness)
 {
     CBasicKeyStore keystore, keystore2;
@@ -0,0 +1,132 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "index/txindex.h"
+#include "script/interpreter.h"
+#include "txdb.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txindex_tests, TestChain100Setup)
+
+static bool WaitForSync(const TxIndex& txindex)
+{
+    int64_t nTimeout = GetTimeMillis() + 10 * 1000;
+    while (!txindex.IsSynced()) {
+        if (GetTimeMillis() > nTimeout)
+            return false;
+        MilliSleep(10);
+    }
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(txindex_initial_sync)
+{
+    const CBlock& genesis = Params().GenesisBlock();
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    BOOST_REQUIRE(pindexTip != nullptr);
+
+    {
+        TxIndex txindex(1 << 20, false, true);
+        BOOST_CHECK(!txindex.IsSynced());
+        BOOST_CHECK(txindex.GetBestBlockIndex() == nullptr);
+
+        txindex.Start();
+        BOOST_REQUIRE(WaitForSync(txindex));
+        BOOST_CHECK(txindex.GetBestBlockIndex() == pindexTip);
+
+        // The genesis coinbase is not spendable and therefore not indexed.
+        uint256 hashBlock;
+        CTransactionRef tx;
+        BOOST_CHECK(!txindex.FindTx(genesis.vtx[0]->GetHash(), hashBlock, tx));
+    }
+
+    // A restarted index resumes from its stored locator.
+    TxIndex txindex(1 << 20, false, false);
+    txindex.Start();
+    BOOST_CHECK(txindex.GetBestBlockIndex() == pindexTip);
+    BOOST_REQUIRE(WaitForSync(txindex));
+    txindex.Stop();
+    BOOST_CHECK(txindex.GetBestBlockIndex() == pindexTip);
+}
+
+BOOST_AUTO_TEST_CASE(txindex_find_tx)
+{
+    TxIndex txindex(1 << 20, true);
+    txindex.Start();
+    BOOST_REQUIRE(WaitForSync(txindex));
+
+    uint256 hashBlock;
+    CTransactionRef tx;
+    for (size_t i = 0; i < coinbaseTxns.size(); i++) {
+        BOOST_CHECK(txindex.FindTx(coinbaseTxns[i].GetHash(), hashBlock, tx));
+        BOOST_CHECK(tx->GetHash() == coinbaseTxns[i].GetHash());
+        LOCK(cs_main);
+        BOOST_CHECK(hashBlock == chainActive[i + 1]->GetBlockHash());
+    }
+
+    // A transaction after the coinbase, connected once the index has caught
+    // up, is found at its offset within the block.
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11 * CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    CBlock block = CreateAndProcessBlock({spend}, scriptPubKey);
+
+    int64_t nTimeout = GetTimeMillis() + 10 * 1000;
+    while (txindex.GetBestBlockIndex()->GetBlockHash() != block.GetHash() && GetTimeMillis() < nTimeout) {
+        MilliSleep(10);
+    }
+    BOOST_CHECK(txindex.FindTx(spend.GetHash(), hashBlock, tx));
+    BOOST_CHECK(tx->GetHash() == spend.GetHash());
+    BOOST_CHECK(hashBlock == block.GetHash());
+    BOOST_CHECK(txindex.FindTx(block.vtx[0]->GetHash(), hashBlock, tx));
+    BOOST_CHECK(hashBlock == block.GetHash());
+
+    BOOST_CHECK(!txindex.FindTx(uint256S("01"), hashBlock, tx));
+}
+
+BOOST_AUTO_TEST_CASE(txindex_erase_legacy)
+{
+    // Entries as older versions left them in the block index database.
+    const uint256 txid = coinbaseTxns[0].GetHash();
+    BOOST_REQUIRE(pblocktree->WriteFlag("txindex", true));
+    BOOST_REQUIRE(pblocktree->Write(std::make_pair('t', txid), CDiskTxPos()));
+    BOOST_REQUIRE(pblocktree->Write(std::make_pair('t', uint256S("01")), CDiskTxPos()));
+    // Keys on either side of them are kept.
+    BOOST_REQUIRE(pblocktree->WriteFlag("prunedblockfiles", false));
+    BOOST_REQUIRE(pblocktree->Write(std::make_pair('u', uint256()), 0));
+
+    TxIndex txindex(1 << 20, true);
+    txindex.Start();
+    BOOST_REQUIRE(WaitForSync(txindex));
+    // They are erased on the sync thread once the index has caught up.
+    txindex.Stop();
+
+    bool fLegacyTxIndex;
+    BOOST_CHECK(!pblocktree->ReadFlag("txindex", fLegacyTxIndex));
+    BOOST_CHECK(!pblocktree->Exists(std::make_pair('t', txid)));
+    BOOST_CHECK(!pblocktree->Exists(std::make_pair('t', uint256S("01"))));
+    BOOST_CHECK(pblocktree->ReadFlag("prunedblockfiles", fLegacyTxIndex));
+    BOOST_CHECK(pblocktree->Exists(std::make_pair('u', uint256())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
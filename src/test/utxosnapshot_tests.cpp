@@ -0,0 +1,143 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "coins.h"
+#include "coinstats.h"
+#include "streams.h"
+#include "txdb.h"
+#include "utxosnapshot.h"
+#include "test/test_bitcoin.h"
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxosnapshot_tests, TestingSetup)
+
+static std::map<COutPoint, Coin> FillCoinsDB(CCoinsViewDB& db)
+{
+    std::map<COutPoint, Coin> coins;
+    CCoinsViewCache cache(&db);
+    for (int i = 0; i < 50; i++) {
+        uint256 txid = InsecureRand256();
+        int nOutputs = 1 + InsecureRandRange(4);
+        for (int n = 0; n < nOutputs; n++) {
+            CTxOut out;
+            out.nValue = InsecureRandRange(1000000) + 1;
+            out.scriptPubKey = CScript() << ToByteVector(InsecureRand256()) << OP_CHECKSIG;
+            Coin coin(out, 1 + InsecureRandRange(1000), InsecureRandBool());
+            COutPoint outpoint(txid, n * 2);
+            coins[outpoint] = coin;
+            cache.AddCoin(outpoint, std::move(coin), false);
+        }
+    }
+    cache.SetBestBlock(Params().GenesisBlock().GetHash());
+    BOOST_CHECK(cache.Flush());
+    return coins;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_roundtrip)
+{
+    CCoinsViewDB db(1 << 20, true, true);
+    std::map<COutPoint, Coin> coins = FillCoinsDB(db);
+    fs::path path = GetDataDir() / "utxo.dat";
+
+    SnapshotMetadata metadata(Params().MessageStart(), Params().GenesisBlock().GetHash(), 1);
+    {
+        std::unique_ptr<CCoinsViewCursor> pcursor(db.Cursor());
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(WriteUTXOSnapshot(file, pcursor.get(), metadata));
+    }
+    BOOST_CHECK_EQUAL(metadata.nCoins, coins.size());
+
+    // The header hash matches what gettxoutsetinfo reports for the same set.
+    CCoinsStats stats;
+    BOOST_CHECK(GetUTXOStats(&db, stats));
+    BOOST_CHECK(metadata.hashSerialized == stats.hashSerialized);
+
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        SnapshotMetadata read;
+        file >> read;
+        BOOST_CHECK(read.hashBaseBlock == metadata.hashBaseBlock);
+        BOOST_CHECK_EQUAL(read.nChainTx, 1U);
+        BOOST_CHECK_EQUAL(read.nCoins, metadata.nCoins);
+        long nBodyPos = ftell(file.Get());
+
+        std::string strError;
+        BOOST_CHECK(VerifyUTXOSnapshot(file, read, strError));
+
+        // Every coin comes back in database order.
+        BOOST_CHECK_EQUAL(fseek(file.Get(), nBodyPos, SEEK_SET), 0);
+        std::map<COutPoint, Coin>::const_iterator it = coins.begin();
+        uint256 txid;
+        std::map<uint32_t, Coin> outputs;
+        for (uint64_t nRead = 0; nRead < read.nCoins; nRead += outputs.size()) {
+            ReadUTXOSnapshotTx(file, txid, outputs);
+            for (const auto& output : outputs) {
+                BOOST_CHECK(it->first == COutPoint(txid, output.first));
+                BOOST_CHECK(it->second.out == output.second.out);
+                BOOST_CHECK_EQUAL(it->second.nHeight, output.second.nHeight);
+                ++it;
+            }
+        }
+        BOOST_CHECK(it == coins.end());
+    }
+
+    // A header that does not match the body is rejected.
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        SnapshotMetadata read;
+        file >> read;
+        read.hashSerialized = InsecureRand256();
+        std::string strError;
+        BOOST_CHECK(!VerifyUTXOSnapshot(file, read, strError));
+    }
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        SnapshotMetadata read;
+        file >> read;
+        read.nCoins++;
+        std::string strError;
+        BOOST_CHECK(!VerifyUTXOSnapshot(file, read, strError));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_bulk_load)
+{
+    CCoinsViewDB source(1 << 20, true, true);
+    std::map<COutPoint, Coin> coins = FillCoinsDB(source);
+
+    CCoinsViewDB target(1 << 20, true, true);
+    const uint256 hashBlock = Params().GenesisBlock().GetHash();
+    std::vector<std::pair<COutPoint, Coin>> batch(coins.begin(), coins.end());
+    BOOST_CHECK(target.WriteCoinsBatch(batch, hashBlock));
+    // Mid-load, the database is marked as being in transition.
+    BOOST_CHECK(target.GetBestBlock().IsNull());
+    BOOST_CHECK_EQUAL(target.GetHeadBlocks().size(), 2U);
+    BOOST_CHECK(target.WriteBestBlock(hashBlock));
+    BOOST_CHECK(target.GetBestBlock() == hashBlock);
+    BOOST_CHECK(target.GetHeadBlocks().empty());
+
+    CCoinsStats source_stats, target_stats;
+    BOOST_CHECK(GetUTXOStats(&source, source_stats));
+    BOOST_CHECK(GetUTXOStats(&target, target_stats));
+    BOOST_CHECK(source_stats.hashSerialized == target_stats.hashSerialized);
+
+    BOOST_CHECK_EQUAL(target.EraseAllCoins(hashBlock), (int64_t)coins.size());
+    BOOST_CHECK(target.WriteBestBlock(hashBlock));
+    std::unique_ptr<CCoinsViewCursor> pcursor(target.Cursor());
+    BOOST_CHECK(!pcursor->Valid());
+
+    // An abandoned load leaves an empty database that is not in transition.
+    BOOST_CHECK(target.WriteCoinsBatch(batch, hashBlock));
+    BOOST_CHECK_EQUAL(target.EraseAllCoins(hashBlock), (int64_t)coins.size());
+    BOOST_CHECK_EQUAL(target.GetHeadBlocks().size(), 2U);
+    BOOST_CHECK(target.EraseHeadBlocks());
+    BOOST_CHECK(target.GetHeadBlocks().empty());
+    BOOST_CHECK(target.GetBestBlock().IsNull());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validationstats.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationstats_tests, BasicTestingSetup)
+
+static BlockConnectTimes MakeTimes(int nHeight)
+{
+    BlockConnectTimes times = {};
+    times.nHeight = nHeight;
+    times.nTimeTotal = 1000 * nHeight;
+    return times;
+}
+
+BOOST_AUTO_TEST_CASE(connect_times_ring)
+{
+    CConnectTimesLog log(3);
+    BOOST_CHECK(log.GetRecent().empty());
+
+    log.Add(MakeTimes(1));
+    log.Add(MakeTimes(2));
+    std::vector<BlockConnectTimes> vTimes = log.GetRecent();
+    BOOST_REQUIRE_EQUAL(vTimes.size(), 2U);
+    BOOST_CHECK_EQUAL(vTimes[0].nHeight, 1);
+    BOOST_CHECK_EQUAL(vTimes[1].nHeight, 2);
+
+    // Once full, the oldest entries are overwritten and the rest keep their order.
+    for (int nHeight = 3; nHeight <= 7; nHeight++) {
+        log.Add(MakeTimes(nHeight));
+    }
+    vTimes = log.GetRecent();
+    BOOST_REQUIRE_EQUAL(vTimes.size(), 3U);
+    BOOST_CHECK_EQUAL(vTimes[0].nHeight, 5);
+    BOOST_CHECK_EQUAL(vTimes[1].nHeight, 6);
+    BOOST_CHECK_EQUAL(vTimes[2].nHeight, 7);
+    BOOST_CHECK_EQUAL(vTimes[2].nTimeTotal, 7000);
+
+    log.Clear();
+    BOOST_CHECK(log.GetRecent().empty());
+    log.Add(MakeTimes(8));
+    BOOST_CHECK_EQUAL(log.GetRecent()[0].nHeight, 8);
+
+    // A log of size 0 keeps nothing.
+    CConnectTimesLog empty(0);
+    empty.Add(MakeTimes(1));
+    BOOST_CHECK(empty.GetRecent().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
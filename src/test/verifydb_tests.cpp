@@ -0,0 +1,63 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "fs.h"
+#include "init.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <stdio.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(verifydb_tests, TestChain100Setup)
+
+/** Wait for the background check to finish, and return how it ended. */
+static std::string WaitForBackgroundVerify()
+{
+    int64_t nTimeout = GetTimeMillis() + 10 * 1000;
+    while (GetBackgroundVerifyDBProgress().fRunning && GetTimeMillis() < nTimeout) {
+        MilliSleep(10);
+    }
+    StopBackgroundVerifyDB();
+    return GetBackgroundVerifyDBProgress().strStatus;
+}
+
+BOOST_AUTO_TEST_CASE(verify_block_data)
+{
+    // Levels 0 to 2 read and check the blocks on several threads.
+    BOOST_REQUIRE(nScriptCheckThreads > 1);
+    BOOST_CHECK(CVerifyDB().VerifyDB(Params(), pcoinsTip, 2, 100));
+
+    // Damage the undo data of a block in the middle of the chain.
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = chainActive[50]->GetUndoPos();
+    }
+    BOOST_REQUIRE(!pos.IsNull());
+    FILE* file = fsbridge::fopen(GetBlockPosFilename(pos, "rev"), "rb+");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK_EQUAL(fseek(file, pos.nPos, SEEK_SET), 0);
+    BOOST_CHECK_EQUAL(fputc(0xff, file), 0xff);
+    fclose(file);
+    BOOST_CHECK(!CVerifyDB().VerifyDB(Params(), pcoinsTip, 2, 100));
+}
+
+BOOST_AUTO_TEST_CASE(verify_coins_db_interrupted)
+{
+    StartBackgroundVerifyDB(Params(), 4, 10);
+    BOOST_CHECK_EQUAL(WaitForBackgroundVerify(), "ok");
+
+    // The coins check gives up when shutdown is requested.
+    StartShutdown();
+    StartBackgroundVerifyDB(Params(), 4, 10);
+    std::string strStatus = WaitForBackgroundVerify();
+    AbortShutdown();
+    BOOST_CHECK_EQUAL(strStatus, "interrupted");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 #include "txdb.h"
 
 #include "chainparams.h"
+#include "coinstats.h"
 #include "hash.h"
 #include "random.h"
 #include "pow.h"
@@ -21,8 +22,11 @@
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
+//! Transaction index entries of versions that kept -txindex in this database
+static const char DB_LEGACY_TXINDEX = 't';
+
+static const char DB_COINS_STATS = 'S';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -54,7 +58,7 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", GetDBProfile("chainstate", nCacheSize), fMemory, fWipe, true) 
 {
 }
 
@@ -147,7 +151,60 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+bool CCoinsViewDB::WriteCoinsBatch(const std::vector<std::pair<COutPoint, Coin>>& coins, const uint256& hashBlock)
+{
+    CDBBatch batch(db);
+    batch.Erase(DB_BEST_BLOCK);
+    batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, uint256()});
+    for (const auto& coin : coins) {
+        batch.Write(CoinEntry(&coin.first), coin.second);
+    }
+    LogPrint(BCLog::COINDB, "Writing bulk batch of %u coins (%.2f MiB)\n", (unsigned int)coins.size(), batch.SizeEstimate() * (1.0 / 1048576.0));
+    return db.WriteBatch(batch);
+}
+
+bool CCoinsViewDB::WriteBestBlock(const uint256& hashBlock)
+{
+    assert(!hashBlock.IsNull());
+    CDBBatch batch(db);
+    batch.Erase(DB_HEAD_BLOCKS);
+    batch.Write(DB_BEST_BLOCK, hashBlock);
+    return db.WriteBatch(batch, true);
+}
+
+bool CCoinsViewDB::EraseHeadBlocks()
+{
+    CDBBatch batch(db);
+    batch.Erase(DB_HEAD_BLOCKS);
+    return db.WriteBatch(batch, true);
+}
+
+int64_t CCoinsViewDB::EraseAllCoins(const uint256& hashBlock)
+{
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    CDBBatch batch(db);
+    batch.Erase(DB_BEST_BLOCK);
+    batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, uint256()});
+    int64_t count = 0;
+    COutPoint outpoint;
+    CoinEntry entry(&outpoint);
+    for (pcursor->Seek(DB_COIN); pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(entry) || entry.key != DB_COIN) {
+            break;
+        }
+        batch.Erase(entry);
+        count++;
+        if (batch.SizeEstimate() > batch_size) {
+            if (!db.WriteBatch(batch)) return -1;
+            batch.Clear();
+        }
+    }
+    if (!db.WriteBatch(batch)) return -1;
+    return count;
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", GetDBProfile("index", nCacheSize), fMemory, fWipe) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -171,12 +228,18 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 }
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
+{
+    return Cursor(uint256());
+}
+
+CCoinsViewCursor *CCoinsViewDB::Cursor(const uint256 &txidStart) const
 {
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COIN);
+    COutPoint start(txidStart, 0);
+    i->pcursor->Seek(CoinEntry(&start));
     // Cache key of first record
     if (i->pcursor->Valid()) {
         CoinEntry entry(&i->keyTmp.second);
@@ -224,6 +287,14 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
+bool CCoinsViewDB::ReadCoinsStats(CIncrementalCoinsStats& stats) const {
+    return db.Read(DB_COINS_STATS, stats);
+}
+
+bool CCoinsViewDB::WriteCoinsStats(const CIncrementalCoinsStats& stats) {
+    return db.Write(DB_COINS_STATS, stats);
+}
+
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
@@ -236,17 +307,6 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
-bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
-    return Read(std::make_pair(DB_TXINDEX, txid), pos);
-}
-
-bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_TXINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -259,6 +319,34 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+bool CBlockTreeDB::EraseLegacyTxIndex()
+{
+    // The flag was written whenever the entries were in use, so without it
+    // there is nothing to erase.
+    const std::pair<char, std::string> keyFlag = std::make_pair(DB_FLAG, std::string("txindex"));
+    if (!Exists(keyFlag))
+        return true;
+
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+    std::pair<char, uint256> key;
+    for (pcursor->Seek(std::make_pair(DB_LEGACY_TXINDEX, uint256())); pcursor->Valid(); pcursor->Next()) {
+        if (!pcursor->GetKey(key) || key.first != DB_LEGACY_TXINDEX)
+            break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > batch_size) {
+            if (!WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+    }
+    // Only drop the flag once all entries are gone, so that an interrupted
+    // erase is resumed.
+    batch.Erase(keyFlag);
+    return WriteBatch(batch, true);
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -16,6 +16,7 @@
 #include <vector>
 
 class CBlockIndex;
+class CIncrementalCoinsStats;
 class CCoinsViewDBCursor;
 class uint256;
 
@@ -29,12 +30,14 @@ static const int64_t nDefaultDbBatchSize = 16 << 20;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
 static const int64_t nMinDbCache = 4;
-//! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
+//! Max memory allocated to block tree DB specific cache (MiB)
 static const int64_t nMaxBlockDBCache = 2;
-//! Max memory allocated to block tree DB specific cache, if -txindex (MiB)
+//! Max memory allocated to the transaction index DB specific cache, if -txindex (MiB)
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
-static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
+static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to the script hash index DB specific cache, if -scripthashindex (MiB)
+static const int64_t nMaxScriptHashIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -77,10 +80,31 @@ public:
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
+    //! Cursor positioned at the first coin whose txid is not below txidStart
+    CCoinsViewCursor *Cursor(const uint256 &txidStart) const;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    /**
+     * Bulk loading, bypassing the cache layer (used by UTXO snapshot import).
+     * While a load is in progress the database is marked as transitioning to
+     * hashBlock, so an interrupted load is detected at startup; WriteBestBlock
+     * marks it consistent again.
+     */
+    bool WriteCoinsBatch(const std::vector<std::pair<COutPoint, Coin>>& coins, const uint256& hashBlock);
+    bool WriteBestBlock(const uint256& hashBlock);
+    //! Drop the transition mark of an abandoned load, leaving no best block as after -reindex-chainstate.
+    bool EraseHeadBlocks();
+    //! Remove every coin from the database. Returns the number of coins erased, or -1 on failure.
+    int64_t EraseAllCoins(const uint256& hashBlock);
+
+    //! Incrementally maintained UTXO statistics (-utxostats), valid only if their hashBlock matches GetBestBlock()
+    bool ReadCoinsStats(CIncrementalCoinsStats& stats) const;
+    bool WriteCoinsStats(const CIncrementalCoinsStats& stats);
+
+    const CDBWrapper& GetDB() const { return db; }
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -119,10 +143,10 @@ public:
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool &fReindex);
-    bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
-    bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    /** Erase the transaction index entries left by versions that kept -txindex in this database. */
+    bool EraseLegacyTxIndex();
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
@@ -0,0 +1,126 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxosnapshot.h"
+
+#include "coinstats.h"
+#include "hash.h"
+#include "streams.h"
+#include "util.h"
+#include "version.h"
+
+#include <stdio.h>
+
+#include <boost/thread.hpp> // boost::this_thread::interruption_point
+
+const unsigned char SnapshotMetadata::SNAPSHOT_MAGIC[5] = {'u', 't', 'x', 'o', 0xff};
+
+static void WriteSnapshotTx(CAutoFile& file, const uint256& txid, const std::map<uint32_t, Coin>& outputs)
+{
+    file << txid;
+    file << VARINT((uint32_t)outputs.size());
+    for (const auto& output : outputs) {
+        file << VARINT(output.first);
+        file << output.second;
+    }
+}
+
+bool WriteUTXOSnapshot(CAutoFile& file, CCoinsViewCursor* pcursor, SnapshotMetadata& metadata)
+{
+    assert(metadata.hashBaseBlock == pcursor->GetBestBlock());
+
+    // Write a provisional header; it is rewritten once the hash is known.
+    file << metadata;
+
+    CCoinsStats stats;
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << metadata.hashBaseBlock;
+    uint256 prevkey;
+    std::map<uint32_t, Coin> outputs;
+    try {
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            COutPoint key;
+            Coin coin;
+            if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+                return error("%s: unable to read value", __func__);
+            }
+            if (!outputs.empty() && key.hash != prevkey) {
+                ApplyCoinsStats(stats, ss, prevkey, outputs);
+                WriteSnapshotTx(file, prevkey, outputs);
+                outputs.clear();
+            }
+            prevkey = key.hash;
+            outputs[key.n] = std::move(coin);
+            pcursor->Next();
+        }
+        if (!outputs.empty()) {
+            ApplyCoinsStats(stats, ss, prevkey, outputs);
+            WriteSnapshotTx(file, prevkey, outputs);
+        }
+
+        metadata.nCoins = stats.nTransactionOutputs;
+        metadata.hashSerialized = ss.GetHash();
+        if (fseek(file.Get(), 0, SEEK_SET) != 0) {
+            return error("%s: unable to rewind snapshot file", __func__);
+        }
+        file << metadata;
+        FileCommit(file.Get());
+    } catch (const std::exception& e) {
+        return error("%s: failed to write snapshot: %s", __func__, e.what());
+    }
+    return true;
+}
+
+void ReadUTXOSnapshotTx(CAutoFile& file, uint256& txid, std::map<uint32_t, Coin>& outputs)
+{
+    uint32_t nOutputs = 0;
+    file >> txid;
+    file >> VARINT(nOutputs);
+    if (nOutputs == 0) {
+        throw std::ios_base::failure("empty transaction entry in snapshot");
+    }
+    outputs.clear();
+    for (uint32_t i = 0; i < nOutputs; i++) {
+        uint32_t n = 0;
+        Coin coin;
+        file >> VARINT(n);
+        file >> coin;
+        if (coin.IsSpent() || !outputs.emplace(n, std::move(coin)).second) {
+            throw std::ios_base::failure("invalid output entry in snapshot");
+        }
+    }
+}
+
+bool VerifyUTXOSnapshot(CAutoFile& file, const SnapshotMetadata& metadata, std::string& strError)
+{
+    CCoinsStats stats;
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << metadata.hashBaseBlock;
+    uint256 txid;
+    std::map<uint32_t, Coin> outputs;
+    try {
+        while (stats.nTransactionOutputs < metadata.nCoins) {
+            boost::this_thread::interruption_point();
+            ReadUTXOSnapshotTx(file, txid, outputs);
+            ApplyCoinsStats(stats, ss, txid, outputs);
+        }
+    } catch (const std::exception& e) {
+        strError = strprintf("snapshot is truncated or corrupt: %s", e.what());
+        return false;
+    }
+    if (stats.nTransactionOutputs != metadata.nCoins) {
+        strError = strprintf("snapshot contains %u coins, header says %u", stats.nTransactionOutputs, metadata.nCoins);
+        return false;
+    }
+    if (!feof(file.Get()) && fgetc(file.Get()) != EOF) {
+        strError = "snapshot has trailing data";
+        return false;
+    }
+    if (ss.GetHash() != metadata.hashSerialized) {
+        strError = strprintf("snapshot hash %s does not match header hash %s", ss.GetHash().ToString(), metadata.hashSerialized.ToString());
+        return false;
+    }
+    return true;
+}
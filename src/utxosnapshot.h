@@ -0,0 +1,106 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTXOSNAPSHOT_H
+#define BITCOIN_UTXOSNAPSHOT_H
+
+#include "coins.h"
+#include "protocol.h" // For CMessageHeader::MessageStartChars
+#include "serialize.h"
+#include "uint256.h"
+
+#include <ios>
+#include <map>
+#include <string.h>
+#include <string>
+
+class CAutoFile;
+class CCoinsViewCursor;
+
+/** Amount of coin data (in bytes, estimated) to accumulate before writing a batch during snapshot loading */
+static const size_t SNAPSHOT_LOAD_BATCH_SIZE = 128 << 20;
+
+/**
+ * Header of a UTXO set snapshot file, as written by dumptxoutset.
+ *
+ * Serialized format:
+ * - 5 bytes: magic "utxo\xff"
+ * - uint16: version
+ * - 4 bytes: network message start, so a snapshot is never loaded on the wrong chain
+ * - uint256: hash of the block the snapshot was taken at
+ * - uint64: nChainTx of that block
+ * - uint64: number of coins
+ * - uint256: hash_serialized_2 of the coins, as reported by gettxoutsetinfo
+ *
+ * The header is followed by the coins grouped per transaction, in coins
+ * database key order: txid, VARINT(number of outputs), and for every output
+ * VARINT(n) followed by the Coin (which uses CTxOutCompressor).
+ */
+class SnapshotMetadata
+{
+public:
+    static const uint16_t CURRENT_VERSION = 1;
+    static const unsigned char SNAPSHOT_MAGIC[5];
+
+    uint16_t nVersion;
+    CMessageHeader::MessageStartChars pchMessageStart;
+    uint256 hashBaseBlock;
+    uint64_t nChainTx;
+    uint64_t nCoins;
+    uint256 hashSerialized;
+
+    SnapshotMetadata() : nVersion(CURRENT_VERSION), nChainTx(0), nCoins(0)
+    {
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+    }
+
+    SnapshotMetadata(const CMessageHeader::MessageStartChars& pchMessageStartIn, const uint256& hashBaseBlockIn, uint64_t nChainTxIn) :
+        nVersion(CURRENT_VERSION), hashBaseBlock(hashBaseBlockIn), nChainTx(nChainTxIn), nCoins(0)
+    {
+        memcpy(pchMessageStart, pchMessageStartIn, sizeof(pchMessageStart));
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s.write((const char*)SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        s << nVersion;
+        s.write((const char*)pchMessageStart, sizeof(pchMessageStart));
+        s << hashBaseBlock << nChainTx << nCoins << hashSerialized;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char magic[sizeof(SNAPSHOT_MAGIC)];
+        s.read((char*)magic, sizeof(magic));
+        if (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0) {
+            throw std::ios_base::failure("not a UTXO snapshot file");
+        }
+        s >> nVersion;
+        if (nVersion > CURRENT_VERSION) {
+            throw std::ios_base::failure("unsupported UTXO snapshot version");
+        }
+        s.read((char*)pchMessageStart, sizeof(pchMessageStart));
+        s >> hashBaseBlock >> nChainTx >> nCoins >> hashSerialized;
+    }
+};
+
+/**
+ * Stream the coins behind pcursor into file, preceded by the header in
+ * metadata. nCoins and hashSerialized are filled in while writing and the
+ * header is rewritten once the body is complete.
+ */
+bool WriteUTXOSnapshot(CAutoFile& file, CCoinsViewCursor* pcursor, SnapshotMetadata& metadata);
+
+/** Read the next transaction's coins from a snapshot body. Throws on a truncated or corrupt file. */
+void ReadUTXOSnapshotTx(CAutoFile& file, uint256& txid, std::map<uint32_t, Coin>& outputs);
+
+/**
+ * Read the snapshot body and check it against the coin count and
+ * hash_serialized_2 in its header. Leaves the file positioned at its end.
+ */
+bool VerifyUTXOSnapshot(CAutoFile& file, const SnapshotMetadata& metadata, std::string& strError);
+
+#endif // BITCOIN_UTXOSNAPSHOT_H
@@ -6,45 +6,64 @@
 #include "validation.h"
 
 #include "arith_uint256.h"
+#include "blockcache.h"
+#include "blockfileflusher.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "coinstats.h"
+#include "compressor.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
 #include "cuckoocache.h"
 #include "fs.h"
 #include "hash.h"
+#include "index/txindex.h"
 #include "init.h"
+#include "mappedfile.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
 #include "policy/rbf.h"
 #include "pow.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
+#include "pubkey.h"
 #include "random.h"
 #include "reverse_iterator.h"
 #include "script/script.h"
 #include "script/sigcache.h"
 #include "script/standard.h"
+#include "streams.h"
 #include "timedata.h"
 #include "tinyformat.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "undo.h"
+#include "utxosnapshot.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
 #include "validationinterface.h"
+#include "validationstats.h"
 #include "versionbits.h"
 #include "warnings.h"
 #include "metronome_helper.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
 #include <sstream>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -61,6 +80,7 @@
 CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
+CBlockIndexArena blockIndexArena;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = nullptr;
 CWaitableCriticalSection csBestBlock;
@@ -68,17 +88,18 @@ CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
 std::atomic_bool fImporting(false);
 bool fReindex = false;
-bool fTxIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fUTXOStats = DEFAULT_UTXOSTATS;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nDiffBitsIgnore = 69600;
 uint64_t clockRelaxationTime = 60; // 60 seconds
 uint64_t nPruneTarget = 0;
+bool fCompressBlocks = DEFAULT_COMPRESS_BLOCKS;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 
@@ -93,6 +114,8 @@ CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
 
 CBlockPolicyEstimator feeEstimator;
 CTxMemPool mempool(&feeEstimator);
+CBlockCache blockCache(DEFAULT_BLOCK_CACHE_SIZE << 20);
+CConnectTimesLog connectTimesLog(CONNECT_TIMES_LOG_SIZE);
 
 uint256 HF1_BLOCK_HASH   = uint256S("0x000000000539e8444a827f922157d3633ab16811b626449176e6cb9a3497b62a");
 int64_t HF1_BLOCK_HEIGHT = 91550;
@@ -188,6 +211,19 @@ namespace {
 
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
+
+    /** Incrementally maintained UTXO set statistics (-utxostats). Only
+      * meaningful while their hashBlock is the best block of pcoinsTip. */
+    CIncrementalCoinsStats coinsStats;
+
+    CIncrementalCoinsStats* GetTrackedCoinsStats(const uint256& hashCoinsTip)
+    {
+        return fUTXOStats && coinsStats.hashBlock == hashCoinsTip ? &coinsStats : nullptr;
+    }
+
+    /** Set while LoadUTXOSnapshot() fills the coins database without cs_main.
+      * Meanwhile the tip stays where it is and the coins cache is not flushed. */
+    std::atomic<bool> fLoadingSnapshot(false);
 } // anon namespace
 
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
@@ -382,6 +418,41 @@ static bool IsCurrentForFeeEstimation()
     return true;
 }
 
+/**
+ * Call func(nStart, nThreads) for every nStart below nThreads, each on its
+ * own thread and nStart 0 on this one. All threads are joined before
+ * returning, and the first exception any of them threw is rethrown then.
+ */
+template <typename Func>
+static void RunInParallel(size_t nThreads, Func func)
+{
+    nThreads = std::max<size_t>(1, nThreads);
+    std::exception_ptr error;
+    std::mutex csError;
+    auto run = [&](size_t nStart) {
+        try {
+            func(nStart, nThreads);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(csError);
+            if (!error) error = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; i++) {
+        try {
+            threads.emplace_back(run, i);
+        } catch (const std::system_error&) {
+            // Out of threads: do the share here instead.
+            run(i);
+        }
+    }
+    run(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
 /* Make mempool consistent after a reorg, by re-adding or recursively erasing
  * disconnected block transactions from the mempool, and also removing any
  * other transactions from the mempool that are no longer valid given the new
@@ -395,9 +466,54 @@ static bool IsCurrentForFeeEstimation()
  * and instead just erase from the mempool as needed.
  */
 
+/**
+ * Verify the scripts of the transactions about to be added back to the
+ * mempool on -par threads, so that the signatures that pass are in the
+ * signature cache by the time AcceptToMemoryPool checks them one
+ * transaction at a time. Results are not used otherwise.
+ */
+static void CacheReorgSignatures(const DisconnectedBlockTransactions &disconnectpool)
+{
+    AssertLockHeld(cs_main);
+    if (nScriptCheckThreads <= 0)
+        return;
+
+    // Outputs of earlier disconnected transactions are visible to later ones.
+    CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+    CCoinsViewCache view(&viewMemPool);
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(disconnectpool.queuedTx.size());
+    std::vector<CScriptCheck> checks;
+    for (auto it = disconnectpool.queuedTx.get<insertion_order>().rbegin(); it != disconnectpool.queuedTx.get<insertion_order>().rend(); ++it) {
+        const CTransaction& tx = **it;
+        if (tx.IsCoinBase())
+            continue;
+        bool fHaveInputs = true;
+        for (const CTxIn& txin : tx.vin) {
+            fHaveInputs = fHaveInputs && view.HaveCoin(txin.prevout);
+        }
+        if (fHaveInputs) {
+            txdata.emplace_back(tx);
+            for (unsigned int i = 0; i < tx.vin.size(); i++) {
+                const CTxOut& txout = view.AccessCoin(tx.vin[i].prevout).out;
+                checks.emplace_back(txout.scriptPubKey, txout.nValue, tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, true, &txdata.back());
+            }
+        }
+        AddCoins(view, tx, MEMPOOL_HEIGHT, true);
+    }
+
+    RunInParallel(std::min<size_t>(checks.size(), nScriptCheckThreads), [&checks](size_t nStart, size_t nStep) {
+        for (size_t i = nStart; i < checks.size(); i += nStep) {
+            checks[i]();
+        }
+    });
+}
+
 void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool, bool fAddToMempool)
 {
     AssertLockHeld(cs_main);
+    if (fAddToMempool)
+        CacheReorgSignatures(disconnectpool);
     std::vector<uint256> vHashUpdate;
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
@@ -941,25 +1057,8 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
         return true;
     }
 
-    if (fTxIndex) {
-        CDiskTxPos postx;
-        if (pblocktree->ReadTxIndex(hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
-            CBlockHeader header;
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            }
-            hashBlock = header.GetHash();
-            if (txOut->GetHash() != hash)
-                return error("%s: txid mismatch", __func__);
-            return true;
-        }
+    if (g_txindex && g_txindex->FindTx(hash, hashBlock, txOut)) {
+        return true;
     }
 
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
@@ -993,6 +1092,40 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
 // CBlock and CBlockIndex
 //
 
+//! Size of the message start and length that precede each block in a block file
+static const unsigned int BLOCK_HEADER_SIZE = CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+//! Set in the length of blocks stored through CBlockCompressor
+static const uint32_t BLOCK_COMPACT_FLAG = 0x80000000;
+//! Block files kept memory mapped for reading blocks
+static const size_t MAX_MAPPED_BLOCK_FILES = 64;
+
+static CMappedFileCache mappedBlockFiles(MAX_MAPPED_BLOCK_FILES);
+
+/**
+ * Size a block takes in a block file, without its index header. With
+ * -compressblocks, blocks are stored compactly unless that would lose data
+ * or not save space.
+ */
+static unsigned int GetBlockRecordSize(const CBlock& block, bool& fCompact)
+{
+    const unsigned int nSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    fCompact = false;
+    if (fCompressBlocks && CBlockCompressor::IsLossless(block)) {
+        const unsigned int nCompactSize = ::GetSerializeSize(CBlockCompressor(REF(block)), SER_DISK, CLIENT_VERSION);
+        if (nCompactSize < nSize) {
+            fCompact = true;
+            return nCompactSize;
+        }
+    }
+    return nSize;
+}
+
+static unsigned int GetBlockRecordSize(const CBlock& block)
+{
+    bool fCompact;
+    return GetBlockRecordSize(block, fCompact);
+}
+
 static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
@@ -1001,16 +1134,148 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, block);
-    fileout << FLATDATA(messageStart) << nSize;
+    bool fCompact;
+    unsigned int nSize = GetBlockRecordSize(block, fCompact);
+    fileout << FLATDATA(messageStart) << (fCompact ? nSize | BLOCK_COMPACT_FLAG : nSize);
 
     // Write block
     long fileOutPos = ftell(fileout.Get());
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    if (fCompact)
+        fileout << CBlockCompressor(REF(block));
+    else
+        fileout << block;
+
+    return true;
+}
+
+static bool ParseBlockRecordHeader(const unsigned char* pheader, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, unsigned int& nSize, bool& fCompact)
+{
+    if (memcmp(pheader, messageStart, CMessageHeader::MESSAGE_START_SIZE))
+        return error("%s: Block magic mismatch at %s", __func__, pos.ToString());
+    const uint32_t nHeaderSize = ReadLE32(pheader + CMessageHeader::MESSAGE_START_SIZE);
+    fCompact = (nHeaderSize & BLOCK_COMPACT_FLAG) != 0;
+    nSize = nHeaderSize & ~BLOCK_COMPACT_FLAG;
+    if (nSize > MAX_SIZE)
+        return error("%s: Block size %u too large at %s", __func__, nSize, pos.ToString());
+    return true;
+}
+
+/** Read a block record and its index header through stdio, where block files cannot be mapped */
+static bool ReadBlockRecordFromFile(std::vector<unsigned char>& record, bool& fCompact, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    CDiskBlockPos posHeader(pos.nFile, pos.nPos - BLOCK_HEADER_SIZE);
+    CAutoFile filein(OpenBlockFile(posHeader, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("ReadRawBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+    try {
+        unsigned char header[BLOCK_HEADER_SIZE];
+        unsigned int nSize;
+        filein.read((char*)header, sizeof(header));
+        if (!ParseBlockRecordHeader(header, pos, messageStart, nSize, fCompact))
+            return false;
+        record.resize(nSize);
+        filein.read((char*)record.data(), nSize);
+    } catch (const std::exception& e) {
+        return error("%s: Read from block file failed - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
+/** Read the block at pos as stored, and whether it was stored through CBlockCompressor */
+static bool ReadBlockRecord(std::vector<unsigned char>& record, bool& fCompact, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    if (pos.IsNull() || pos.nPos < BLOCK_HEADER_SIZE)
+        return error("ReadRawBlockFromDisk: Invalid block position %s", pos.ToString());
+
+    const fs::path path = GetBlockPosFilename(pos, "blk");
+    std::shared_ptr<const CMappedFile> file = mappedBlockFiles.Get(pos.nFile, path, pos.nPos);
+    if (!file)
+        return ReadBlockRecordFromFile(record, fCompact, pos, messageStart);
+
+    unsigned int nSize;
+    if (!ParseBlockRecordHeader(file->data() + pos.nPos - BLOCK_HEADER_SIZE, pos, messageStart, nSize, fCompact))
+        return false;
+    if (nSize > file->size() - pos.nPos) {
+        // Written after the file was mapped
+        file = mappedBlockFiles.Get(pos.nFile, path, (size_t)pos.nPos + nSize);
+        if (!file)
+            return ReadBlockRecordFromFile(record, fCompact, pos, messageStart);
+    }
+    record.assign(file->data() + pos.nPos, file->data() + pos.nPos + nSize);
+    return true;
+}
+
+bool ReadBlockRecordHeader(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, unsigned int& nSize, bool& fCompact)
+{
+    if (pos.IsNull() || pos.nPos < BLOCK_HEADER_SIZE)
+        return error("%s: Invalid block position %s", __func__, pos.ToString());
+
+    std::shared_ptr<const CMappedFile> file = mappedBlockFiles.Get(pos.nFile, GetBlockPosFilename(pos, "blk"), pos.nPos);
+    if (file)
+        return ParseBlockRecordHeader(file->data() + pos.nPos - BLOCK_HEADER_SIZE, pos, messageStart, nSize, fCompact);
+
+    CAutoFile filein(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - BLOCK_HEADER_SIZE), true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    try {
+        unsigned char header[BLOCK_HEADER_SIZE];
+        filein.read((char*)header, sizeof(header));
+        return ParseBlockRecordHeader(header, pos, messageStart, nSize, fCompact);
+    } catch (const std::exception& e) {
+        return error("%s: Read from block file failed - %s at %s", __func__, e.what(), pos.ToString());
+    }
+}
+
+std::shared_ptr<const CBlock> ReadBlockFromDiskCached(const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+{
+    std::shared_ptr<const CBlock> pblock = blockCache.Get(pindex->GetBlockHash());
+    if (pblock)
+        return pblock;
+    std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
+        return nullptr;
+    blockCache.Insert(pblockRead, false);
+    return pblockRead;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    bool fCompact;
+    if (!ReadBlockRecord(block, fCompact, pos, messageStart))
+        return false;
+    if (fCompact) {
+        // Callers get the serialization blocks are relayed and hashed in.
+        CBlock decoded;
+        try {
+            CVectorReader(SER_DISK, CLIENT_VERSION, block, 0) >> REF(CBlockCompressor(decoded));
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+        std::vector<unsigned char> vchBlock;
+        CVectorWriter(SER_DISK, CLIENT_VERSION, vchBlock, 0, decoded);
+        block.swap(vchBlock);
+    }
+    return true;
+}
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    if (!ReadRawBlockFromDisk(block, pindex->GetBlockPos(), messageStart))
+        return false;
+    // The header comes first, so its hash is checked without decoding the rest.
+    CBlockHeader header;
+    try {
+        CVectorReader(SER_DISK, CLIENT_VERSION, block, 0) >> header;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s at %s", __func__, e.what(), pindex->GetBlockPos().ToString());
+    }
+    if (header.GetHash() != pindex->GetBlockHash())
+        return error("ReadRawBlockFromDisk(CBlockIndex*): GetHash() doesn't match index for %s at %s",
+                pindex->ToString(), pindex->GetBlockPos().ToString());
     return true;
 }
 
@@ -1018,14 +1283,18 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    std::vector<unsigned char> vchBlock;
+    bool fCompact;
+    if (!ReadBlockRecord(vchBlock, fCompact, pos, Params().MessageStart()))
+        return false;
 
     // Read block
     try {
-        filein >> block;
+        CVectorReader reader(SER_DISK, CLIENT_VERSION, vchBlock, 0);
+        if (fCompact)
+            reader >> REF(CBlockCompressor(block));
+        else
+            reader >> block;
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1232,6 +1501,39 @@ bool CScriptCheck::operator()() {
     return VerifyScript(scriptSig, scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, amount, cacheStore, *txdata), &error);
 }
 
+bool CScriptCheck::operator()(CSignatureBatch& batch, size_t nBatchBegin) {
+    // Signatures checked here are to be added to the cache, one at a time.
+    if (cacheStore)
+        return (*this)();
+    const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+    const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
+    return VerifyScript(scriptSig, scriptPubKey, witness, nFlags, BatchingTransactionSignatureChecker(ptxTo, nIn, amount, *txdata, batch, nBatchBegin), &error);
+}
+
+bool CheckBatch(std::vector<CScriptCheck>& vChecks)
+{
+    CSignatureBatch batch;
+    std::vector<size_t> vBatchBegin;
+    std::vector<bool> vPassed;
+    vBatchBegin.reserve(vChecks.size() + 1);
+    vPassed.reserve(vChecks.size());
+    for (CScriptCheck& check : vChecks) {
+        vBatchBegin.push_back(batch.size());
+        vPassed.push_back(check(batch, vBatchBegin.back()));
+    }
+    vBatchBegin.push_back(batch.size());
+    batch.Verify();
+    for (size_t i = 0; i < vChecks.size(); i++) {
+        if (vPassed[i] && batch.AllValid(vBatchBegin[i], vBatchBegin[i + 1]))
+            continue;
+        // A signature assumed valid was not, or the script failed with one
+        // that may not be: run it again with the actual answers.
+        if (!vChecks[i](batch, vBatchBegin[i]))
+            return false;
+    }
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1242,16 +1544,25 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
+/** Activity of scriptExecutionCache, guarded by cs_main like the cache itself */
+static SignatureCacheStats scriptExecutionCacheStats = {};
 
 void InitScriptExecutionCache() {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     size_t nElems = scriptExecutionCache.setup_bytes(nMaxCacheSize);
+    scriptExecutionCacheStats.nCapacity = nElems;
     LogPrintf("Using %zu MiB out of %zu/2 requested for script execution cache, able to store %zu elements\n",
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+SignatureCacheStats GetScriptExecutionCacheStats()
+{
+    LOCK(cs_main);
+    return scriptExecutionCacheStats;
+}
+
 /**
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set.
@@ -1298,8 +1609,10 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
             AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
             if (scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
+                scriptExecutionCacheStats.nHits++;
                 return true;
             }
+            scriptExecutionCacheStats.nMisses++;
 
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint &prevout = tx.vin[i].prevout;
@@ -1346,7 +1659,9 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             if (cacheFullScriptStore && !pvChecks) {
                 // We executed all of the provided scripts, and were told to
                 // cache the result. Do so now.
-                scriptExecutionCache.insert(hashCacheEntry);
+                scriptExecutionCacheStats.nInserts++;
+                if (!scriptExecutionCache.insert(hashCacheEntry))
+                    scriptExecutionCacheStats.nEvictions++;
             }
         }
     }
@@ -1409,6 +1724,18 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull())
+        return error("%s: no undo data available for block %s", __func__, pindex->GetBlockHash().ToString());
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
+namespace {
+
 /** Abort with a message */
 bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1470,22 +1797,14 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
-/** Undo the effects of this block (with given index) on the UTXO set represented by coins.
- *  When FAILED is returned, view is left in an indeterminate state. */
-static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+/** Undo the effects of this block (with given index and undo data) on the UTXO set represented by coins.
+ *  When FAILED is returned, view is left in an indeterminate state.
+ *  If pstats is given, it is updated to match, but only when DISCONNECT_OK is returned. */
+static DisconnectResult ApplyBlockUndo(CBlockUndo& blockUndo, const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CIncrementalCoinsStats* pstats)
 {
     bool fClean = true;
-
-    CBlockUndo blockUndo;
-    CDiskBlockPos pos = pindex->GetUndoPos();
-    if (pos.IsNull()) {
-        error("DisconnectBlock(): no undo data available");
-        return DISCONNECT_FAILED;
-    }
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
-        error("DisconnectBlock(): failure reading undo data");
-        return DISCONNECT_FAILED;
-    }
+    CIncrementalCoinsStats statsNew;
+    if (pstats) statsNew = *pstats;
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         error("DisconnectBlock(): block and undo data inconsistent");
@@ -1508,6 +1827,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 if (!is_spent || tx.vout[o] != coin.out || pindex->nHeight != coin.nHeight || is_coinbase != coin.fCoinBase) {
                     fClean = false; // transaction output mismatch
                 }
+                if (pstats && is_spent) {
+                    statsNew.RemoveCoin(out, coin);
+                }
             }
         }
 
@@ -1523,6 +1845,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
+                if (pstats) {
+                    statsNew.AddCoin(out, view.AccessCoin(out));
+                }
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -1531,35 +1856,91 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
+    if (pstats && fClean) {
+        statsNew.hashBlock = pindex->pprev->GetBlockHash();
+        *pstats = statsNew;
+    }
+
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
-void static FlushBlockFile(bool fFinalize = false)
+/** Undo the effects of this block (with given index) on the UTXO set represented by coins.
+ *  When FAILED is returned, view is left in an indeterminate state.
+ *  If pstats is given, it is updated to match, but only when DISCONNECT_OK is returned. */
+static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CIncrementalCoinsStats* pstats = nullptr)
+{
+    CBlockUndo blockUndo;
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull()) {
+        error("DisconnectBlock(): no undo data available");
+        return DISCONNECT_FAILED;
+    }
+    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash())) {
+        error("DisconnectBlock(): failure reading undo data");
+        return DISCONNECT_FAILED;
+    }
+    return ApplyBlockUndo(blockUndo, block, pindex, view, pstats);
+}
+
+/** Drop the space preallocated beyond the data in block file nFile and its undo file. */
+static void FinalizeBlockFile(int nFile)
 {
     LOCK(cs_LastBlockFile);
 
-    CDiskBlockPos posOld(nLastBlockFile, 0);
+    CDiskBlockPos pos(nFile, 0);
+
+    FILE *file = OpenBlockFile(pos);
+    if (file) {
+        // Later mappings must not extend past the new end of the file.
+        mappedBlockFiles.Erase(nFile);
+        TruncateFile(file, vinfoBlockFile[nFile].nSize);
+        fclose(file);
+    }
+
+    file = OpenUndoFile(pos);
+    if (file) {
+        TruncateFile(file, vinfoBlockFile[nFile].nUndoSize);
+        fclose(file);
+    }
+}
+
+/**
+ * Sync block file nFile and its undo file to disk. Needs no lock. Files are
+ * not created when missing, so one pruned meanwhile is skipped.
+ */
+static void CommitBlockFile(int nFile)
+{
+    CDiskBlockPos pos(nFile, 0);
 
-    FILE *fileOld = OpenBlockFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
+    FILE *file = OpenBlockFile(pos, true);
+    if (file) {
+        FileCommit(file);
+        fclose(file);
     }
 
-    fileOld = OpenUndoFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nUndoSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
+    file = OpenUndoFile(pos, true);
+    if (file) {
+        FileCommit(file);
+        fclose(file);
     }
 }
 
+static CBlockFileFlusher blockFileFlusher(CommitBlockFile);
+
+void StartBlockFileFlusher()
+{
+    blockFileFlusher.Start();
+}
+
+void StopBlockFileFlusher()
+{
+    blockFileFlusher.Stop();
+}
+
 static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+typedef CWorkStealingCheckQueue<CScriptCheck> CScriptCheckQueue;
+static CScriptCheckQueue scriptcheckqueue(16);
 
 void ThreadScriptCheck() {
     RenameThread("bitcoin-scriptch");
@@ -1654,11 +2035,61 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+//! Below this many transactions per thread, starting a thread costs more than it saves.
+static const size_t MIN_TXS_PER_THREAD = 32;
+
+/**
+ * Call func(nStart, nStep) on up to -par threads, including this one, so
+ * that together they visit every index below nTxs.
+ */
+template <typename Func>
+static void ForEachTxInParallel(size_t nTxs, Func func)
+{
+    RunInParallel(std::min<size_t>(nTxs / MIN_TXS_PER_THREAD, nScriptCheckThreads), func);
+}
+
+/**
+ * The signature hash midstates of every transaction in a block. They only
+ * depend on the transactions themselves, so they are computed in parallel
+ * ahead of the serial pass over the coins.
+ */
+static std::vector<PrecomputedTransactionData> PrecomputeBlockTxData(const CBlock& block)
+{
+    std::vector<PrecomputedTransactionData> txdata(block.vtx.size());
+    ForEachTxInParallel(block.vtx.size(), [&](size_t nStart, size_t nStep) {
+        for (size_t i = nStart; i < block.vtx.size(); i += nStep) {
+            txdata[i] = PrecomputedTransactionData(*block.vtx[i]);
+        }
+    });
+    return txdata;
+}
+
+void DeserializeBlock(CDataStream& s, CBlock& block)
+{
+    s >> static_cast<CBlockHeader&>(block);
+    // Grow as the transactions are read rather than trusting the count, as
+    // the serializer does.
+    const uint64_t nTxs = ReadCompactSize(s);
+    std::vector<CMutableTransaction> vmtx;
+    for (uint64_t i = 0; i < nTxs; i++) {
+        vmtx.emplace_back(deserialize, s);
+    }
+    block.vtx.assign(vmtx.size(), nullptr);
+    ForEachTxInParallel(vmtx.size(), [&](size_t nStart, size_t nStep) {
+        for (size_t i = nStart; i < vmtx.size(); i += nStep) {
+            block.vtx[i] = MakeTransactionRef(std::move(vmtx[i]));
+        }
+    });
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
- *  can fail if those validity checks fail (among other reasons). */
+ *  can fail if those validity checks fail (among other reasons).
+ *  If pstats is given, it is updated to match once the block has been connected successfully.
+ *  If ptimes is given, the time spent on inputs, scripts and undo data is recorded in it. */
 static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false,
+                  CIncrementalCoinsStats* pstats = nullptr, BlockConnectTimes* ptimes = nullptr)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -1693,8 +2124,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     // Special case for the genesis block, skipping connection of its transactions
     // (its coinbase is unspendable)
     if (block.GetHash() == chainparams.GetConsensus().hashGenesisBlock) {
-        if (!fJustCheck)
+        if (!fJustCheck) {
             view.SetBestBlock(pindex->GetBlockHash());
+            if (pstats) pstats->hashBlock = pindex->GetBlockHash();
+        }
         return true;
     }
 
@@ -1778,18 +2211,18 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     CBlockUndo blockundo;
 
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    CCheckQueueControl<CScriptCheck, CScriptCheckQueue> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
     int nInputs = 0;
-    int64_t nSigOpsCost = 0;
-    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
-    vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<PrecomputedTransactionData> txdata;
-    txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
+    // Only the coins need a serial pass; the script checks keep pointers
+    // into txdata, which is never resized.
+    std::vector<PrecomputedTransactionData> txdata = PrecomputeBlockTxData(block);
+    // Coins overwritten by a duplicate coinbase (only possible where BIP30 is not enforced)
+    std::vector<std::pair<COutPoint, Coin>> vOverwritten;
+    int64_t nSigOpsCost = 0;
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
@@ -1816,26 +2249,24 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             }
         }
 
-        // GetTransactionSigOpCost counts 3 types of sigops:
-        // * legacy (always)
-        // * p2sh (when P2SH enabled in flags and excludes coinbase)
-        // * witness (when witness enabled in flags and excludes coinbase)
-        nSigOpsCost += GetTransactionSigOpCost(tx, view, flags);
-        if (nSigOpsCost > MAX_BLOCK_SIGOPS_COST)
-            return state.DoS(100, error("ConnectBlock(): too many sigops"),
-                             REJECT_INVALID, "bad-blk-sigops");
-
-        txdata.emplace_back(tx);
+        std::vector<CScriptCheck> vChecks;
         if (!tx.IsCoinBase())
         {
             nFees += view.GetValueIn(tx)-tx.GetValueOut();
 
-            std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
-            control.Add(vChecks);
+        }
+
+        if (pstats && !fEnforceBIP30 && tx.IsCoinBase()) {
+            for (size_t o = 0; o < tx.vout.size(); o++) {
+                const Coin& coin = view.AccessCoin(COutPoint(tx.GetHash(), o));
+                if (!coin.IsSpent()) {
+                    vOverwritten.emplace_back(COutPoint(tx.GetHash(), o), coin);
+                }
+            }
         }
 
         CTxUndo undoDummy;
@@ -1844,9 +2275,20 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
 
-        vPos.push_back(std::make_pair(tx.GetHash(), pos));
-        pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+        // GetTransactionSigOpCost counts 3 types of sigops:
+        // * legacy (always)
+        // * p2sh (when P2SH enabled in flags and excludes coinbase)
+        // * witness (when witness enabled in flags and excludes coinbase)
+        // The coins the inputs spent are in the undo data by now.
+        nSigOpsCost += i == 0 ? GetLegacySigOpCount(tx) * WITNESS_SCALE_FACTOR
+                              : GetTransactionSigOpCost(tx, blockundo.vtxundo.back().vprevout, flags);
+        if (nSigOpsCost > MAX_BLOCK_SIGOPS_COST)
+            return state.DoS(100, error("ConnectBlock(): too many sigops"),
+                             REJECT_INVALID, "bad-blk-sigops");
+
+        control.Add(vChecks);
     }
+
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime3 - nTime2), 0.001 * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * 0.000001);
 
@@ -1884,19 +2326,44 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         setDirtyBlockIndex.insert(pindex);
     }
 
-    if (fTxIndex)
-        if (!pblocktree->WriteTxIndex(vPos))
-            return AbortNode(state, "Failed to write transaction index");
-
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
+    if (pstats) {
+        for (const auto& overwritten : vOverwritten) {
+            pstats->RemoveCoin(overwritten.first, overwritten.second);
+        }
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            const CTransaction &tx = *(block.vtx[i]);
+            if (i > 0) {
+                const CTxUndo &txundo = blockundo.vtxundo[i-1];
+                for (size_t j = 0; j < tx.vin.size(); j++) {
+                    pstats->RemoveCoin(tx.vin[j].prevout, txundo.vprevout[j]);
+                }
+            }
+            for (size_t o = 0; o < tx.vout.size(); o++) {
+                if (!tx.vout[o].scriptPubKey.IsUnspendable()) {
+                    pstats->AddCoin(COutPoint(tx.GetHash(), o), Coin(tx.vout[o], pindex->nHeight, tx.IsCoinBase()));
+                }
+            }
+        }
+        pstats->hashBlock = pindex->GetBlockHash();
+    }
+
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), nTimeIndex * 0.000001);
 
     int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
     LogPrint(BCLog::BENCH, "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime6 - nTime5), nTimeCallbacks * 0.000001);
 
+    if (ptimes) {
+        ptimes->nTx = block.vtx.size();
+        ptimes->nInputs = nInputs - 1;
+        ptimes->nTimeInputs = nTime3 - nTime2;
+        ptimes->nTimeScripts = nTime4 - nTime3;
+        ptimes->nTimeUndo = nTime5 - nTime4;
+    }
+
     return true;
 }
 
@@ -1909,6 +2376,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight) {
     int64_t nMempoolUsage = mempool.DynamicMemoryUsage();
     LOCK(cs_main);
+    if (fLoadingSnapshot)
+        return true;
     static int64_t nLastWrite = 0;
     static int64_t nLastFlush = 0;
     static int64_t nLastSetChain = 0;
@@ -1964,7 +2433,8 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             if (!CheckDiskSpace(0))
                 return state.Error("out of disk space");
             // First make sure all block and undo data is flushed to disk.
-            FlushBlockFile();
+            blockFileFlusher.Sync();
+            CommitBlockFile(nLastBlockFile);
             // Then update all block file information (which may refer to block and undo files).
             {
                 std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
@@ -2000,6 +2470,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // Statistics left behind by a crash before this point no longer match the best block and get recomputed.
+            if (fUTXOStats && coinsStats.hashBlock == pcoinsdbview->GetBestBlock() && !pcoinsdbview->WriteCoinsStats(coinsStats))
+                return AbortNode(state, "Failed to write UTXO set statistics");
             nLastFlush = nNow;
         }
     }
@@ -2091,61 +2564,114 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
 
 }
 
-/** Disconnect chainActive's tip.
+//! Blocks disconnected at once: their data is read ahead in parallel and their undo data applied to one cache layer
+static const size_t DISCONNECT_BATCH_SIZE = 32;
+
+/** A block to disconnect and its undo data, read ahead */
+struct DisconnectData
+{
+    std::shared_ptr<const CBlock> pblock;
+    CBlockUndo blockUndo;
+    bool fHaveUndo = false;
+};
+
+/** Read the blocks and undo data of vpindex on up to -par threads. */
+static void ReadDisconnectData(const std::vector<CBlockIndex*>& vpindex, std::vector<DisconnectData>& vdata, const CChainParams& chainparams)
+{
+    vdata.resize(vpindex.size());
+    auto read = [&](size_t nStart, size_t nStep) {
+        for (size_t i = nStart; i < vpindex.size(); i += nStep) {
+            const CBlockIndex* pindex = vpindex[i];
+            vdata[i].pblock = ReadBlockFromDiskCached(pindex, chainparams.GetConsensus());
+            const CDiskBlockPos pos = pindex->GetUndoPos();
+            vdata[i].fHaveUndo = !pos.IsNull() && UndoReadFromDisk(vdata[i].blockUndo, pos, pindex->pprev->GetBlockHash());
+        }
+    };
+    RunInParallel(std::min<size_t>(vpindex.size(), nScriptCheckThreads), read);
+}
+
+/** Disconnect blocks from chainActive's tip until pindexFork is the tip.
   * After calling, the mempool will be in an inconsistent state, with
   * transactions from disconnected blocks being added to disconnectpool.  You
   * should make the mempool consistent again by calling UpdateMempoolForReorg.
   * with cs_main held.
   *
+  * Blocks are disconnected in batches of DISCONNECT_BATCH_SIZE. A batch either
+  * is disconnected as a whole or leaves the chain state untouched.
+  *
   * If disconnectpool is nullptr, then no disconnected transactions are added to
   * disconnectpool (note that the caller is responsible for mempool consistency
   * in any case).
   */
-bool static DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions *disconnectpool)
+bool static DisconnectTips(CValidationState& state, const CChainParams& chainparams, const CBlockIndex* pindexFork, DisconnectedBlockTransactions *disconnectpool)
 {
-    CBlockIndex *pindexDelete = chainActive.Tip();
-    assert(pindexDelete);
-    // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete, chainparams.GetConsensus()))
-        return AbortNode(state, "Failed to read block");
-    // Apply the block atomically to the chain state.
-    int64_t nStart = GetTimeMicros();
-    {
-        CCoinsViewCache view(pcoinsTip);
-        assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
-            return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
-        bool flushed = view.Flush();
-        assert(flushed);
-    }
-    LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
-    // Write the chain state to disk, if necessary.
-    if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_IF_NEEDED))
-        return false;
-
-    if (disconnectpool) {
-        // Save transactions to re-add to mempool at end of reorg
-        for (auto it = block.vtx.rbegin(); it != block.vtx.rend(); ++it) {
-            disconnectpool->addTransaction(*it);
-        }
-        while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
-            // Drop the earliest entry, and remove its children from the mempool.
-            auto it = disconnectpool->queuedTx.get<insertion_order>().begin();
-            mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
-            disconnectpool->removeEntry(it);
+    AssertLockHeld(cs_main);
+    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
+        std::vector<CBlockIndex*> vpindex;
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex != pindexFork && vpindex.size() < DISCONNECT_BATCH_SIZE; pindex = pindex->pprev) {
+            vpindex.push_back(pindex);
         }
-    }
+        int64_t nStart = GetTimeMicros();
+        std::vector<DisconnectData> vdata;
+        ReadDisconnectData(vpindex, vdata, chainparams);
+        int64_t nRead = GetTimeMicros();
+        // Apply the blocks atomically to the chain state.
+        {
+            CCoinsViewCache view(pcoinsTip);
+            CIncrementalCoinsStats* pstats = GetTrackedCoinsStats(vpindex.front()->GetBlockHash());
+            CIncrementalCoinsStats statsNew;
+            if (pstats) statsNew = *pstats;
+            for (size_t i = 0; i < vpindex.size(); i++) {
+                const CBlockIndex* pindexDelete = vpindex[i];
+                if (!vdata[i].pblock)
+                    return AbortNode(state, "Failed to read block");
+                if (!vdata[i].fHaveUndo)
+                    return error("DisconnectTips(): failure reading undo data of %s", pindexDelete->GetBlockHash().ToString());
+                assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
+                if (ApplyBlockUndo(vdata[i].blockUndo, *vdata[i].pblock, pindexDelete, view, pstats ? &statsNew : nullptr) != DISCONNECT_OK)
+                    return error("DisconnectTips(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
+            }
+            bool flushed = view.Flush();
+            assert(flushed);
+            if (pstats) *pstats = statsNew;
+        }
+        LogPrint(BCLog::BENCH, "- Disconnect %u blocks: %.2fms (read %.2fms)\n", vpindex.size(), (GetTimeMicros() - nStart) * 0.001, (nRead - nStart) * 0.001);
+        // Write the chain state to disk, if necessary.
+        if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_IF_NEEDED))
+            return false;
 
-    // Update chainActive and related variables.
-    UpdateTip(pindexDelete->pprev, chainparams);
-    // Let wallets know transactions went from 1-confirmed to
-    // 0-confirmed or conflicted:
-    GetMainSignals().BlockDisconnected(pblock);
+        for (size_t i = 0; i < vpindex.size(); i++) {
+            const std::shared_ptr<const CBlock>& pblock = vdata[i].pblock;
+            if (disconnectpool) {
+                // Save transactions to re-add to mempool at end of reorg
+                for (auto it = pblock->vtx.rbegin(); it != pblock->vtx.rend(); ++it) {
+                    disconnectpool->addTransaction(*it);
+                }
+                while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
+                    // Drop the earliest entry, and remove its children from the mempool.
+                    auto it = disconnectpool->queuedTx.get<insertion_order>().begin();
+                    mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
+                    disconnectpool->removeEntry(it);
+                }
+            }
+
+            // Update chainActive and related variables.
+            UpdateTip(vpindex[i]->pprev, chainparams);
+            // Let wallets know transactions went from 1-confirmed to
+            // 0-confirmed or conflicted:
+            GetMainSignals().BlockDisconnected(pblock);
+        }
+    }
     return true;
 }
 
+/** Disconnect chainActive's tip. See DisconnectTips(). */
+bool static DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions *disconnectpool)
+{
+    assert(chainActive.Tip());
+    return DisconnectTips(state, chainparams, chainActive.Tip()->pprev, disconnectpool);
+}
+
 static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
@@ -2241,10 +2767,11 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
+    BlockConnectTimes times = {};
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
         CCoinsViewCache view(pcoinsTip);
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, GetTrackedCoinsStats(view.GetBestBlock()), &times);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -2273,6 +2800,18 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
 
+    times.hash = pindexNew->GetBlockHash();
+    times.nHeight = pindexNew->nHeight;
+    times.nTimeRead = nTime2 - nTime1;
+    times.nTimeFlush = nTime4 - nTime3;
+    times.nTimeChainState = nTime5 - nTime4;
+    times.nTimeTotal = nTime6 - nTime1;
+    connectTimesLog.Add(times);
+
+    // Whoever learns about the new tip is likely to ask for it.
+    if (!IsInitialBlockDownload())
+        blockCache.Insert(pthisBlock);
+
     connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
     return true;
 }
@@ -2360,8 +2899,8 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
-    while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(state, chainparams, &disconnectpool)) {
+    if (chainActive.Tip() && chainActive.Tip() != pindexFork) {
+        if (!DisconnectTips(state, chainparams, pindexFork, &disconnectpool)) {
             // This is likely a fatal error, but keep the mempool consistent,
             // just in case. Only remove from the mempool in this case.
             UpdateMempoolForReorg(disconnectpool, false);
@@ -2476,6 +3015,9 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
         bool fInitialDownload;
         {
             LOCK(cs_main);
+            // Blocks that arrive while a snapshot is loaded are connected after it.
+            if (fLoadingSnapshot)
+                return true;
             ConnectTrace connectTrace(mempool); // Destructed before cs_main is unlocked
 
             CBlockIndex *pindexOldTip = chainActive.Tip();
@@ -2562,6 +3104,8 @@ bool PreciousBlock(CValidationState& state, const CChainParams& params, CBlockIn
 bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, CBlockIndex *pindex)
 {
     AssertLockHeld(cs_main);
+    if (fLoadingSnapshot)
+        return state.Error("a UTXO snapshot is being loaded");
 
     // We first disconnect backwards and then mark the blocks as invalid.
     // This prevents a case where pruned nodes may fail to invalidateblock
@@ -2653,17 +3197,15 @@ bool ResetBlockFailureFlags(CBlockIndex *pindex) {
     return true;
 }
 
-static CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+static CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Insert(CBlockIndex(block));
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -2737,6 +3279,12 @@ static bool ReceivedBlockTransactions(const CBlock &block, CValidationState& sta
     return true;
 }
 
+/** Size block files are filled up to. Pruning frees space a file at a time, so it gets smaller files. */
+static unsigned int GetMaxBlockFileSize()
+{
+    return fPruneMode ? PRUNE_BLOCKFILE_SIZE : MAX_BLOCKFILE_SIZE;
+}
+
 static bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown = false)
 {
     LOCK(cs_LastBlockFile);
@@ -2747,7 +3295,7 @@ static bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned i
     }
 
     if (!fKnown) {
-        while (vinfoBlockFile[nFile].nSize + nAddSize >= MAX_BLOCKFILE_SIZE) {
+        while (vinfoBlockFile[nFile].nSize + nAddSize >= GetMaxBlockFileSize()) {
             nFile++;
             if (vinfoBlockFile.size() <= nFile) {
                 vinfoBlockFile.resize(nFile + 1);
@@ -2760,8 +3308,10 @@ static bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned i
     if ((int)nFile != nLastBlockFile) {
         if (!fKnown) {
             LogPrintf("Leaving block file %i: %s\n", nLastBlockFile, vinfoBlockFile[nLastBlockFile].ToString());
+            FinalizeBlockFile(nLastBlockFile);
         }
-        FlushBlockFile(!fKnown);
+        // The sync happens in the background; FlushStateToDisk waits for it.
+        blockFileFlusher.Commit(nLastBlockFile);
         nLastBlockFile = nFile;
     }
 
@@ -2772,22 +3322,23 @@ static bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned i
         vinfoBlockFile[nFile].nSize += nAddSize;
 
     if (!fKnown) {
-        unsigned int nOldChunks = (pos.nPos + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
-        unsigned int nNewChunks = (vinfoBlockFile[nFile].nSize + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
-        if (nNewChunks > nOldChunks) {
+        // A new file is preallocated in a single extent of the size it will be filled up to.
+        if (pos.nPos == 0) {
+            const unsigned int nFileSize = GetMaxBlockFileSize();
             if (fPruneMode)
                 fCheckForPruning = true;
-            if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos)) {
+            if (CheckDiskSpace(nFileSize)) {
                 FILE *file = OpenBlockFile(pos);
                 if (file) {
-                    LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nNewChunks * BLOCKFILE_CHUNK_SIZE, pos.nFile);
-                    AllocateFileRange(file, pos.nPos, nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos);
+                    LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nFileSize, pos.nFile);
+                    AllocateFileRange(file, 0, nFileSize);
                     fclose(file);
                 }
             }
             else
                 return state.Error("out of disk space");
         }
+        blockFileFlusher.SetDirty(nFile);
     }
 
     setDirtyFileInfo.insert(nFile);
@@ -2804,6 +3355,7 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     pos.nPos = vinfoBlockFile[nFile].nUndoSize;
     nNewSize = vinfoBlockFile[nFile].nUndoSize += nAddSize;
     setDirtyFileInfo.insert(nFile);
+    blockFileFlusher.SetDirty(nFile);
 
     unsigned int nOldChunks = (pos.nPos + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     unsigned int nNewChunks = (nNewSize + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
@@ -3135,11 +3687,14 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+/**
+ * Add a header to the block index. hash is the header's hash; fCheckedPoW
+ * tells that its proof of work has been found valid already.
+ */
+static bool AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, bool fCheckedPoW, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -3154,7 +3709,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!fCheckedPoW && !CheckBlockHeader(block, state, chainparams.GetConsensus()))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3167,7 +3722,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return state.DoS(100, error("%s: prev block invalid", __func__), REJECT_INVALID, "bad-prevblk");
         if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev, GetAdjustedTime()))
 			return state.Invalid(error("%s: Consensus::ContextualCheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state)), 0, "metronome-violation");
-		if (!CheckBlockRestWindowCompliance(pindexPrev->nHeight + 1, block.GetHash(), block.GetMetronomeHash(), pindexPrev->hashMetronome, chainparams))
+		if (!CheckBlockRestWindowCompliance(pindexPrev->nHeight + 1, hash, block.GetMetronomeHash(), pindexPrev->hashMetronome, chainparams))
 			return state.Invalid(error("%s: Consensus::CheckBlockRestWindowCompliance: %s, %s", __func__, hash.ToString(), block.GetMetronomeHash().GetHex()), 0, "metronome-violation");
 
         if (!pindexPrev->IsValid(BLOCK_VALID_SCRIPTS)) {
@@ -3186,7 +3741,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3196,15 +3751,86 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
     return true;
 }
 
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+{
+    return AcceptBlockHeader(block, block.GetHash(), false, state, chainparams, ppindex);
+}
+
+/** A header hashed and checked ahead of AcceptBlockHeader(). */
+struct PrevalidatedHeader
+{
+    uint256 hash;
+    bool fValidPoW;
+    bool fPrefetchBeat;
+};
+
+/**
+ * Hash the headers and check their proof of work on up to -par threads, and
+ * have the metronome beats at hand for the rest window checks of those that
+ * can be linked into the block index: new headers with valid proof of work
+ * whose parent is known or comes earlier in the batch. Holds cs_main only to
+ * pick those.
+ */
+static std::vector<PrevalidatedHeader> PrevalidateHeaders(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
+{
+    std::vector<PrevalidatedHeader> vResult(headers.size());
+    const size_t nThreads = std::min<size_t>(headers.size(), nScriptCheckThreads);
+    RunInParallel(nThreads, [&](size_t nStart, size_t nStep) {
+        for (size_t i = nStart; i < headers.size(); i += nStep) {
+            vResult[i].hash = headers[i].GetHash();
+            vResult[i].fValidPoW = CheckProofOfWork(vResult[i].hash, headers[i].nBits, consensusParams);
+        }
+    });
+
+    // Fetching a beat costs an RPC, so don't do it for headers that are
+    // already known or that could not be connected anyway.
+    bool fAnyPrefetch = false;
+    {
+        LOCK(cs_main);
+        std::unordered_set<uint256, BlockHasher> setLinkable;
+        for (size_t i = 0; i < headers.size(); i++) {
+            const uint256& hash = vResult[i].hash;
+            const bool fLinkable = vResult[i].fValidPoW &&
+                (mapBlockIndex.count(headers[i].hashPrevBlock) || setLinkable.count(headers[i].hashPrevBlock));
+            vResult[i].fPrefetchBeat = fLinkable && !mapBlockIndex.count(hash) && !headers[i].hashMetronome.IsNull();
+            fAnyPrefetch |= vResult[i].fPrefetchBeat;
+            if (fLinkable || mapBlockIndex.count(hash)) {
+                setLinkable.insert(hash);
+            }
+        }
+    }
+    if (!fAnyPrefetch) {
+        return vResult;
+    }
+
+    RunInParallel(nThreads, [&](size_t nStart, size_t nStep) {
+        for (size_t i = nStart; i < headers.size(); i += nStep) {
+            if (!vResult[i].fPrefetchBeat) {
+                continue;
+            }
+            // Only a prefetch: a beat that can't be fetched now is fetched
+            // again, and failures reported, by the rest window check.
+            try {
+                Metronome::CMetronomeHelper::GetMetronomeBeat(headers[i].hashMetronome);
+            } catch (const std::exception&) {
+            }
+        }
+    });
+    return vResult;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+    // Only linking the headers into the block index needs cs_main.
+    const std::vector<PrevalidatedHeader> vPrevalidated = PrevalidateHeaders(headers, chainparams.GetConsensus());
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(header, vPrevalidated[i].hash, vPrevalidated[i].fValidPoW, state, chainparams, &pindex)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -3298,7 +3924,14 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
 
     // Write block to history file
     try {
-        unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        unsigned int nBlockSize;
+        bool fCompact;
+        if (dbp == nullptr) {
+            nBlockSize = GetBlockRecordSize(block);
+        } else if (!ReadBlockRecordHeader(*dbp, chainparams.MessageStart(), nBlockSize, fCompact)) {
+            // Blocks are only stored compactly when that is smaller.
+            nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        }
         CDiskBlockPos blockPos;
         if (dbp != nullptr)
             blockPos = *dbp;
@@ -3424,6 +4057,7 @@ void PruneOneBlockFile(const int fileNumber)
 
     vinfoBlockFile[fileNumber].SetNull();
     setDirtyFileInfo.insert(fileNumber);
+    blockFileFlusher.Forget(fileNumber);
 }
 
 
@@ -3431,6 +4065,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        mappedBlockFiles.Erase(*it);
         fs::remove(GetBlockPosFilename(pos, "blk"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3497,7 +4132,7 @@ static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfte
     // We don't check to prune until after we've allocated new space for files
     // So we should leave a buffer under our target to account for another allocation
     // before the next pruning.
-    uint64_t nBuffer = BLOCKFILE_CHUNK_SIZE + UNDOFILE_CHUNK_SIZE;
+    uint64_t nBuffer = PRUNE_BLOCKFILE_SIZE + UNDOFILE_CHUNK_SIZE;
     uint64_t nBytesToPrune;
     int count=0;
 
@@ -3588,9 +4223,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error(std::string(__func__) + ": new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Insert(CBlockIndex());
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -3691,9 +4324,11 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadReindexing(fReindexing);
     fReindex |= fReindexing;
 
-    // Check whether we have a transaction index
-    pblocktree->ReadFlag("txindex", fTxIndex);
-    LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
+    // The transaction index used to be kept in this database
+    bool fLegacyTxIndex = false;
+    pblocktree->ReadFlag("txindex", fLegacyTxIndex);
+    if (fLegacyTxIndex)
+        LogPrintf("%s: ignoring transaction index entries in the block index database, -txindex is now kept in indexes/txindex and erases them once built\n", __func__);
 
     return true;
 }
@@ -3727,6 +4362,228 @@ bool LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+bool LoadCoinsStats()
+{
+    if (!fUTXOStats) return true;
+
+    LOCK(cs_main);
+    // Make sure the coins database is the whole story before reading or scanning it.
+    CValidationState state;
+    if (!FlushStateToDisk(Params(), state, FLUSH_STATE_ALWAYS)) {
+        return false;
+    }
+    const uint256 hashBestBlock = pcoinsdbview->GetBestBlock();
+    CIncrementalCoinsStats stats;
+    if (pcoinsdbview->ReadCoinsStats(stats) && stats.hashBlock == hashBestBlock) {
+        coinsStats = stats;
+        LogPrintf("%s: UTXO set statistics loaded at %s\n", __func__, hashBestBlock.ToString());
+        return true;
+    }
+
+    LogPrintf("%s: UTXO set statistics missing or stale, recomputing...\n", __func__);
+    int64_t nStart = GetTimeMillis();
+    if (!ComputeCoinsStats(pcoinsdbview, stats, GetNumCores())) {
+        return false;
+    }
+    coinsStats = stats;
+    if (!pcoinsdbview->WriteCoinsStats(coinsStats)) {
+        return error("%s: failed to write UTXO set statistics", __func__);
+    }
+    LogPrintf("%s: UTXO set statistics computed at %s (%u coins) in %dms\n", __func__, hashBestBlock.ToString(), coinsStats.nTransactionOutputs, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool GetIncrementalCoinsStats(CIncrementalCoinsStats& stats)
+{
+    LOCK(cs_main);
+    const CIncrementalCoinsStats* pstats = GetTrackedCoinsStats(pcoinsTip->GetBestBlock());
+    if (!pstats) return false;
+    stats = *pstats;
+    return true;
+}
+
+/**
+ * Give up on a snapshot load that has started changing the coins database.
+ * The database is left empty and no longer marked as in transition, the
+ * state -reindex-chainstate starts from. fLoadingSnapshot stays set so that
+ * the old tip is not flushed over it on shutdown.
+ */
+static bool AbortSnapshotLoad(const uint256& hashBaseBlock, const std::string& strMessage)
+{
+    if (pcoinsdbview->EraseAllCoins(hashBaseBlock) < 0 || !pcoinsdbview->EraseHeadBlocks())
+        LogPrintf("%s: failed to reset the coins database\n", __func__);
+    return AbortNode(strMessage);
+}
+
+bool LoadUTXOSnapshot(const CChainParams& chainparams, CAutoFile& file, const SnapshotMetadata& metadata, std::string& strError)
+{
+    const CBlockIndex* pindexOldTip;
+    CBlockIndex* pindexBase;
+    {
+        LOCK(cs_main);
+        if (fLoadingSnapshot) {
+            strError = "a snapshot is already being loaded";
+            return false;
+        }
+
+        BlockMap::iterator mi = mapBlockIndex.find(metadata.hashBaseBlock);
+        if (mi == mapBlockIndex.end()) {
+            strError = "snapshot base block header is not known (wait for header sync)";
+            return false;
+        }
+        pindexBase = mi->second;
+        if (!pindexBase->IsValid(BLOCK_VALID_TREE) || (pindexBase->nStatus & BLOCK_FAILED_MASK)) {
+            strError = "snapshot base block is invalid";
+            return false;
+        }
+        pindexOldTip = chainActive.Tip();
+        if (pindexOldTip == nullptr || pindexOldTip == pindexBase || pindexBase->GetAncestor(pindexOldTip->nHeight) != pindexOldTip) {
+            strError = "snapshot base block must descend from the active chain tip";
+            return false;
+        }
+        // Blocks below the snapshot are never downloaded, which only a pruned
+        // node can cope with (this also rules out -txindex).
+        if (!fPruneMode) {
+            strError = "loading a snapshot requires -prune";
+            return false;
+        }
+
+        // Start from an empty coins database: flush so the cache layer is empty,
+        // then wipe the coins of the old tip. Until the snapshot is in place the
+        // tip is kept where it is, and whatever is read through pcoinsTip
+        // meanwhile comes from the snapshot.
+        CValidationState state;
+        if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS)) {
+            strError = FormatStateMessage(state);
+            return false;
+        }
+        mempool.clear();
+        fLoadingSnapshot = true;
+        LogPrintf("Loading UTXO snapshot at %s (%u coins)\n", metadata.hashBaseBlock.ToString(), metadata.nCoins);
+        if (pcoinsdbview->EraseAllCoins(metadata.hashBaseBlock) < 0) {
+            return AbortSnapshotLoad(metadata.hashBaseBlock, "Failed to wipe the coins database for snapshot loading; restart with -reindex-chainstate");
+        }
+    }
+
+    // The coins are written without cs_main, so the node keeps serving peers
+    // and RPC while they load.
+    int64_t nStart = GetTimeMicros();
+    // Coins are stored in database key order in the snapshot, so each batch
+    // is a sorted run that LevelDB can write with minimal compaction work.
+    std::vector<std::pair<COutPoint, Coin>> vBatch;
+    size_t nBatchBytes = 0;
+    uint64_t nLoaded = 0;
+    uint256 txid;
+    std::map<uint32_t, Coin> outputs;
+    CIncrementalCoinsStats stats;
+    try {
+        while (nLoaded < metadata.nCoins) {
+            ReadUTXOSnapshotTx(file, txid, outputs);
+            for (auto& output : outputs) {
+                if (fUTXOStats) stats.AddCoin(COutPoint(txid, output.first), output.second);
+                nBatchBytes += sizeof(COutPoint) + sizeof(Coin) + output.second.out.scriptPubKey.size();
+                vBatch.emplace_back(COutPoint(txid, output.first), std::move(output.second));
+                nLoaded++;
+            }
+            if (nBatchBytes >= SNAPSHOT_LOAD_BATCH_SIZE) {
+                if (!pcoinsdbview->WriteCoinsBatch(vBatch, metadata.hashBaseBlock)) {
+                    return AbortSnapshotLoad(metadata.hashBaseBlock, "Failed to write snapshot coins to the coins database; restart with -reindex-chainstate");
+                }
+                LogPrintf("Loaded %u/%u snapshot coins\n", nLoaded, metadata.nCoins);
+                vBatch.clear();
+                nBatchBytes = 0;
+            }
+        }
+    } catch (const std::exception& e) {
+        return AbortSnapshotLoad(metadata.hashBaseBlock, strprintf("Failed to read UTXO snapshot: %s; restart with -reindex-chainstate", e.what()));
+    }
+    if (!pcoinsdbview->WriteCoinsBatch(vBatch, metadata.hashBaseBlock) || !pcoinsdbview->WriteBestBlock(metadata.hashBaseBlock)) {
+        return AbortSnapshotLoad(metadata.hashBaseBlock, "Failed to write snapshot coins to the coins database; restart with -reindex-chainstate");
+    }
+    LogPrintf("Loaded %u snapshot coins in %.2fs\n", nLoaded, (GetTimeMicros() - nStart) * 0.000001);
+
+    {
+        LOCK(cs_main);
+        fLoadingSnapshot = false;
+        // Transactions accepted meanwhile were checked against the old tip.
+        mempool.clear();
+        pcoinsTip->SetBestBlock(metadata.hashBaseBlock);
+        stats.hashBlock = metadata.hashBaseBlock;
+        coinsStats = stats;
+
+        // Link the blocks between the old tip and the snapshot base. Blocks we
+        // never received are assumed to hold one transaction (the base block makes
+        // up the difference to the snapshot's nChainTx), and their validity is
+        // taken from the snapshot, like blocks below an assumed-valid hash.
+        std::vector<CBlockIndex*> vPath;
+        for (CBlockIndex* pindex = pindexBase; pindex != pindexOldTip; pindex = pindex->pprev) {
+            vPath.push_back(pindex);
+        }
+        bool fMissingData = false;
+        for (CBlockIndex* pindex : reverse_iterate(vPath)) {
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                fMissingData = true;
+                if (pindex == pindexBase && metadata.nChainTx > pindex->pprev->nChainTx) {
+                    pindex->nTx = metadata.nChainTx - pindex->pprev->nChainTx;
+                } else if (pindex->nTx == 0) {
+                    pindex->nTx = 1;
+                }
+            }
+            pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
+            if (IsWitnessEnabled(pindex->pprev, chainparams.GetConsensus())) {
+                pindex->nStatus |= BLOCK_OPT_WITNESS;
+            }
+            pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+            setDirtyBlockIndex.insert(pindex);
+        }
+
+        // Blocks that were waiting for any of these to be linked can be linked now.
+        std::deque<CBlockIndex*> queue(vPath.begin(), vPath.end());
+        while (!queue.empty()) {
+            CBlockIndex* pindex = queue.front();
+            queue.pop_front();
+            std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex);
+            while (range.first != range.second) {
+                CBlockIndex* pindexChild = range.first->second;
+                if (pindexChild->nChainTx == 0) {
+                    pindexChild->nChainTx = pindex->nChainTx + pindexChild->nTx;
+                    queue.push_back(pindexChild);
+                    if (!setBlockIndexCandidates.value_comp()(pindexChild, pindexBase)) {
+                        setBlockIndexCandidates.insert(pindexChild);
+                    }
+                }
+                range.first = mapBlocksUnlinked.erase(range.first);
+            }
+        }
+
+        if (fMissingData && !fHavePruned) {
+            pblocktree->WriteFlag("prunedblockfiles", true);
+            fHavePruned = true;
+        }
+        setBlockIndexCandidates.insert(pindexBase);
+        UpdateTip(pindexBase, chainparams);
+        PruneBlockIndexCandidates();
+        CheckBlockIndex(chainparams.GetConsensus());
+
+        CValidationState state;
+        if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS)) {
+            strError = FormatStateMessage(state);
+            return false;
+        }
+    }
+
+    GetMainSignals().UpdatedBlockTip(pindexBase, pindexOldTip, IsInitialBlockDownload());
+    uiInterface.NotifyBlockTip(IsInitialBlockDownload(), pindexBase);
+
+    // Connect any blocks we already have on top of the snapshot.
+    CValidationState state;
+    if (!ActivateBestChain(state, chainparams)) {
+        strError = FormatStateMessage(state);
+        return false;
+    }
+    return true;
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0);
@@ -3737,100 +4594,293 @@ CVerifyDB::~CVerifyDB()
     uiInterface.ShowProgress("", 100);
 }
 
-bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
-{
-    LOCK(cs_main);
-    if (chainActive.Tip() == nullptr || chainActive.Tip()->pprev == nullptr)
-        return true;
+namespace {
 
-    // Verify blocks in the best chain
-    if (nCheckDepth <= 0 || nCheckDepth > chainActive.Height())
-        nCheckDepth = chainActive.Height();
-    nCheckLevel = std::max(0, std::min(4, nCheckLevel));
-    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
-    CCoinsViewCache coins(coinsview);
-    CBlockIndex* pindexState = chainActive.Tip();
-    CBlockIndex* pindexFailure = nullptr;
-    int nGoodTransactions = 0;
-    CValidationState state;
-    int reportDone = 0;
-    LogPrintf("[0%%]...");
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
-    {
-        boost::this_thread::interruption_point();
-        int percentageDone = std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
-        if (reportDone < percentageDone/10) {
-            // report every 10% step
-            LogPrintf("[%d%%]...", percentageDone);
-            reportDone = percentageDone/10;
-        }
-        uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
-        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
+enum class VerifyResult { OK, FAILED, INTERRUPTED, TIP_CHANGED };
+
+/** The last nCheckDepth blocks of the best chain that have data, tip first */
+std::vector<const CBlockIndex*> GetBlocksToVerify(int nCheckDepth)
+{
+    AssertLockHeld(cs_main);
+    std::vector<const CBlockIndex*> vpindex;
+    for (const CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
+        if (pindex->nHeight < chainActive.Height() - nCheckDepth)
             break;
         if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
             // If pruning, only go back as far as we have data.
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
         }
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
-            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus()))
-            return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
-                         pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            CDiskBlockPos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+        vpindex.push_back(pindex);
+    }
+    return vpindex;
+}
+
+/**
+ * Check levels 0 to 2 on -par threads: read each block from disk, run
+ * CheckBlock() on it and read its undo data. These need no chain state, so
+ * blocks are checked in any order.
+ */
+VerifyResult VerifyBlockData(const CChainParams& chainparams, const std::vector<const CBlockIndex*>& vpindex, int nCheckLevel)
+{
+    std::atomic<size_t> nNext(0);
+    std::atomic<size_t> nDone(0);
+    std::atomic<bool> fFailed(false);
+    auto verify = [&](bool fReport) {
+        int reportDone = 0;
+        size_t i;
+        while (!fFailed && !ShutdownRequested() && (i = nNext++) < vpindex.size()) {
+            const CBlockIndex* pindex = vpindex[i];
+            CBlock block;
+            CValidationState state;
+            // check level 0: read from disk
+            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+                error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+                fFailed = true;
+                break;
             }
-        }
-        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = DisconnectBlock(block, pindex, coins);
-            if (res == DISCONNECT_FAILED) {
-                return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            // check level 1: verify block validity
+            if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus())) {
+                error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
+                      pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+                fFailed = true;
+                break;
             }
-            pindexState = pindex->pprev;
-            if (res == DISCONNECT_UNCLEAN) {
-                nGoodTransactions = 0;
-                pindexFailure = pindex;
-            } else {
-                nGoodTransactions += block.vtx.size();
+            // check level 2: verify undo validity
+            if (nCheckLevel >= 2) {
+                CBlockUndo undo;
+                CDiskBlockPos pos = pindex->GetUndoPos();
+                if (!pos.IsNull() && !UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash())) {
+                    error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                    fFailed = true;
+                    break;
+                }
+            }
+            nDone++;
+            if (fReport) {
+                int percentageDone = std::max(1, std::min(99, (int)(nDone * (nCheckLevel >= 3 ? 50 : 100) / vpindex.size())));
+                if (reportDone < percentageDone/10) {
+                    // report every 10% step
+                    LogPrintf("[%d%%]...", percentageDone);
+                    reportDone = percentageDone/10;
+                }
+                uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
             }
         }
-        if (ShutdownRequested())
-            return true;
+    };
+
+    // This thread verifies blocks too, and reports progress.
+    RunInParallel(std::min<size_t>(vpindex.size(), nScriptCheckThreads), [&](size_t nStart, size_t) {
+        verify(nStart == 0);
+    });
+    if (fFailed)
+        return VerifyResult::FAILED;
+    return nDone == vpindex.size() ? VerifyResult::OK : VerifyResult::INTERRUPTED;
+}
+
+/**
+ * Check levels 3 and 4: disconnect the last nCheckDepth blocks from a memory
+ * only view on top of coinsview, checking for inconsistencies, and at level 4
+ * connect them again. cs_main is taken for one block at a time, so when the
+ * caller does not hold it the node keeps running, and the check gives up with
+ * TIP_CHANGED as soon as the tip it started from is no longer the tip, or a
+ * snapshot is being loaded into the coins database.
+ */
+VerifyResult VerifyCoinsDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth,
+                           const std::function<bool()>& interrupt, const std::function<void(int, int)>& progress)
+{
+    CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+        if (pindexTip == nullptr || pindexTip->pprev == nullptr)
+            return VerifyResult::OK;
+    }
+    if (nCheckDepth <= 0 || nCheckDepth > pindexTip->nHeight)
+        nCheckDepth = pindexTip->nHeight;
+    CCoinsViewCache coins(coinsview);
+    CBlockIndex* pindexState = pindexTip;
+    CBlockIndex* pindexFailure = nullptr;
+    int nGoodTransactions = 0;
+    CValidationState state;
+
+    // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
+    while (pindexState->pprev && pindexState->nHeight >= pindexTip->nHeight - nCheckDepth) {
+        if (interrupt())
+            return VerifyResult::INTERRUPTED;
+        LOCK(cs_main);
+        if (chainActive.Tip() != pindexTip || fLoadingSnapshot)
+            return VerifyResult::TIP_CHANGED;
+        CBlockIndex* pindex = pindexState;
+        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA))
+            break;
+        if (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage() > nCoinCacheUsage)
+            break;
+        progress(pindex->nHeight, nCheckLevel >= 4 ? 50 + (pindexTip->nHeight - pindex->nHeight) * 25 / nCheckDepth
+                                                  : 50 + (pindexTip->nHeight - pindex->nHeight) * 50 / nCheckDepth);
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+            error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            return VerifyResult::FAILED;
+        }
+        assert(coins.GetBestBlock() == pindex->GetBlockHash());
+        DisconnectResult res = DisconnectBlock(block, pindex, coins);
+        if (res == DISCONNECT_FAILED) {
+            error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            return VerifyResult::FAILED;
+        }
+        pindexState = pindex->pprev;
+        if (res == DISCONNECT_UNCLEAN) {
+            nGoodTransactions = 0;
+            pindexFailure = pindex;
+        } else {
+            nGoodTransactions += block.vtx.size();
+        }
+    }
+    if (pindexFailure) {
+        error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", pindexTip->nHeight - pindexFailure->nHeight + 1, nGoodTransactions);
+        return VerifyResult::FAILED;
     }
-    if (pindexFailure)
-        return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", chainActive.Height() - pindexFailure->nHeight + 1, nGoodTransactions);
 
     // check level 4: try reconnecting blocks
     if (nCheckLevel >= 4) {
         CBlockIndex *pindex = pindexState;
-        while (pindex != chainActive.Tip()) {
-            boost::this_thread::interruption_point();
-            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * 50))));
+        while (pindex != pindexTip) {
+            if (interrupt())
+                return VerifyResult::INTERRUPTED;
+            LOCK(cs_main);
+            if (chainActive.Tip() != pindexTip || fLoadingSnapshot)
+                return VerifyResult::TIP_CHANGED;
+            progress(pindex->nHeight, 100 - (pindexTip->nHeight - pindex->nHeight) * 25 / nCheckDepth);
             pindex = chainActive.Next(pindex);
             CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
-                return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins, chainparams))
-                return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+                error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+                return VerifyResult::FAILED;
+            }
+            if (!ConnectBlock(block, state, pindex, coins, chainparams)) {
+                error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+                return VerifyResult::FAILED;
+            }
         }
     }
 
-    LogPrintf("[DONE].\n");
-    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", chainActive.Height() - pindexState->nHeight, nGoodTransactions);
+    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", pindexTip->nHeight - pindexState->nHeight, nGoodTransactions);
+    return VerifyResult::OK;
+}
+
+//! Times the background check starts over from a new tip before it gives up
+static const int MAX_BACKGROUND_VERIFY_RESTARTS = 10;
 
+std::mutex cs_backgroundVerify;
+VerifyDBProgress backgroundVerifyProgress;
+std::atomic<bool> fStopBackgroundVerify(false);
+std::thread threadBackgroundVerify;
+
+void ThreadBackgroundVerify(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth)
+{
+    auto interrupt = [] { return fStopBackgroundVerify || ShutdownRequested(); };
+    auto progress = [](int nHeight, int nPercentage) {
+        std::lock_guard<std::mutex> lock(cs_backgroundVerify);
+        backgroundVerifyProgress.nHeight = nHeight;
+        backgroundVerifyProgress.dProgress = nPercentage / 100.0;
+    };
+
+    VerifyResult result = VerifyResult::TIP_CHANGED;
+    int nRestarts = 0;
+    for (; result == VerifyResult::TIP_CHANGED && nRestarts <= MAX_BACKGROUND_VERIFY_RESTARTS; nRestarts++) {
+        if (nRestarts > 0) {
+            std::lock_guard<std::mutex> lock(cs_backgroundVerify);
+            backgroundVerifyProgress.nRestarts = nRestarts;
+        }
+        // The check reads through pcoinsTip, as the coins database itself is
+        // written to by the running node.
+        result = VerifyCoinsDB(chainparams, pcoinsTip, nCheckLevel, nCheckDepth, interrupt, progress);
+    }
+
+    std::string strStatus;
+    switch (result) {
+    case VerifyResult::OK:
+        strStatus = "ok";
+        break;
+    case VerifyResult::FAILED:
+        strStatus = "failed";
+        SetMiscWarning(_("Warning: Corrupted block database detected. Restart with -reindex-chainstate or -reindex to recover."));
+        uiInterface.NotifyAlertChanged();
+        break;
+    case VerifyResult::INTERRUPTED:
+        strStatus = "interrupted";
+        break;
+    case VerifyResult::TIP_CHANGED:
+        strStatus = "incomplete";
+        break;
+    }
+    LogPrintf("Background block verification at level %d: %s\n", nCheckLevel, strStatus);
+    std::lock_guard<std::mutex> lock(cs_backgroundVerify);
+    backgroundVerifyProgress.fRunning = false;
+    backgroundVerifyProgress.strStatus = strStatus;
+    if (result == VerifyResult::OK)
+        backgroundVerifyProgress.dProgress = 1.0;
+}
+
+} // namespace
+
+bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
+{
+    LOCK(cs_main);
+    if (chainActive.Tip() == nullptr || chainActive.Tip()->pprev == nullptr)
+        return true;
+
+    // Verify blocks in the best chain
+    if (nCheckDepth <= 0 || nCheckDepth > chainActive.Height())
+        nCheckDepth = chainActive.Height();
+    nCheckLevel = std::max(0, std::min(4, nCheckLevel));
+    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+    LogPrintf("[0%%]...");
+    VerifyResult result = VerifyBlockData(chainparams, GetBlocksToVerify(nCheckDepth), nCheckLevel);
+    if (result == VerifyResult::OK && nCheckLevel >= 3) {
+        auto progress = [](int nHeight, int nPercentage) {
+            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, nPercentage)));
+        };
+        result = VerifyCoinsDB(chainparams, coinsview, nCheckLevel, nCheckDepth, ShutdownRequested, progress);
+    }
+    if (result == VerifyResult::FAILED)
+        return false;
+    if (result == VerifyResult::OK)
+        LogPrintf("[DONE].\n");
     return true;
 }
 
+void StartBackgroundVerifyDB(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth)
+{
+    StopBackgroundVerifyDB();
+    {
+        std::lock_guard<std::mutex> lock(cs_backgroundVerify);
+        backgroundVerifyProgress = VerifyDBProgress();
+        backgroundVerifyProgress.fRunning = true;
+        backgroundVerifyProgress.nCheckLevel = nCheckLevel;
+        backgroundVerifyProgress.nCheckDepth = nCheckDepth;
+        backgroundVerifyProgress.strStatus = "running";
+    }
+    LogPrintf("Verifying last %i blocks at level %i in the background\n", nCheckDepth, nCheckLevel);
+    fStopBackgroundVerify = false;
+    threadBackgroundVerify = std::thread(&TraceThread<std::function<void()>>, "verifydb",
+                                         std::function<void()>(std::bind(&ThreadBackgroundVerify, std::cref(chainparams), nCheckLevel, nCheckDepth)));
+}
+
+void StopBackgroundVerifyDB()
+{
+    fStopBackgroundVerify = true;
+    if (threadBackgroundVerify.joinable())
+        threadBackgroundVerify.join();
+}
+
+VerifyDBProgress GetBackgroundVerifyDBProgress()
+{
+    std::lock_guard<std::mutex> lock(cs_backgroundVerify);
+    return backgroundVerifyProgress;
+}
+
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
 static bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params)
 {
@@ -4023,6 +5073,8 @@ void UnloadBlockIndex()
     mempool.clear();
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
+    // The mappings are by file number and may be of another data directory's files.
+    mappedBlockFiles.Clear();
     nLastBlockFile = 0;
     nBlockSequenceId = 1;
     setDirtyBlockIndex.clear();
@@ -4033,10 +5085,8 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
     fHavePruned = false;
 }
 
@@ -4058,9 +5108,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // needs_init.
 
         LogPrintf("Initializing databases...\n");
-        // Use the provided setting for -txindex in the new database
-        fTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
-        pblocktree->WriteFlag("txindex", fTxIndex);
     }
     return true;
 }
@@ -4079,14 +5126,14 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     try {
         CBlock &block = const_cast<CBlock&>(chainparams.GenesisBlock());
         // Start new block file
-        unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        unsigned int nBlockSize = GetBlockRecordSize(block);
         CDiskBlockPos blockPos;
         CValidationState state;
         if (!FindBlockPos(state, blockPos, nBlockSize+8, 0, block.GetBlockTime()))
             return error("%s: FindBlockPos failed", __func__);
         if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
             return error("%s: writing genesis block to disk failed", __func__);
-        CBlockIndex *pindex = AddToBlockIndex(block);
+        CBlockIndex *pindex = AddToBlockIndex(block, block.GetHash());
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos, chainparams.GetConsensus()))
             return error("%s: genesis block not accepted", __func__);
     } catch (const std::runtime_error& e) {
@@ -4096,24 +5143,254 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return true;
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
+namespace {
+
+//! Serialized size of the blocks read ahead of the one being accepted while importing
+static const uint64_t MAX_IMPORT_QUEUE_BYTES = 128 * 1024 * 1024;
+
+/**
+ * Decode the valid block records of a mapped block file in order, skipping
+ * anything in between, like the reindex scan does.
+ */
+static void ForEachBlockRecord(const CMappedFile& file, const CMessageHeader::MessageStartChars& messageStart,
+                               std::function<bool(const CBlock&, bool)> func)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+    size_t nPos = 0;
+    while (nPos + BLOCK_HEADER_SIZE <= file.size()) {
+        const unsigned char* pheader = file.data() + nPos;
+        if (memcmp(pheader, messageStart, CMessageHeader::MESSAGE_START_SIZE)) {
+            nPos++;
+            continue;
+        }
+        const uint32_t nHeaderSize = ReadLE32(pheader + CMessageHeader::MESSAGE_START_SIZE);
+        const bool fCompact = (nHeaderSize & BLOCK_COMPACT_FLAG) != 0;
+        const uint32_t nSize = nHeaderSize & ~BLOCK_COMPACT_FLAG;
+        if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE || nSize > file.size() - nPos - BLOCK_HEADER_SIZE) {
+            nPos++;
+            continue;
+        }
+        const std::vector<unsigned char> record(pheader + BLOCK_HEADER_SIZE, pheader + BLOCK_HEADER_SIZE + nSize);
+        CBlock block;
+        try {
+            CVectorReader reader(SER_DISK, CLIENT_VERSION, record, 0);
+            if (fCompact)
+                reader >> REF(CBlockCompressor(block));
+            else
+                reader >> block;
+        } catch (const std::exception&) {
+            nPos++;
+            continue;
+        }
+        if (!func(block, fCompact))
+            return;
+        nPos += BLOCK_HEADER_SIZE + nSize;
+    }
+}
+
+/**
+ * Store the blocks of our block file nFile the way -compressblocks asks for,
+ * if any of them is not. Runs before a reindex scans the file, so that the
+ * positions it records are those in the new file.
+ */
+static bool RewriteBlockFile(int nFile, const CMessageHeader::MessageStartChars& messageStart)
+{
+    const fs::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    std::shared_ptr<const CMappedFile> file = CMappedFile::Open(path);
+    if (!file)
+        return false;
+
+    bool fRewrite = false;
+    ForEachBlockRecord(*file, messageStart, [&](const CBlock& block, bool fStoredCompact) {
+        bool fCompact;
+        GetBlockRecordSize(block, fCompact);
+        fRewrite = fCompact != fStoredCompact;
+        return !fRewrite;
+    });
+    if (!fRewrite)
+        return true;
+
+    LogPrintf("Rewriting %s with -compressblocks=%d\n", path.filename().string(), fCompressBlocks);
+    const fs::path pathTmp = path.string() + ".new";
+    CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: Failed to create %s", __func__, pathTmp.string());
+    try {
+        ForEachBlockRecord(*file, messageStart, [&](const CBlock& block, bool fStoredCompact) {
+            bool fCompact;
+            const unsigned int nSize = GetBlockRecordSize(block, fCompact);
+            fileout << FLATDATA(messageStart) << (fCompact ? nSize | BLOCK_COMPACT_FLAG : nSize);
+            if (fCompact)
+                fileout << CBlockCompressor(REF(block));
+            else
+                fileout << block;
+            return true;
+        });
+    } catch (const std::exception& e) {
+        fileout.fclose();
+        fs::remove(pathTmp);
+        return error("%s: Write to %s failed - %s", __func__, pathTmp.string(), e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+    file.reset();
+    if (!RenameOver(pathTmp, path))
+        return error("%s: Rename of %s failed", __func__, pathTmp.string());
+    // Until the rename, a mapping of the old file still matches its name.
+    mappedBlockFiles.Erase(nFile);
+    return true;
+}
+
+/** A block read from a file being imported */
+struct ImportedBlock
+{
+    enum State { QUEUED, CHECKING, CHECKED };
+
+    std::shared_ptr<CBlock> pblock;
+    CDiskBlockPos pos;
+    unsigned int nSize;
+    State state;
+};
+
+/** A file being imported, with the blocks read from it that have not been accepted yet */
+struct ImportFile
+{
+    //! Taken over by the reader; nullptr to open our block file nFile
+    FILE* file;
+    //! Number of our own block file, or -1 for external files whose blocks are stored anew
+    int nFile;
+    std::deque<std::shared_ptr<ImportedBlock>> blocks;
+    bool fDone;
+    bool fAbandoned;
+
+    ImportFile(FILE* fileIn, int nFileIn) : file(fileIn), nFile(nFileIn), fDone(false), fAbandoned(false) {}
+};
+
+/**
+ * Imports block files as a pipeline. Reader threads scan and deserialize
+ * several files at once, checker threads run the context-free CheckBlock()
+ * and fetch the metronome beats blocks refer to, and Run() accepts the
+ * blocks in file order under cs_main. Blocks that arrive before their
+ * parent are remembered by position and accepted once it has been.
+ */
+class CBlockImporter
+{
+private:
+    const CChainParams& chainparams;
+    std::vector<ImportFile> vFiles;
+    const size_t nReaders;
+
+    std::mutex cs;
+    std::condition_variable condRead;
+    std::condition_variable condCheck;
+    std::condition_variable condAccept;
+    //! Next file for a reader to claim
+    size_t nNextFile;
+    //! File whose blocks Run() is accepting
+    size_t nAcceptFile;
+    uint64_t nBytesQueued;
+    std::deque<std::shared_ptr<ImportedBlock>> queueCheck;
+    bool fStop;
+
+    std::vector<std::thread> threads;
+
+    void ThreadRead();
+    void ThreadCheck();
+    void ReadFile(size_t nIndex);
+    bool Push(size_t nIndex, std::shared_ptr<ImportedBlock> entry);
+    void Check(CBlock& block);
+    bool Accept(const ImportedBlock& entry, int& nLoaded);
+
+public:
+    CBlockImporter(const CChainParams& chainparamsIn, std::vector<ImportFile> vFilesIn, int nThreads);
+    ~CBlockImporter();
+
+    /** Import all files in order. Returns the number of blocks loaded. */
+    int Run();
+};
+
+//! Disk positions for blocks with unknown parent (only used for reindex)
+std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+
+CBlockImporter::CBlockImporter(const CChainParams& chainparamsIn, std::vector<ImportFile> vFilesIn, int nThreads) :
+    chainparams(chainparamsIn), vFiles(std::move(vFilesIn)), nReaders(std::max<size_t>(1, std::min<size_t>(nThreads, vFiles.size()))),
+    nNextFile(0), nAcceptFile(0), nBytesQueued(0), fStop(false)
+{
+    for (size_t i = 0; i < nReaders; i++) {
+        threads.emplace_back(&TraceThread<std::function<void()>>, "loadblk-read",
+                             std::function<void()>(std::bind(&CBlockImporter::ThreadRead, this)));
+    }
+    for (int i = 0; i < std::max(1, nThreads); i++) {
+        threads.emplace_back(&TraceThread<std::function<void()>>, "loadblk-check",
+                             std::function<void()>(std::bind(&CBlockImporter::ThreadCheck, this)));
+    }
+}
+
+CBlockImporter::~CBlockImporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+    }
+    condRead.notify_all();
+    condCheck.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (ImportFile& file : vFiles) {
+        if (file.file)
+            fclose(file.file);
+    }
+}
+
+void CBlockImporter::ThreadRead()
+{
+    while (true) {
+        size_t nIndex;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            // Only read ahead as many files as there are readers.
+            condRead.wait(lock, [&] { return fStop || nNextFile >= vFiles.size() || nNextFile < nAcceptFile + nReaders; });
+            if (fStop || nNextFile >= vFiles.size())
+                return;
+            nIndex = nNextFile++;
+        }
+        ReadFile(nIndex);
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            vFiles[nIndex].fDone = true;
+        }
+        condAccept.notify_all();
+    }
+}
+
+void CBlockImporter::ReadFile(size_t nIndex)
+{
+    FILE* fileIn;
+    int nFile;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fileIn = vFiles[nIndex].file;
+        vFiles[nIndex].file = nullptr;
+        nFile = vFiles[nIndex].nFile;
+    }
+    if (!fileIn && nFile >= 0) {
+        if (!RewriteBlockFile(nFile, chainparams.MessageStart()))
+            LogPrintf("%s: Could not store blk%05u.dat with -compressblocks=%d, reading it as it is\n", __func__, nFile, fCompressBlocks);
+        fileIn = OpenBlockFile(CDiskBlockPos(nFile, 0), true);
+    }
+    if (!fileIn)
+        return; // This error is logged in OpenBlockFile
 
-    int nLoaded = 0;
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
         while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
             unsigned int nSize = 0;
+            bool fCompact = false;
             try {
                 // locate a header
                 unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
@@ -4124,6 +5401,8 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                     continue;
                 // read size
                 blkdat >> nSize;
+                fCompact = (nSize & BLOCK_COMPACT_FLAG) != 0;
+                nSize &= ~BLOCK_COMPACT_FLAG;
                 if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
                     continue;
             } catch (const std::exception&) {
@@ -4133,84 +5412,241 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
             try {
                 // read block
                 uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
                 blkdat.SetLimit(nBlockPos + nSize);
                 blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
+                std::shared_ptr<ImportedBlock> entry = std::make_shared<ImportedBlock>();
+                entry->pblock = std::make_shared<CBlock>();
+                if (fCompact)
+                    blkdat >> REF(CBlockCompressor(*entry->pblock));
+                else
+                    blkdat >> *entry->pblock;
                 nRewind = blkdat.GetPos();
+                entry->pos = CDiskBlockPos(nFile, nBlockPos);
+                entry->nSize = nSize;
+                entry->state = ImportedBlock::QUEUED;
+                if (!Push(nIndex, std::move(entry)))
+                    return;
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        AbortNode(std::string("System error: ") + e.what());
+    }
+}
 
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
+bool CBlockImporter::Push(size_t nIndex, std::shared_ptr<ImportedBlock> entry)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        ImportFile& file = vFiles[nIndex];
+        // The file being accepted may always hand over its next block, so
+        // that files read ahead cannot hold it up.
+        condRead.wait(lock, [&] {
+            return fStop || file.fAbandoned || nBytesQueued < MAX_IMPORT_QUEUE_BYTES ||
+                   (nIndex == nAcceptFile && file.blocks.empty());
+        });
+        if (fStop || file.fAbandoned)
+            return false;
+        nBytesQueued += entry->nSize;
+        file.blocks.push_back(entry);
+        queueCheck.push_back(std::move(entry));
+    }
+    condCheck.notify_one();
+    condAccept.notify_all();
+    return true;
+}
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
-                    CValidationState state;
-                    if (AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
+void CBlockImporter::ThreadCheck()
+{
+    while (true) {
+        std::shared_ptr<ImportedBlock> entry;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            condCheck.wait(lock, [&] { return fStop || !queueCheck.empty(); });
+            if (fStop)
+                return;
+            entry = std::move(queueCheck.front());
+            queueCheck.pop_front();
+            // Run() checks blocks it gets to first itself.
+            if (entry->state != ImportedBlock::QUEUED)
+                continue;
+            entry->state = ImportedBlock::CHECKING;
+        }
+        Check(*entry->pblock);
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            entry->state = ImportedBlock::CHECKED;
+        }
+        condAccept.notify_all();
+    }
+}
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
-                    }
+void CBlockImporter::Check(CBlock& block)
+{
+    // A block that passes is marked as checked, so AcceptBlock() does not
+    // repeat the work; one that fails is checked again there and rejected.
+    CValidationState state;
+    CheckBlock(block, state, chainparams.GetConsensus());
+    // Have the beat at hand for the rest window check in AcceptBlock(). If
+    // it can't be fetched now, that check fetches it again and fails there.
+    if (!block.hashMetronome.IsNull()) {
+        try {
+            Metronome::CMetronomeHelper::GetMetronomeBeat(block.hashMetronome);
+        } catch (const std::exception&) {
+        }
+    }
+}
+
+int CBlockImporter::Run()
+{
+    int nLoadedTotal = 0;
+    for (size_t nIndex = 0; nIndex < vFiles.size(); nIndex++) {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            nAcceptFile = nIndex;
+        }
+        condRead.notify_all();
+
+        if (vFiles[nIndex].nFile >= 0) {
+            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)vFiles[nIndex].nFile);
+        }
+        int64_t nStart = GetTimeMillis();
+        int nLoaded = 0;
+        bool fAbandoned = false;
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            std::shared_ptr<ImportedBlock> entry;
+            bool fCheck = false;
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                ImportFile& file = vFiles[nIndex];
+                condAccept.wait(lock, [&] { return !file.blocks.empty() || file.fDone; });
+                if (file.blocks.empty())
+                    break;
+                entry = std::move(file.blocks.front());
+                file.blocks.pop_front();
+                nBytesQueued -= entry->nSize;
+                if (entry->state == ImportedBlock::QUEUED) {
+                    entry->state = ImportedBlock::CHECKING;
+                    fCheck = true;
+                } else {
+                    condAccept.wait(lock, [&] { return entry->state == ImportedBlock::CHECKED; });
+                }
+            }
+            condRead.notify_all();
+            if (fAbandoned)
+                continue;
+            if (fCheck) {
+                Check(*entry->pblock);
+            }
+            if (!Accept(*entry, nLoaded)) {
+                // Skip the rest of the file, as a failure to process it would.
+                fAbandoned = true;
+                {
+                    std::lock_guard<std::mutex> lock(cs);
+                    vFiles[nIndex].fAbandoned = true;
                 }
+                condRead.notify_all();
+            }
+        }
+        if (nLoaded > 0)
+            LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        nLoadedTotal += nLoaded;
+    }
+    return nLoadedTotal;
+}
 
-                NotifyHeaderTip();
+bool CBlockImporter::Accept(const ImportedBlock& entry, int& nLoaded)
+{
+    const std::shared_ptr<CBlock>& pblock = entry.pblock;
+    const CBlock& block = *pblock;
+    const CDiskBlockPos* dbp = entry.pos.nFile >= 0 ? &entry.pos : nullptr;
+    try {
+        // detect out of order blocks, and store them for later
+        uint256 hash = block.GetHash();
+        if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                    block.hashPrevBlock.ToString());
+            if (dbp)
+                mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+            return true;
+        }
 
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
-                            {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
+        // process in case the block isn't known yet
+        if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+            LOCK(cs_main);
+            CValidationState state;
+            if (AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr))
+                nLoaded++;
+            if (state.IsError())
+                return false;
+        } else if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+            LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+        }
+
+        // Activate the genesis block so normal node progress can continue
+        if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+            CValidationState state;
+            if (!ActivateBestChain(state, chainparams)) {
+                return false;
+            }
+        }
+
+        NotifyHeaderTip();
+
+        // Recursively process earlier encountered successors of this block
+        std::deque<uint256> queue;
+        queue.push_back(hash);
+        while (!queue.empty()) {
+            uint256 head = queue.front();
+            queue.pop_front();
+            std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+            while (range.first != range.second) {
+                std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
+                {
+                    LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                            head.ToString());
+                    LOCK(cs_main);
+                    CValidationState dummy;
+                    if (AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                    {
+                        nLoaded++;
+                        queue.push_back(pblockrecursive->GetHash());
                     }
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+                range.first++;
+                mapBlocksUnknownParent.erase(it);
+                NotifyHeaderTip();
             }
         }
-    } catch (const std::runtime_error& e) {
-        AbortNode(std::string("System error: ") + e.what());
+    } catch (const std::exception& e) {
+        LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
     }
-    if (nLoaded > 0)
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
-    return nLoaded > 0;
+    return true;
+}
+
+} // namespace
+
+bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn)
+{
+    std::vector<ImportFile> vFiles;
+    vFiles.emplace_back(fileIn, -1);
+    CBlockImporter importer(chainparams, std::move(vFiles), nScriptCheckThreads);
+    return importer.Run() > 0;
+}
+
+bool ReindexBlockFiles(const CChainParams& chainparams)
+{
+    std::vector<ImportFile> vFiles;
+    for (int nFile = 0; fs::exists(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk")); nFile++) {
+        vFiles.emplace_back(nullptr, nFile);
+    }
+    CBlockImporter importer(chainparams, std::move(vFiles), nScriptCheckThreads);
+    return importer.Run() > 0;
 }
 
 void static CheckBlockIndex(const Consensus::Params& consensusParams)
@@ -4426,6 +5862,92 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t SIGCACHE_DUMP_VERSION = 1;
+
+bool LoadSignatureCaches()
+{
+    FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open signature cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    uint256 sigNonce, scriptNonce;
+    std::vector<uint256> vSigEntries, vScriptEntries;
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SIGCACHE_DUMP_VERSION) {
+            return false;
+        }
+        // What passes script verification may differ between versions, so
+        // entries are only taken from the version that saved them.
+        int nClientVersion;
+        file >> nClientVersion;
+        if (nClientVersion != CLIENT_VERSION) {
+            LogPrintf("Signature cache file is from client version %d. Discarding it.\n", nClientVersion);
+            return false;
+        }
+        file >> sigNonce >> vSigEntries;
+        file >> scriptNonce >> vScriptEntries;
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize signature cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    // Entries are only meaningful under the nonce they were computed with, so
+    // the caches take over the saved nonces.
+    LoadSignatureCacheEntries(sigNonce, vSigEntries);
+    {
+        LOCK(cs_main);
+        scriptExecutionCacheNonce = scriptNonce;
+        for (uint256 entry : vScriptEntries) {
+            scriptExecutionCache.insert(entry);
+        }
+    }
+
+    LogPrintf("Imported signature caches from disk: %u signatures, %u script executions\n", vSigEntries.size(), vScriptEntries.size());
+    return true;
+}
+
+void DumpSignatureCaches()
+{
+    int64_t start = GetTimeMicros();
+
+    uint256 sigNonce, scriptNonce;
+    std::vector<uint256> vSigEntries, vScriptEntries;
+    GetSignatureCacheEntries(sigNonce, vSigEntries);
+    {
+        LOCK(cs_main);
+        scriptNonce = scriptExecutionCacheNonce;
+        scriptExecutionCache.for_each([&vScriptEntries](const uint256& entry) { vScriptEntries.push_back(entry); });
+    }
+
+    int64_t mid = GetTimeMicros();
+
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat.new", "wb");
+        if (!filestr) {
+            return;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+
+        uint64_t version = SIGCACHE_DUMP_VERSION;
+        file << version;
+        file << (int)CLIENT_VERSION;
+        file << sigNonce << vSigEntries;
+        file << scriptNonce << vScriptEntries;
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(GetDataDir() / "sigcache.dat.new", GetDataDir() / "sigcache.dat");
+        int64_t last = GetTimeMicros();
+        LogPrintf("Dumped signature caches: %gs to copy, %gs to dump\n", (mid-start)*0.000001, (last-mid)*0.000001);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump signature caches: %s. Continuing anyway.\n", e.what());
+    }
+}
 
 bool LoadMempool(void)
 {
@@ -4564,9 +6086,7 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
     }
 } instance_of_cmaincleanup;
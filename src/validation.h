@@ -30,17 +30,26 @@
 
 #include <atomic>
 
+class CAutoFile;
+class CBlockCache;
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
+class CConnectTimesLog;
 class CChainParams;
+class CIncrementalCoinsStats;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
+class CDataStream;
 class CScriptCheck;
+class CSignatureBatch;
 class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
+class SnapshotMetadata;
 struct ChainTxData;
+struct SignatureCacheStats;
 
 struct PrecomputedTransactionData;
 struct LockPoints;
@@ -71,8 +80,8 @@ static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
 static const unsigned int MAX_DISCONNECTED_TX_POOL_SIZE = 20000;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
-/** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
-static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
+/** The maximum size of a blk?????.dat file when pruning, which deletes whole files */
+static const unsigned int PRUNE_BLOCKFILE_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
@@ -122,6 +131,13 @@ static const int64_t BLOCK_DOWNLOAD_TIMEOUT_BASE = 1000000;
 /** Additional block download timeout per parallel downloading peer (i.e. 5 min) */
 static const int64_t BLOCK_DOWNLOAD_TIMEOUT_PER_PEER = 500000;
 
+/** Default for -blockcachesize, the memory in MiB for recently used blocks */
+static const int64_t DEFAULT_BLOCK_CACHE_SIZE = 32;
+/** Maximum for -blockcachesize (MiB) */
+static const int64_t MAX_BLOCK_CACHE_SIZE = sizeof(void*) > 4 ? 16384 : 1024;
+/** Number of recently connected blocks whose connect times are kept */
+static const unsigned int CONNECT_TIMES_LOG_SIZE = 144;
+
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 /** Maximum age of our tip in seconds for us to be considered current for fee estimation */
 static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
@@ -130,9 +146,15 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
+static const bool DEFAULT_SCRIPTHASHINDEX = false;
+/** Default for -compressblocks */
+static const bool DEFAULT_COMPRESS_BLOCKS = false;
+static const bool DEFAULT_UTXOSTATS = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -persistsigcache */
+static const bool DEFAULT_PERSIST_SIGCACHE = true;
 /** Default for -mempoolreplacement */
 static const bool DEFAULT_ENABLE_REPLACEMENT = true;
 /** Default for using fee filter */
@@ -158,8 +180,14 @@ extern CScript COINBASE_FLAGS;
 extern CCriticalSection cs_main;
 extern CBlockPolicyEstimator feeEstimator;
 extern CTxMemPool mempool;
+/** Recently connected and read blocks */
+extern CBlockCache blockCache;
+/** Where the time went for recently connected blocks */
+extern CConnectTimesLog connectTimesLog;
 typedef std::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap mapBlockIndex;
+/** Storage of the entries of mapBlockIndex */
+extern CBlockIndexArena blockIndexArena;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockWeight;
 extern const std::string strMessageMagic;
@@ -168,11 +196,11 @@ extern CConditionVariable cvBlockChange;
 extern std::atomic_bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
-extern bool fTxIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+extern bool fUTXOStats;
 extern size_t nCoinCacheUsage;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
@@ -201,6 +229,8 @@ extern bool fHavePruned;
 extern bool fPruneMode;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
+/** Whether new blocks are stored through CBlockCompressor (-compressblocks). */
+extern bool fCompressBlocks;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
@@ -257,8 +287,10 @@ bool CheckDiskSpace(uint64_t nAdditionalBytes = 0);
 FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
-/** Import blocks from an external file */
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp = nullptr);
+/** Import blocks from an external file, storing them in our block files */
+bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn);
+/** Import the blocks of our own block files from blk00000.dat on, for -reindex */
+bool ReindexBlockFiles(const CChainParams& chainparams);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk,
@@ -266,6 +298,19 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 bool LoadBlockIndex(const CChainParams& chainparams);
 /** Update the chain tip based on database information. */
 bool LoadChainTip(const CChainParams& chainparams);
+/** Load the incrementally maintained UTXO set statistics (-utxostats), recomputing them if missing or stale. */
+bool LoadCoinsStats();
+/** Get the incrementally maintained UTXO set statistics for the current tip. Returns false if they are not maintained. */
+bool GetIncrementalCoinsStats(CIncrementalCoinsStats& stats);
+/**
+ * Replace the coins database with the coins of a UTXO snapshot (positioned at
+ * the start of its body) and make the snapshot's base block the active tip.
+ * The base block must descend from the current tip. The snapshot must have
+ * been checked with VerifyUTXOSnapshot first. cs_main is only taken to wipe
+ * the old coins and to switch the tip; in between the tip stays put while
+ * the coins load.
+ */
+bool LoadUTXOSnapshot(const CChainParams& chainparams, CAutoFile& file, const SnapshotMetadata& metadata, std::string& strError);
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
@@ -375,6 +420,13 @@ public:
 
     bool operator()();
 
+    /**
+     * Run the script with the signatures that miss the cache deferred to
+     * batch (see BatchingTransactionSignatureChecker), where those of this
+     * check start at nBatchBegin.
+     */
+    bool operator()(CSignatureBatch& batch, size_t nBatchBegin);
+
     void swap(CScriptCheck &check) {
         scriptPubKey.swap(check.scriptPubKey);
         std::swap(ptxTo, check.ptxTo);
@@ -389,13 +441,39 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Run a batch of script checks, verifying the signatures of all of them
+ * together. Checks whose signatures are not all valid are run again to get
+ * their exact result.
+ */
+bool CheckBatch(std::vector<CScriptCheck>& vChecks);
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
+/** Activity of the script-execution cache since startup */
+SignatureCacheStats GetScriptExecutionCacheStats();
+
+
+/**
+ * Deserialize a block received from the network. The transactions are read in
+ * order, but are built (which hashes each for its txid and wtxid) on up to
+ * -par threads.
+ */
+void DeserializeBlock(CDataStream& s, CBlock& block);
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read a block through blockCache, adding it there as least recently used if it had to be read from disk. nullptr if it cannot be read. */
+std::shared_ptr<const CBlock> ReadBlockFromDiskCached(const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the serialized block, with witness data. Blocks stored compactly are reserialized. */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
+/** Read the index header in front of the block at pos: the size it takes on disk and whether it is stored compactly. */
+bool ReadBlockRecordHeader(const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart, unsigned int& nSize, bool& fCompact);
+/** Read the undo data of a connected block. */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -422,9 +500,42 @@ class CVerifyDB {
 public:
     CVerifyDB();
     ~CVerifyDB();
+    /** Levels 0 to 2 check blocks on -par threads, levels 3 and 4 replay them on coinsview. */
     bool VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
 };
 
+/** Progress of the block verification running in the background */
+struct VerifyDBProgress
+{
+    bool fRunning = false;
+    int nCheckLevel = 0;
+    int nCheckDepth = 0;
+    //! Height of the block being checked
+    int nHeight = 0;
+    double dProgress = 0;
+    //! Times the tip moved and the check started over
+    int nRestarts = 0;
+    //! "not started", "running", "ok", "failed", "interrupted" or "incomplete"
+    std::string strStatus = "not started";
+};
+
+/**
+ * Run levels 3 and 4 of the block verification (see CVerifyDB) on pcoinsTip
+ * in a thread of its own, while the node is up. cs_main is held for one block
+ * at a time; the check starts over when the tip moves. A failure is reported
+ * as a warning.
+ */
+void StartBackgroundVerifyDB(const CChainParams& chainparams, int nCheckLevel, int nCheckDepth);
+void StopBackgroundVerifyDB();
+VerifyDBProgress GetBackgroundVerifyDBProgress();
+
+/**
+ * Sync block and undo files in a thread of its own from now on, instead of
+ * on the thread storing blocks. Stop it after the last FlushStateToDisk.
+ */
+void StartBlockFileFlusher();
+void StopBlockFileFlusher();
+
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 
@@ -483,6 +594,12 @@ void DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/** Dump the signature and script execution caches to disk, along with the nonces they are salted with. */
+void DumpSignatureCaches();
+
+/** Load the signature and script execution caches from disk. */
+bool LoadSignatureCaches();
+
 // Low-energy checker
 bool CheckBlockRestWindowCompliance(int64_t blockHeight, uint256 blockHash, uint256 metronomeHash, uint256 parentMetronomeHash, const CChainParams& params);
 
@@ -0,0 +1,43 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validationstats.h"
+
+CConnectTimesLog::CConnectTimesLog(size_t nMaxSizeIn) : nNext(0), nMaxSize(nMaxSizeIn)
+{
+    vTimes.reserve(nMaxSize);
+}
+
+void CConnectTimesLog::Add(const BlockConnectTimes& times)
+{
+    LOCK(cs);
+    if (nMaxSize == 0)
+        return;
+    if (vTimes.size() < nMaxSize) {
+        vTimes.push_back(times);
+    } else {
+        vTimes[nNext] = times;
+    }
+    nNext = (nNext + 1) % nMaxSize;
+}
+
+std::vector<BlockConnectTimes> CConnectTimesLog::GetRecent() const
+{
+    LOCK(cs);
+    std::vector<BlockConnectTimes> vRet;
+    vRet.reserve(vTimes.size());
+    // Once full, the oldest entry is the next one to be overwritten.
+    size_t nStart = vTimes.size() < nMaxSize ? 0 : nNext;
+    for (size_t i = 0; i < vTimes.size(); i++) {
+        vRet.push_back(vTimes[(nStart + i) % vTimes.size()]);
+    }
+    return vRet;
+}
+
+void CConnectTimesLog::Clear()
+{
+    LOCK(cs);
+    vTimes.clear();
+    nNext = 0;
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_VALIDATIONSTATS_H
+#define BITCOIN_VALIDATIONSTATS_H
+
+#include "sync.h"
+#include "uint256.h"
+
+#include <stdint.h>
+#include <vector>
+
+/** Where the time to connect one block went, in microseconds */
+struct BlockConnectTimes
+{
+    uint256 hash;
+    int nHeight;
+    unsigned int nTx;
+    unsigned int nInputs;
+    //! Loading the block from disk, 0 if it was passed in
+    int64_t nTimeRead;
+    //! Fetching inputs and checking amounts, sequence locks and sigops. Script
+    //! checks run on the script check threads during this time.
+    int64_t nTimeInputs;
+    //! Running the remaining script checks and waiting for the threads to finish
+    int64_t nTimeScripts;
+    //! Writing undo data
+    int64_t nTimeUndo;
+    //! Flushing the block's changes into the coins cache
+    int64_t nTimeFlush;
+    //! Writing the chain state to disk if needed
+    int64_t nTimeChainState;
+    //! Everything from loading the block to updating the tip
+    int64_t nTimeTotal;
+};
+
+/**
+ * The times of the last blocks connected, oldest overwritten first, so that
+ * slow blocks can be looked at after the fact.
+ */
+class CConnectTimesLog
+{
+private:
+    mutable CCriticalSection cs;
+    std::vector<BlockConnectTimes> vTimes;
+    size_t nNext;
+    size_t nMaxSize;
+
+public:
+    explicit CConnectTimesLog(size_t nMaxSizeIn);
+
+    void Add(const BlockConnectTimes& times);
+
+    /** The entries kept, oldest first. */
+    std::vector<BlockConnectTimes> GetRecent() const;
+
+    void Clear();
+};
+
+#endif // BITCOIN_VALIDATIONSTATS_H
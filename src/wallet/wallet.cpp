@@ -25,6 +25,7 @@
 #include "script/script.h"
 #include "script/sign.h"
 #include "scheduler.h"
+#include "startupprofile.h"
 #include "timedata.h"
 #include "txmempool.h"
 #include "util.h"
@@ -4088,7 +4089,10 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
         }
 
         nStart = GetTimeMillis();
-        walletInstance->ScanForWalletTransactions(pindexRescan, true);
+        {
+            StartupPhase phase("rescan");
+            walletInstance->ScanForWalletTransactions(pindexRescan, true);
+        }
         LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
         walletInstance->SetBestChain(chainActive.GetLocator());
         walletInstance->dbw->IncrementUpdateCounter();
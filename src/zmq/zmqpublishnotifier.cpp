@@ -174,14 +174,14 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
     {
         LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
+        std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pindex, consensusParams);
+        if(!pblock)
         {
             zmqError("Can't read block from disk");
             return false;
         }
 
-        ss << block;
+        ss << *pblock;
     }
 
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());